@@ -0,0 +1,461 @@
+/*
+ *  Filename:
+ *      aio.c
+ *
+ *  Purpose:
+ *      To define functions for asynchronous file reads and writes. Requests
+ *      are submitted to io_uring through its system calls, so no library is
+ *      needed, and served by a pool of threads calling pread() and pwrite()
+ *      where io_uring is unavailable. Setting STEGANO_AIO=threads in the
+ *      environment forces the thread pool.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ */
+
+#include "aio.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+struct queue           // Structure representing a FIFO queue of requests
+{
+    AIOREQ *first;     // Request taken next, or NULL if empty
+    AIOREQ *last;      // Request added last
+};
+
+struct ring                      // Structure representing an io_uring
+{
+    int fd;                      // File descriptor of the ring
+    unsigned entries;            // Number of submission queue entries
+    unsigned *sqTail;            // Tail of submission queue, written by us
+    unsigned *sqMask;            // Mask of submission queue indices
+    unsigned *sqArray;           // Indices of submitted entries
+    struct io_uring_sqe *sqes;   // Submission queue entries
+    unsigned *cqHead;            // Head of completion queue, written by us
+    unsigned *cqTail;            // Tail of completion queue
+    unsigned *cqMask;            // Mask of completion queue indices
+    struct io_uring_cqe *cqes;   // Completion queue entries
+    void *sqMap;                 // Mapping of submission queue ring
+    size_t sqMapSize;            // Size of sqMap in bytes
+    void *cqMap;                 // Mapping of completion queue ring
+    size_t cqMapSize;            // Size of cqMap in bytes
+    size_t sqesSize;             // Size of sqes in bytes
+    unsigned unsubmitted;        // Entries queued but not yet entered
+};
+
+struct aioEngine               // Structure representing an I/O engine
+{
+    int uring;                 // Nonzero if requests go to io_uring
+    struct ring ring;          // Ring of io_uring engine
+    unsigned inflight;         // Requests handed to the kernel
+
+    struct queue pending;      // Requests not yet started
+    struct queue completed;    // Requests finished but not yet returned
+    size_t outstanding;        // Requests submitted but not yet returned
+
+    pthread_t threads[AIO_THREADS]; // Threads of thread pool engine
+    int threadCount;           // Number of threads started
+    int closing;               // Nonzero once threads must stop
+    pthread_mutex_t lock;      // Guards queues and counters of thread pool
+    pthread_cond_t work;       // Signalled when a request is pending
+    pthread_cond_t done;       // Signalled when a request is completed
+};
+
+// Appends request reqPtr to queue pointed to by qPtr. Returns none.
+static void pushRequest(struct queue *qPtr, AIOREQ *reqPtr)
+{
+    reqPtr->next = NULL;
+    if (qPtr->last != NULL)
+    {
+        qPtr->last->next = reqPtr;
+    }
+    else
+    {
+        qPtr->first = reqPtr;
+    }
+    qPtr->last = reqPtr;
+}
+
+// Removes the first request of queue pointed to by qPtr. Returns pointer to
+// the request, or NULL if the queue is empty.
+static AIOREQ *popRequest(struct queue *qPtr)
+{
+    AIOREQ *reqPtr = qPtr->first;
+    if (reqPtr != NULL)
+    {
+        qPtr->first = reqPtr->next;
+        if (qPtr->first == NULL)
+        {
+            qPtr->last = NULL;
+        }
+    }
+    return reqPtr;
+}
+
+// Records that request reqPtr transferred count more bytes, or failed with
+// a negative count. Returns 1 if the request is finished, 0 if bytes remain.
+static int advanceRequest(AIOREQ *reqPtr, ssize_t count)
+{
+    if (count < 0)
+    {
+        reqPtr->result = count;
+        return 1;
+    }
+
+    // A read of 0 bytes is the end of file; the caller sees a short result
+    reqPtr->done += count;
+    if (count == 0 || reqPtr->done == reqPtr->length)
+    {
+        reqPtr->result = count == 0 && reqPtr->write ? -EIO
+                                                      : (ssize_t)reqPtr->done;
+        return 1;
+    }
+    return 0;
+}
+
+// Maps the rings of the io_uring with entries entries into the ring pointed
+// to by ringPtr. Returns 0 on success.
+static int openRing(struct ring *ringPtr, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+    {
+        return ERR_OPEN; // Kernel lacks io_uring or forbids it
+    }
+
+    ringPtr->fd = fd;
+    ringPtr->entries = params.sq_entries;
+    ringPtr->sqMapSize = params.sq_off.array +
+                         params.sq_entries * sizeof(unsigned);
+    ringPtr->cqMapSize = params.cq_off.cqes +
+                         params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // Newer kernels map both rings with one call
+    int single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ringPtr->cqMapSize > ringPtr->sqMapSize)
+    {
+        ringPtr->sqMapSize = ringPtr->cqMapSize;
+    }
+
+    ringPtr->sqMap = mmap(NULL, ringPtr->sqMapSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ringPtr->cqMap = single || ringPtr->sqMap == MAP_FAILED
+                         ? ringPtr->sqMap
+                         : mmap(NULL, ringPtr->cqMapSize,
+                                PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, fd,
+                                IORING_OFF_CQ_RING);
+    ringPtr->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ringPtr->sqes = mmap(NULL, ringPtr->sqesSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if (ringPtr->sqMap == MAP_FAILED || ringPtr->cqMap == MAP_FAILED ||
+        ringPtr->sqes == MAP_FAILED)
+    {
+        if (ringPtr->sqes != MAP_FAILED)
+        {
+            munmap(ringPtr->sqes, ringPtr->sqesSize);
+        }
+        if (ringPtr->cqMap != MAP_FAILED && ringPtr->cqMap != ringPtr->sqMap)
+        {
+            munmap(ringPtr->cqMap, ringPtr->cqMapSize);
+        }
+        if (ringPtr->sqMap != MAP_FAILED)
+        {
+            munmap(ringPtr->sqMap, ringPtr->sqMapSize);
+        }
+        close(fd);
+        return ERR_OPEN;
+    }
+
+    BYTE *sq = ringPtr->sqMap;
+    BYTE *cq = ringPtr->cqMap;
+    ringPtr->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ringPtr->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ringPtr->sqArray = (unsigned *)(sq + params.sq_off.array);
+    ringPtr->cqHead = (unsigned *)(cq + params.cq_off.head);
+    ringPtr->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ringPtr->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ringPtr->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ringPtr->unsubmitted = 0;
+
+    return 0;
+}
+
+// Unmaps and closes the ring pointed to by ringPtr. Returns none.
+static void closeRing(struct ring *ringPtr)
+{
+    munmap(ringPtr->sqes, ringPtr->sqesSize);
+    if (ringPtr->cqMap != ringPtr->sqMap)
+    {
+        munmap(ringPtr->cqMap, ringPtr->cqMapSize);
+    }
+    munmap(ringPtr->sqMap, ringPtr->sqMapSize);
+    close(ringPtr->fd);
+}
+
+// Submits queued entries of the ring pointed to by ringPtr to the kernel,
+// waiting for at least minComplete completions. Returns none.
+static void enterRing(struct ring *ringPtr, unsigned minComplete)
+{
+    for (;;)
+    {
+        int entered = syscall(__NR_io_uring_enter, ringPtr->fd,
+                              ringPtr->unsubmitted, minComplete,
+                              minComplete ? IORING_ENTER_GETEVENTS : 0, NULL,
+                              0);
+        if (entered >= 0)
+        {
+            ringPtr->unsubmitted -= entered;
+            return;
+        }
+        if (errno != EINTR)
+        {
+            return; // Entries stay queued and are entered next time
+        }
+    }
+}
+
+// Moves pending requests of the engine pointed to by aioPtr into free
+// submission queue entries and enters them. Returns none.
+static void flushRing(AIO *aioPtr)
+{
+    struct ring *ringPtr = &aioPtr->ring;
+    unsigned tail = *ringPtr->sqTail; // Only this thread writes the tail
+
+    while (aioPtr->inflight < ringPtr->entries && aioPtr->pending.first)
+    {
+        AIOREQ *reqPtr = popRequest(&aioPtr->pending);
+        reqPtr->iov.iov_base = reqPtr->buf + reqPtr->done;
+        reqPtr->iov.iov_len = reqPtr->length - reqPtr->done;
+
+        unsigned index = tail & *ringPtr->sqMask;
+        struct io_uring_sqe *sqePtr = &ringPtr->sqes[index];
+        memset(sqePtr, 0, sizeof(*sqePtr));
+        sqePtr->opcode = reqPtr->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqePtr->fd = reqPtr->fd;
+        sqePtr->addr = (unsigned long)&reqPtr->iov;
+        sqePtr->len = 1;
+        sqePtr->off = reqPtr->offset + reqPtr->done;
+        sqePtr->user_data = (unsigned long)reqPtr;
+        ringPtr->sqArray[index] = index;
+
+        tail++;
+        aioPtr->inflight++;
+        ringPtr->unsubmitted++;
+    }
+
+    // Publishes the entries before the kernel reads the tail
+    __atomic_store_n(ringPtr->sqTail, tail, __ATOMIC_RELEASE);
+    if (ringPtr->unsubmitted > 0)
+    {
+        enterRing(ringPtr, 0);
+    }
+}
+
+// Moves every completion of the ring of engine aioPtr into its completed
+// queue, resubmitting requests with bytes left. Returns none.
+static void reapRing(AIO *aioPtr)
+{
+    struct ring *ringPtr = &aioPtr->ring;
+    unsigned head = *ringPtr->cqHead;
+    unsigned tail = __atomic_load_n(ringPtr->cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+        struct io_uring_cqe *cqePtr = &ringPtr->cqes[head & *ringPtr->cqMask];
+        AIOREQ *reqPtr = (AIOREQ *)(unsigned long)cqePtr->user_data;
+        aioPtr->inflight--;
+
+        pushRequest(advanceRequest(reqPtr, cqePtr->res) ? &aioPtr->completed
+                                                        : &aioPtr->pending,
+                    reqPtr);
+    }
+
+    __atomic_store_n(ringPtr->cqHead, head, __ATOMIC_RELEASE);
+}
+
+// Serves pending requests of the engine pointed to by arg with pread() and
+// pwrite() until the engine closes. Returns NULL.
+static void *serveRequests(void *arg)
+{
+    AIO *aioPtr = arg;
+
+    pthread_mutex_lock(&aioPtr->lock);
+    for (;;)
+    {
+        while (aioPtr->pending.first == NULL && !aioPtr->closing)
+        {
+            pthread_cond_wait(&aioPtr->work, &aioPtr->lock);
+        }
+        AIOREQ *reqPtr = popRequest(&aioPtr->pending);
+        if (reqPtr == NULL)
+        {
+            break; // Closing with nothing left to serve
+        }
+        pthread_mutex_unlock(&aioPtr->lock);
+
+        for (;;)
+        {
+            BYTE *buf = reqPtr->buf + reqPtr->done;
+            size_t left = reqPtr->length - reqPtr->done;
+            off_t offset = reqPtr->offset + reqPtr->done;
+            ssize_t count = reqPtr->write
+                                ? pwrite(reqPtr->fd, buf, left, offset)
+                                : pread(reqPtr->fd, buf, left, offset);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (advanceRequest(reqPtr, count < 0 ? -errno : count))
+            {
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&aioPtr->lock);
+        pushRequest(&aioPtr->completed, reqPtr);
+        pthread_cond_signal(&aioPtr->done);
+    }
+    pthread_mutex_unlock(&aioPtr->lock);
+
+    return NULL;
+}
+
+// Creates an I/O engine using io_uring if the kernel allows it, or a pool of
+// threads otherwise. Returns pointer to the engine, or NULL on failure.
+AIO *aioOpen(void)
+{
+    AIO *aioPtr = calloc(1, sizeof(*aioPtr));
+    if (aioPtr == NULL)
+    {
+        return NULL;
+    }
+
+    const char *choice = getenv("STEGANO_AIO");
+    if ((choice == NULL || strcmp(choice, "threads")) &&
+        !openRing(&aioPtr->ring, AIO_ENTRIES))
+    {
+        aioPtr->uring = 1;
+        return aioPtr;
+    }
+
+    pthread_mutex_init(&aioPtr->lock, NULL);
+    pthread_cond_init(&aioPtr->work, NULL);
+    pthread_cond_init(&aioPtr->done, NULL);
+    for (; aioPtr->threadCount < AIO_THREADS; aioPtr->threadCount++)
+    {
+        if (pthread_create(&aioPtr->threads[aioPtr->threadCount], NULL,
+                           serveRequests, aioPtr))
+        {
+            break;
+        }
+    }
+    if (aioPtr->threadCount == 0)
+    {
+        aioClose(aioPtr);
+        return NULL;
+    }
+
+    return aioPtr;
+}
+
+// Returns name of the mechanism serving requests of engine aioPtr.
+const char *aioName(const AIO *aioPtr)
+{
+    return aioPtr->uring ? "io_uring" : "threads";
+}
+
+// Starts request reqPtr on engine aioPtr. Requests beyond what the engine
+// serves at once wait in a queue, so submitting never fails. Returns none.
+void aioSubmit(AIO *aioPtr, AIOREQ *reqPtr)
+{
+    reqPtr->done = 0;
+    reqPtr->result = 0;
+
+    if (aioPtr->uring)
+    {
+        aioPtr->outstanding++;
+        pushRequest(&aioPtr->pending, reqPtr);
+        flushRing(aioPtr);
+        return;
+    }
+
+    pthread_mutex_lock(&aioPtr->lock);
+    aioPtr->outstanding++;
+    pushRequest(&aioPtr->pending, reqPtr);
+    pthread_cond_signal(&aioPtr->work);
+    pthread_mutex_unlock(&aioPtr->lock);
+}
+
+// Takes a finished request of engine aioPtr, waiting for one if wait is
+// nonzero and requests are outstanding. Returns pointer to the request with
+// its result set, or NULL if none is finished.
+AIOREQ *aioComplete(AIO *aioPtr, int wait)
+{
+    AIOREQ *reqPtr;
+
+    if (aioPtr->uring)
+    {
+        for (;;)
+        {
+            reapRing(aioPtr);
+            flushRing(aioPtr); // Resubmits requests with bytes left
+            reqPtr = popRequest(&aioPtr->completed);
+            if (reqPtr != NULL || !wait || aioPtr->outstanding == 0)
+            {
+                break;
+            }
+            enterRing(&aioPtr->ring, 1);
+        }
+    }
+    else
+    {
+        pthread_mutex_lock(&aioPtr->lock);
+        while (aioPtr->completed.first == NULL && wait &&
+               aioPtr->outstanding > 0)
+        {
+            pthread_cond_wait(&aioPtr->done, &aioPtr->lock);
+        }
+        reqPtr = popRequest(&aioPtr->completed);
+        pthread_mutex_unlock(&aioPtr->lock);
+    }
+
+    if (reqPtr != NULL)
+    {
+        aioPtr->outstanding--; // Only the caller's thread changes this
+    }
+    return reqPtr;
+}
+
+// Closes engine aioPtr, which must have no outstanding requests.
+// Returns none.
+void aioClose(AIO *aioPtr)
+{
+    if (aioPtr->uring)
+    {
+        closeRing(&aioPtr->ring);
+    }
+    else
+    {
+        pthread_mutex_lock(&aioPtr->lock);
+        aioPtr->closing = 1;
+        pthread_cond_broadcast(&aioPtr->work);
+        pthread_mutex_unlock(&aioPtr->lock);
+
+        for (int i = 0; i < aioPtr->threadCount; i++)
+        {
+            pthread_join(aioPtr->threads[i], NULL);
+        }
+        pthread_cond_destroy(&aioPtr->done);
+        pthread_cond_destroy(&aioPtr->work);
+        pthread_mutex_destroy(&aioPtr->lock);
+    }
+
+    free(aioPtr);
+}
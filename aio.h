@@ -0,0 +1,49 @@
+/*
+ *  Filename:
+ *      aio.h
+ *
+ *  Purpose:
+ *      To declare data structures and function prototypes for asynchronous
+ *      file reads and writes, submitted to io_uring where the kernel allows
+ *      it and to a pool of threads otherwise.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ */
+
+#ifndef AIO_H
+#define AIO_H
+
+#include "stegano.h"
+#include <sys/uio.h>
+
+#define AIO_CHUNK (1 << 20) // Largest transfer of one request in bytes
+#define AIO_ENTRIES 64      // Most requests handed to the kernel at once
+#define AIO_THREADS 4       // Threads serving requests without io_uring
+
+struct aioRequest        // Structure representing one read or write
+{
+    int fd;              // File read or written
+    BYTE *buf;           // Memory read into or written from
+    size_t length;       // Number of bytes to transfer
+    off_t offset;        // File offset of the first byte
+    int write;           // Nonzero to write, zero to read
+    void *owner;         // Caller's data, such as the job of the request
+    ssize_t result;      // Bytes transferred, or negative errno on failure
+    size_t done;         // Bytes transferred so far
+    struct iovec iov;    // Remaining bytes, as submitted to io_uring
+    struct aioRequest *next; // Next request in a queue of the engine
+};
+
+typedef struct aioRequest AIOREQ; // Defines new data type name for aioRequest
+
+typedef struct aioEngine AIO; // Engine serving requests, defined in aio.c
+
+// Function prototypes
+AIO *aioOpen(void);
+const char *aioName(const AIO *aioPtr);
+void aioSubmit(AIO *aioPtr, AIOREQ *reqPtr);
+AIOREQ *aioComplete(AIO *aioPtr, int wait);
+void aioClose(AIO *aioPtr);
+
+#endif
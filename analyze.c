@@ -0,0 +1,273 @@
+/*
+ *  Filename:
+ *      analyze.c
+ *
+ *  Purpose:
+ *      To measure the distortion of stego images against their cover images:
+ *      mean squared error, peak signal-to-noise ratio, modified bytes, the
+ *      largest change and the share of each row modified. Writes the results
+ *      as JSON.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - escaped filenames in the report
+ */
+
+#include "stegano.h"
+#include "kernels.h"
+
+#define PEAK_SQUARED (255.0 * 255.0) // Squared largest channel value
+
+struct reports        // Structure representing the JSON report being written
+{
+    FILE *jsonOut;    // Stream receiving the report
+    int rows;         // Nonzero to list the share of each row modified
+    int count;        // Number of image pairs reported so far
+};
+
+// Writes string str to stream jsonOut as a quoted JSON string, escaping
+// quotes, backslashes and control characters. Returns none.
+static void writeJsonString(FILE *jsonOut, const char *str)
+{
+    putc('"', jsonOut);
+    for (; *str != '\0'; str++)
+    {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+        {
+            fprintf(jsonOut, "\\%c", c);
+        }
+        else if (c < ' ')
+        {
+            fprintf(jsonOut, "\\u%04x", c);
+        }
+        else
+        {
+            putc(c, jsonOut);
+        }
+    }
+    putc('"', jsonOut);
+}
+
+// Reads count rows starting at row first of the images pointed to by covPtr
+// and stegPtr into covRows and stegRows, then measures the channel bytes of
+// each row, skipping padding, and alpha of 32-bit pixels gathered through
+// covPx and stegPx. Adds the differences to the structure pointed to by
+// distPtr and stores the share of channel bytes modified in each row in
+// density. Returns 0 on success.
+static int measureRows(const BMP *covPtr, const BMP *stegPtr, LONG first,
+                       LONG count, BYTE *covRows, BYTE *stegRows, BYTE *covPx,
+                       BYTE *stegPx, DISTORTION *distPtr, float *density)
+{
+    if (readRows(covPtr, first, count, covRows) ||
+        readRows(stegPtr, first, count, stegRows))
+    {
+        return ERR_FORMAT;
+    }
+
+    for (LONG row = 0; row < count; row++)
+    {
+        const BYTE *covRow = covRows + (size_t)row * covPtr->pxRowSize;
+        const BYTE *stegRow = stegRows + (size_t)row * stegPtr->pxRowSize;
+        if (covPtr->pxSize == 4)
+        {
+            gatherChannels(covRow, covPtr->width, covPx);
+            gatherChannels(stegRow, stegPtr->width, stegPx);
+            covRow = covPx;
+            stegRow = stegPx;
+        }
+
+        unsigned long long before = distPtr->changed;
+        measureDistortion(covRow, stegRow, covPtr->rowChannels, distPtr);
+        density[row] = (float)(distPtr->changed - before) /
+                       covPtr->rowChannels;
+    }
+
+    return 0;
+}
+
+// Measures the distortion of stego image stegName against cover image
+// coverName, streaming both a chunk of rows at a time, and appends the report
+// to the structure pointed to by repPtr. Returns 0 on success.
+static int analyzePair(const char *coverName, const char *stegName,
+                       struct reports *repPtr)
+{
+    BMP *covPtr = openImage(coverName); // Reads only the image headers
+    BMP *stegPtr = covPtr == NULL ? NULL : openImage(stegName);
+    if (stegPtr == NULL)
+    {
+        if (covPtr != NULL)
+        {
+            freeImage(covPtr);
+        }
+        return ERR_OPEN;
+    }
+
+    int status = 0;
+    if (covPtr->width != stegPtr->width || covPtr->height != stegPtr->height ||
+        covPtr->bitDepth != stegPtr->bitDepth)
+    {
+        reportError("image error: %s and %s differ in size or bit depth in "
+                    "analyzePair()\n",
+                    coverName, stegName);
+        status = ERR_MISMATCH;
+    }
+
+    // Rows are read a chunk at a time, so memory use does not depend on
+    // image height beyond the share of each row
+    LONG chunk = STREAM_CHUNK / covPtr->pxRowSize;
+    chunk = chunk > 0 ? chunk : 1;
+    BYTE *covRows = malloc((size_t)chunk * covPtr->pxRowSize);
+    BYTE *stegRows = malloc((size_t)chunk * covPtr->pxRowSize);
+    BYTE *covPx = malloc(covPtr->rowChannels);
+    BYTE *stegPx = malloc(covPtr->rowChannels);
+    float *density = malloc(sizeof(*density) * covPtr->height);
+    if (!status && (covRows == NULL || stegRows == NULL || covPx == NULL ||
+                    stegPx == NULL || density == NULL))
+    {
+        reportError("%s", "malloc() failed: no memory for rows in "
+                          "analyzePair()\n");
+        status = ERR_ALLOC;
+    }
+
+    DISTORTION dist = {0, 0, 0};
+    for (LONG first = 0; first < covPtr->height && !status; first += chunk)
+    {
+        LONG count = covPtr->height - first < chunk ? covPtr->height - first
+                                                    : chunk;
+        status = measureRows(covPtr, stegPtr, first, count, covRows, stegRows,
+                             covPx, stegPx, &dist, density + first);
+        if (status)
+        {
+            reportError("file error: %s or %s is truncated in "
+                        "analyzePair()\n",
+                        coverName, stegName);
+        }
+    }
+
+    if (!status)
+    {
+        size_t bytes = (size_t)covPtr->rowChannels * covPtr->height;
+        double mse = bytes ? (double)dist.squares / bytes : 0;
+        LONG rowsModified = 0;
+        for (LONG row = 0; row < covPtr->height; row++)
+        {
+            rowsModified += density[row] > 0;
+        }
+
+        FILE *jsonOut = repPtr->jsonOut;
+        fprintf(jsonOut, "%s\n    {\"cover\": ", repPtr->count ? "," : "");
+        writeJsonString(jsonOut, coverName);
+        fprintf(jsonOut, "%s", ", \"stego\": ");
+        writeJsonString(jsonOut, stegName);
+        fprintf(jsonOut,
+                ", \"width\": %d, \"height\": %d, \"depth\": %d, "
+                "\"bytes\": %zu, \"mse\": %.6g, ",
+                covPtr->width, covPtr->height, covPtr->bitDepth, bytes, mse);
+
+        // Identical images have infinite PSNR, which JSON cannot hold
+        if (dist.squares)
+        {
+            fprintf(jsonOut, "\"psnr_db\": %.4f, ",
+                    10 * log10(PEAK_SQUARED / mse));
+        }
+        else
+        {
+            fprintf(jsonOut, "%s", "\"psnr_db\": null, ");
+        }
+
+        fprintf(jsonOut,
+                "\"modified_bytes\": %llu, \"modified_share\": %.6g, "
+                "\"max_delta\": %d, \"rows_modified\": %d",
+                dist.changed, bytes ? (double)dist.changed / bytes : 0,
+                dist.maxDelta, rowsModified);
+
+        // Rows are listed in pixel array order, bottom row first
+        if (repPtr->rows)
+        {
+            fprintf(jsonOut, "%s", ",\n     \"row_density\": [");
+            for (LONG row = 0; row < covPtr->height; row++)
+            {
+                fprintf(jsonOut, "%s%.4g", row ? (row % 16 ? ", " : ",\n      ")
+                                               : "",
+                        density[row]);
+            }
+            fprintf(jsonOut, "%s", "]");
+        }
+        fprintf(jsonOut, "%s", "}");
+        repPtr->count++;
+    }
+
+    free(covRows);
+    free(stegRows);
+    free(covPx);
+    free(stegPx);
+    free(density);
+    freeImage(covPtr);
+    freeImage(stegPtr);
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *usage = "[-n] [-o REPORT.json] COVER.bmp STEGO.bmp "
+                        "[COVER.bmp STEGO.bmp]...";
+    struct reports rep = {stdout, 1, 0};
+    const char *jsonName = NULL; // Filename of JSON report, or NULL for stdout
+    int first = 1;               // Index of first cover image in argv
+
+    setHeadless(1); // Reports errors without clearing the terminal
+
+    while (first < argc && argv[first][0] == '-')
+    {
+        const char *option = argv[first++];
+        if (!strcmp(option, "-n"))
+        {
+            rep.rows = 0;
+        }
+        else if (!strcmp(option, "-o") && first < argc)
+        {
+            jsonName = argv[first++];
+        }
+        else
+        {
+            first = argc + 1;
+            break;
+        }
+    }
+
+    if (first >= argc || (argc - first) % 2)
+    {
+        fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+        return EXIT_FAILURE;
+    }
+
+    if (jsonName != NULL && (rep.jsonOut = fopen(jsonName, "w")) == NULL)
+    {
+        fprintf(stderr, "fopen() failed: %s could not be created\n",
+                jsonName);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(rep.jsonOut,
+            "{\n  \"format\": 1, \"kernel\": \"%s\",\n  \"results\": [",
+            kernelName());
+
+    int failures = 0;
+    for (int i = first; i < argc; i += 2)
+    {
+        if (analyzePair(argv[i], argv[i + 1], &rep))
+        {
+            fprintf(stderr, "%s could not be analyzed\n", argv[i + 1]);
+            failures++;
+        }
+    }
+    fprintf(rep.jsonOut, "%s", "\n  ]\n}\n");
+
+    if ((jsonName != NULL && fclose(rep.jsonOut)) || failures)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
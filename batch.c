@@ -0,0 +1,1031 @@
+/*
+ *  Filename:
+ *      batch.c
+ *
+ *  Purpose:
+ *      To define functions for running encoding and decoding jobs
+ *      non-interactively from command line arguments or a manifest of jobs.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - added work-stealing thread pool for --jobs
+ *                      - added --stream option
+ *                      - added --blind option
+ *                      - added --density option
+ *                      - added --compress option
+ *                      - added --stats option
+ *                      - added --patch option
+ *                      - added --async pipeline
+ *                      - ran one band per image with several workers
+ *                      - added --shard option
+ *                      - added --key option
+ *                      - added --hamming option
+ */
+
+#include "batch.h"
+#include "aio.h"
+#include "scatter.h"
+#include <fcntl.h>
+
+#define SLOT_FREE 0    // Slot holds no job
+#define SLOT_READING 1 // Input files of the slot's job are being read
+#define SLOT_READY 2   // Input files are read and the job awaits processing
+#define SLOT_WRITING 3 // Output file of the slot's job is being written
+
+struct jobList         // Structure representing a growable array of jobs
+{
+    JOB *jobs;         // Array of jobs
+    size_t count;      // Number of jobs in array
+    size_t capacity;   // Number of jobs the array can hold
+};
+
+typedef struct jobList JOBLIST; // Defines new data type name for struct jobList
+
+struct deque              // Structure representing the jobs queued for a worker
+{
+    size_t head;          // Index of next job taken by the owning worker
+    size_t tail;          // Index one past the job taken by stealing workers
+    pthread_mutex_t lock; // Guards head and tail
+};
+
+struct scheduler          // Structure representing state shared by workers
+{
+    const JOBLIST *listPtr;      // Jobs to be run
+    JOBFUNC runJob;              // Function that runs a single job
+    struct deque *deques;        // Queue of each worker
+    int workerCount;             // Number of workers
+    pthread_mutex_t outputLock;  // Guards stdout and the totals below
+    size_t failures;             // Number of failed jobs
+    size_t succeeded;            // Number of successful jobs
+    double bytes;                // Bytes read and written by successful jobs
+    int stats;                   // Nonzero to print stats of each job
+};
+
+struct worker                    // Structure representing a worker thread
+{
+    struct scheduler *schedPtr;  // Shared scheduler state
+    int id;                      // Index of the worker's own queue
+};
+
+struct slot                // Structure representing a job in the pipeline
+{
+    const JOB *jobPtr;     // Job held by the slot
+    int state;             // One of the SLOT_* states
+    int status;            // Status of the job so far, 0 while it succeeds
+    int fds[3];            // Descriptors of the job's files, -1 if closed
+    BYTE *data[2];         // Contents of the two input files
+    size_t sizes[2];       // Sizes of the two input files in bytes
+    BYTE *out;             // Content of the output file
+    size_t outSize;        // Size of the output file in bytes
+    AIOREQ *requests;      // Transfers of the current state
+    size_t pending;        // Transfers not yet completed
+    struct timespec start; // Time the job entered the pipeline
+    STATS jobStats;        // Stats of the processing stage of the job
+};
+
+struct pipeline                  // Structure representing state of pipeline
+{
+    struct scheduler *schedPtr;  // Totals and output shared with workers
+    PIPEFUNC pipeJob;            // Function processing a job in memory
+    AIO *aioPtr;                 // Engine serving reads and writes
+};
+
+// Appends a job with the three filenames to the list pointed to by listPtr.
+// Returns 0 on success.
+static int addJob(JOBLIST *listPtr, const char *first, const char *second,
+                  const char *third)
+{
+    // Rejects filenames that would not fit in the job structure
+    if (strlen(first) >= FNAME_MAX || strlen(second) >= FNAME_MAX ||
+        strlen(third) >= FNAME_MAX)
+    {
+        fprintf(stderr, "invalid filename: longer than %d characters\n",
+                FNAME_MAX - 1);
+        return ERR_FILENAME;
+    }
+
+    // Doubles capacity of the array when it is full
+    if (listPtr->count == listPtr->capacity)
+    {
+        size_t capacity = listPtr->capacity ? listPtr->capacity * 2 : 16;
+        JOB *jobs = realloc(listPtr->jobs, capacity * sizeof(*jobs));
+        if (jobs == NULL)
+        {
+            fprintf(stderr, "%s", "realloc() failed: no memory for jobs\n");
+            return ERR_ALLOC;
+        }
+
+        listPtr->jobs = jobs;
+        listPtr->capacity = capacity;
+    }
+
+    JOB *jobPtr = &listPtr->jobs[listPtr->count++];
+    jobPtr->number = listPtr->count;
+    jobPtr->stream = 0;
+    jobPtr->patch = 0;
+    jobPtr->mode = MODE_DIFF;
+    jobPtr->density = 1;
+    jobPtr->flags = 0;
+    jobPtr->key = 0;
+    strcpy(jobPtr->first, first);
+    strcpy(jobPtr->second, second);
+    strcpy(jobPtr->third, third);
+
+    return 0;
+}
+
+// Reads jobs from manifest indicated by fname, or stdin if fname is "-".
+// Each non-blank line holds three whitespace-separated filenames in the same
+// order as the interactive prompts; text after '#' is ignored. Returns the
+// number of malformed lines, or -1 if the manifest could not be opened.
+static int readManifest(const char *fname, JOBLIST *listPtr)
+{
+    FILE *manifest = strcmp(fname, "-") ? fopen(fname, "r") : stdin;
+    if (manifest == NULL)
+    {
+        fprintf(stderr, "fopen() failed: manifest %s could not be opened\n",
+                fname);
+        return -1;
+    }
+
+    char line[LINE_MAX_LEN]; // Current line of manifest
+    size_t lineNumber = 0;   // Number of current line
+    int badLines = 0;        // Number of malformed lines
+
+    while (fgets(line, sizeof(line), manifest) != NULL)
+    {
+        lineNumber++;
+
+        char *comment = strchr(line, '#'); // Removes comment from line
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        // Splits line into filenames
+        char *field[4];
+        size_t fieldCount = 0;
+        char *savePtr;
+        for (char *token = strtok_r(line, " \t\r\n", &savePtr);
+             token != NULL && fieldCount < 4;
+             token = strtok_r(NULL, " \t\r\n", &savePtr))
+        {
+            field[fieldCount++] = token;
+        }
+
+        if (fieldCount == 0) // Skips blank line
+        {
+            continue;
+        }
+
+        if (fieldCount != 3 ||
+            addJob(listPtr, field[0], field[1], field[2]))
+        {
+            fprintf(stderr, "manifest error: %s line %zu needs three "
+                            "filenames\n",
+                    fname, lineNumber);
+            badLines++;
+        }
+    }
+
+    if (manifest != stdin)
+    {
+        fclose(manifest);
+    }
+
+    return badLines;
+}
+
+// Returns size of file indicated by fname in bytes, or 0 if it does not exist.
+static double fileSize(const char *fname)
+{
+    struct stat info;
+    return stat(fname, &info) ? 0 : (double)info.st_size;
+}
+
+// Prints string str in stdout as a quoted JSON string. Returns none.
+static void printJsonString(const char *str)
+{
+    putchar('"');
+    for (; *str != '\0'; str++)
+    {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+        {
+            printf("\\%c", c);
+        }
+        else if (c < ' ')
+        {
+            printf("\\u%04x", c);
+        }
+        else
+        {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+// Prints a JSON record on one line in stdout with the timings and counters
+// of job pointed to by jobPtr, which returned status and took seconds.
+// Returns none.
+static void printStats(const JOB *jobPtr, int status, double seconds,
+                       STATS jobStats)
+{
+    printf("{\"job\": %zu, \"status\": %d, \"files\": [", jobPtr->number,
+           status);
+    printJsonString(jobPtr->first);
+    printf("%s", ", ");
+    printJsonString(jobPtr->second);
+    printf("%s", ", ");
+    printJsonString(jobPtr->third);
+    printf("], \"total_ms\": %.3f, \"load_ms\": %.3f, \"text_ms\": %.3f, "
+           "\"encode_ms\": %.3f, \"decode_ms\": %.3f, \"write_ms\": %.3f, "
+           "\"bytes_read\": %llu, \"bytes_written\": %llu, "
+           "\"pixels_modified\": %llu, \"rows_dirtied\": %llu, "
+           "\"peak_alloc_bytes\": %zu}\n",
+           seconds * 1e3, jobStats.loadTime * 1e3, jobStats.textTime * 1e3,
+           jobStats.encodeTime * 1e3, jobStats.decodeTime * 1e3,
+           jobStats.writeTime * 1e3, jobStats.bytesRead,
+           jobStats.bytesWritten, jobStats.pixelsModified,
+           jobStats.rowsDirtied, jobStats.peakBytes);
+}
+
+// Counts job pointed to by jobPtr, which returned status and took seconds,
+// towards the totals of the scheduler pointed to by schedPtr and prints its
+// status line, followed by its stats if they are enabled. Returns none.
+static void reportJob(struct scheduler *schedPtr, const JOB *jobPtr,
+                      int status, double seconds, STATS jobStats)
+{
+    // Counts input and output files of a job towards throughput
+    double bytes = 0;
+    if (!status)
+    {
+        bytes = fileSize(jobPtr->first) + fileSize(jobPtr->second) +
+                fileSize(jobPtr->third);
+    }
+
+    pthread_mutex_lock(&schedPtr->outputLock);
+    if (status)
+    {
+        schedPtr->failures++;
+        printf("job %zu: FAILED (error %d) %s %s %s\n", jobPtr->number,
+               status, jobPtr->first, jobPtr->second, jobPtr->third);
+    }
+    else
+    {
+        schedPtr->succeeded++;
+        schedPtr->bytes += bytes;
+        printf("job %zu: ok %s %s %s\n", jobPtr->number,
+               jobPtr->first, jobPtr->second, jobPtr->third);
+    }
+    if (schedPtr->stats)
+    {
+        printStats(jobPtr, status, seconds, jobStats);
+    }
+    fflush(stdout); // Shows progress of long batches immediately
+    pthread_mutex_unlock(&schedPtr->outputLock);
+}
+
+// Takes the next job index from the queue of worker id, stealing from the
+// back of another worker's queue once its own is empty. Returns 0 if a job
+// was taken and stores its index in the integer pointed to by indexPtr.
+static int takeJob(struct scheduler *schedPtr, int id, size_t *indexPtr)
+{
+    for (int i = 0; i < schedPtr->workerCount; i++)
+    {
+        int victim = (id + i) % schedPtr->workerCount; // Own queue comes first
+        struct deque *dequePtr = &schedPtr->deques[victim];
+        int taken = 0;
+
+        pthread_mutex_lock(&dequePtr->lock);
+        if (dequePtr->head < dequePtr->tail)
+        {
+            // Owner works from the front, thieves from the back, so they
+            // rarely contend for the same end of a queue
+            *indexPtr = victim == id ? dequePtr->head++ : --dequePtr->tail;
+            taken = 1;
+        }
+        pthread_mutex_unlock(&dequePtr->lock);
+
+        if (taken)
+        {
+            return 0;
+        }
+    }
+
+    return -1; // Every queue is empty
+}
+
+// Runs jobs until every queue is empty. Each job loads and frees its own BMP
+// structures, so workers share nothing but the queues. Returns NULL.
+static void *workerMain(void *arg)
+{
+    struct worker *workerPtr = arg;
+    struct scheduler *schedPtr = workerPtr->schedPtr;
+    size_t index;
+
+    while (!takeJob(schedPtr, workerPtr->id, &index))
+    {
+        const JOB *jobPtr = &schedPtr->listPtr->jobs[index];
+
+        // Stats of each job are kept by its worker's thread
+        struct timespec start, end;
+        if (schedPtr->stats)
+        {
+            resetStats();
+            clock_gettime(CLOCK_MONOTONIC, &start);
+        }
+        int status = schedPtr->runJob(jobPtr);
+        STATS jobStats = {0};
+        double seconds = 0;
+        if (schedPtr->stats)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            jobStats = getStats();
+            seconds = (end.tv_sec - start.tv_sec) +
+                      (end.tv_nsec - start.tv_nsec) / 1e9;
+        }
+
+        reportJob(schedPtr, jobPtr, status, seconds, jobStats);
+    }
+
+    return NULL;
+}
+
+// Runs jobs of the list pointed to by listPtr with runJob on workerCount
+// threads, then prints a throughput summary. Prints stats of each job if
+// stats is nonzero. Returns number of failed jobs.
+static size_t runJobs(const JOBLIST *listPtr, JOBFUNC runJob, int workerCount,
+                      int stats)
+{
+    struct scheduler sched = {listPtr, runJob, NULL, workerCount,
+                              PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, stats};
+
+    sched.deques = malloc(workerCount * sizeof(*sched.deques));
+    struct worker *workers = malloc(workerCount * sizeof(*workers));
+    pthread_t *threads = malloc(workerCount * sizeof(*threads));
+    if (sched.deques == NULL || workers == NULL || threads == NULL)
+    {
+        fprintf(stderr, "%s", "malloc() failed: no memory for workers\n");
+        free(sched.deques);
+        free(workers);
+        free(threads);
+        return listPtr->count;
+    }
+
+    // Deals out consecutive jobs to each worker; idle workers steal the rest
+    for (int i = 0; i < workerCount; i++)
+    {
+        sched.deques[i].head = listPtr->count * i / workerCount;
+        sched.deques[i].tail = listPtr->count * (i + 1) / workerCount;
+        pthread_mutex_init(&sched.deques[i].lock, NULL);
+        workers[i].schedPtr = &sched;
+        workers[i].id = i;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Worker 0 runs on the calling thread
+    int started = 1;
+    for (; started < workerCount; started++)
+    {
+        if (pthread_create(&threads[started], NULL, workerMain,
+                           &workers[started]))
+        {
+            break; // Remaining queues are stolen by the started workers
+        }
+    }
+    workerMain(&workers[0]);
+    for (int i = 1; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) +
+                     (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+
+    printf("%zu of %zu jobs succeeded on %d workers in %.3f s: "
+           "%.1f images/s, %.1f MB/s\n",
+           sched.succeeded, listPtr->count, started, seconds,
+           sched.succeeded / seconds, sched.bytes / 1e6 / seconds);
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        pthread_mutex_destroy(&sched.deques[i].lock);
+    }
+    free(sched.deques);
+    free(workers);
+    free(threads);
+
+    return sched.failures;
+}
+
+// Returns number of requests of at most AIO_CHUNK bytes a transfer of size
+// bytes is split into.
+static size_t countChunks(size_t size)
+{
+    return (size + AIO_CHUNK - 1) / AIO_CHUNK;
+}
+
+// Splits a transfer of size bytes between buf and file descriptor fd into
+// requests of at most AIO_CHUNK bytes, stored in the array reqs and
+// submitted to engine aioPtr on behalf of slot slotPtr. Writes if write is
+// nonzero and reads otherwise. Returns number of requests submitted.
+static size_t submitChunks(AIO *aioPtr, struct slot *slotPtr, AIOREQ *reqs,
+                           int fd, BYTE *buf, size_t size, int write)
+{
+    size_t count = 0;
+    for (size_t offset = 0; offset < size; offset += AIO_CHUNK)
+    {
+        AIOREQ *reqPtr = &reqs[count++];
+        reqPtr->fd = fd;
+        reqPtr->buf = buf + offset;
+        reqPtr->length = size - offset < AIO_CHUNK ? size - offset : AIO_CHUNK;
+        reqPtr->offset = offset;
+        reqPtr->write = write;
+        reqPtr->owner = slotPtr;
+        aioSubmit(aioPtr, reqPtr);
+    }
+
+    return count;
+}
+
+// Closes files and frees buffers of job in slot slotPtr, then reports its
+// status and frees the slot. Returns 1, the number of jobs finished.
+static int finishJob(struct pipeline *pipePtr, struct slot *slotPtr)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        // Output file is only complete once it is closed without error
+        if (slotPtr->fds[i] >= 0 && close(slotPtr->fds[i]) && i == 2 &&
+            !slotPtr->status)
+        {
+            reportError("close() failed: %s could not be written in "
+                        "finishJob()\n",
+                        slotPtr->jobPtr->third);
+            slotPtr->status = ERR_WRITE;
+        }
+        slotPtr->fds[i] = -1;
+    }
+    free(slotPtr->data[0]);
+    free(slotPtr->data[1]);
+    free(slotPtr->out);
+    free(slotPtr->requests);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    reportJob(pipePtr->schedPtr, slotPtr->jobPtr, slotPtr->status,
+              (end.tv_sec - slotPtr->start.tv_sec) +
+                  (end.tv_nsec - slotPtr->start.tv_nsec) / 1e9,
+              slotPtr->jobStats);
+
+    slotPtr->state = SLOT_FREE;
+    return 1;
+}
+
+// Places job pointed to by jobPtr in free slot slotPtr and submits reads of
+// its input files. A job whose input is not a regular file, such as a pipe,
+// has no size to read up front and runs synchronously instead. Returns
+// number of jobs finished, 1 if the job already ended and 0 otherwise.
+static int startJob(struct pipeline *pipePtr, struct slot *slotPtr,
+                    const JOB *jobPtr)
+{
+    const char *names[2] = {jobPtr->first, jobPtr->second};
+
+    slotPtr->jobPtr = jobPtr;
+    slotPtr->status = 0;
+    slotPtr->fds[0] = slotPtr->fds[1] = slotPtr->fds[2] = -1;
+    slotPtr->data[0] = slotPtr->data[1] = slotPtr->out = NULL;
+    slotPtr->sizes[0] = slotPtr->sizes[1] = slotPtr->outSize = 0;
+    slotPtr->requests = NULL;
+    slotPtr->pending = 0;
+    slotPtr->jobStats = (STATS){0};
+    clock_gettime(CLOCK_MONOTONIC, &slotPtr->start);
+
+    for (int i = 0; i < 2; i++)
+    {
+        // Decoding in blind mode reads no cover image
+        if (i == 0 && !strcmp(names[i], "-"))
+        {
+            continue;
+        }
+
+        struct stat info;
+        slotPtr->fds[i] = open(names[i], O_RDONLY);
+        if (slotPtr->fds[i] < 0 || fstat(slotPtr->fds[i], &info))
+        {
+            reportError("open() failed: %s could not be opened in "
+                        "startJob()\n",
+                        names[i]);
+            slotPtr->status = ERR_OPEN;
+            return finishJob(pipePtr, slotPtr);
+        }
+
+        if (!S_ISREG(info.st_mode))
+        {
+            for (int j = 0; j <= i; j++)
+            {
+                if (slotPtr->fds[j] >= 0)
+                {
+                    close(slotPtr->fds[j]);
+                    slotPtr->fds[j] = -1;
+                }
+            }
+
+            resetStats();
+            slotPtr->status = pipePtr->schedPtr->runJob(jobPtr);
+            slotPtr->jobStats = getStats();
+            return finishJob(pipePtr, slotPtr);
+        }
+
+        slotPtr->sizes[i] = info.st_size;
+        slotPtr->data[i] = malloc(info.st_size ? info.st_size : 1);
+        if (slotPtr->data[i] == NULL)
+        {
+            reportError("malloc() failed: no memory for %s in startJob()\n",
+                        names[i]);
+            slotPtr->status = ERR_ALLOC;
+            return finishJob(pipePtr, slotPtr);
+        }
+    }
+
+    size_t count = countChunks(slotPtr->sizes[0]) +
+                   countChunks(slotPtr->sizes[1]);
+    slotPtr->requests = malloc((count ? count : 1) *
+                               sizeof(*slotPtr->requests));
+    if (slotPtr->requests == NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for requests in "
+                          "startJob()\n");
+        slotPtr->status = ERR_ALLOC;
+        return finishJob(pipePtr, slotPtr);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        slotPtr->pending += submitChunks(pipePtr->aioPtr, slotPtr,
+                                         slotPtr->requests + slotPtr->pending,
+                                         slotPtr->fds[i], slotPtr->data[i],
+                                         slotPtr->sizes[i], 0);
+    }
+    slotPtr->state = slotPtr->pending ? SLOT_READING : SLOT_READY;
+
+    return 0;
+}
+
+// Processes job in ready slot slotPtr in memory, then submits writes of its
+// output file. Returns number of jobs finished, 1 if the job already ended
+// and 0 otherwise.
+static int processJob(struct pipeline *pipePtr, struct slot *slotPtr)
+{
+    const JOB *jobPtr = slotPtr->jobPtr;
+
+    if (!slotPtr->status)
+    {
+        resetStats();
+        slotPtr->status = pipePtr->pipeJob(jobPtr, slotPtr->data[0],
+                                           slotPtr->sizes[0], slotPtr->data[1],
+                                           slotPtr->sizes[1], &slotPtr->out,
+                                           &slotPtr->outSize);
+        slotPtr->jobStats = getStats();
+    }
+
+    // Input files are no longer needed once the output is in memory
+    for (int i = 0; i < 2; i++)
+    {
+        if (slotPtr->fds[i] >= 0)
+        {
+            close(slotPtr->fds[i]);
+            slotPtr->fds[i] = -1;
+        }
+        free(slotPtr->data[i]);
+        slotPtr->data[i] = NULL;
+    }
+    if (slotPtr->status)
+    {
+        return finishJob(pipePtr, slotPtr);
+    }
+
+    slotPtr->fds[2] = open(jobPtr->third, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (slotPtr->fds[2] < 0)
+    {
+        reportError("open() failed: %s could not be created in "
+                    "processJob()\n",
+                    jobPtr->third);
+        slotPtr->status = ERR_OPEN;
+        return finishJob(pipePtr, slotPtr);
+    }
+
+    size_t count = countChunks(slotPtr->outSize);
+    free(slotPtr->requests);
+    slotPtr->requests = malloc((count ? count : 1) *
+                               sizeof(*slotPtr->requests));
+    if (slotPtr->requests == NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for requests in "
+                          "processJob()\n");
+        slotPtr->status = ERR_ALLOC;
+        return finishJob(pipePtr, slotPtr);
+    }
+
+    slotPtr->pending = submitChunks(pipePtr->aioPtr, slotPtr,
+                                    slotPtr->requests, slotPtr->fds[2],
+                                    slotPtr->out, slotPtr->outSize, 1);
+    slotPtr->state = SLOT_WRITING;
+
+    return slotPtr->pending ? 0 : finishJob(pipePtr, slotPtr);
+}
+
+// Records finished request reqPtr against its slot, which becomes ready
+// once its reads are done and is freed once its writes are done. Returns
+// number of jobs finished.
+static int completeRequest(struct pipeline *pipePtr, AIOREQ *reqPtr)
+{
+    struct slot *slotPtr = reqPtr->owner;
+
+    // Reads stopping short mean the file shrank after it was opened
+    if (reqPtr->result != (ssize_t)reqPtr->length && !slotPtr->status)
+    {
+        const JOB *jobPtr = slotPtr->jobPtr;
+        reportError("%s failed: %s could not be %s in completeRequest()\n",
+                    reqPtr->write ? "write()" : "read()",
+                    reqPtr->write ? jobPtr->third
+                    : reqPtr->fd == slotPtr->fds[0] ? jobPtr->first
+                                                     : jobPtr->second,
+                    reqPtr->write ? "written" : "read");
+        slotPtr->status = reqPtr->write ? ERR_WRITE : ERR_FORMAT;
+    }
+
+    if (--slotPtr->pending > 0)
+    {
+        return 0;
+    }
+    if (slotPtr->state == SLOT_READING)
+    {
+        slotPtr->state = SLOT_READY;
+        return 0;
+    }
+    return finishJob(pipePtr, slotPtr);
+}
+
+// Runs jobs of the list pointed to by listPtr on one thread, keeping up to
+// depth jobs in flight: while the oldest job with its input files read is
+// processed in memory by pipeJob, later jobs are read and earlier ones are
+// written by an asynchronous I/O engine. Jobs that cannot be read up front
+// are run by runJob. Prints stats of each job if stats is nonzero, then a
+// throughput summary. Returns number of failed jobs.
+static size_t runPipeline(const JOBLIST *listPtr, JOBFUNC runJob,
+                          PIPEFUNC pipeJob, int depth, int stats)
+{
+    struct scheduler sched = {listPtr, runJob, NULL, 1,
+                              PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, stats};
+    struct pipeline pipe = {&sched, pipeJob, aioOpen()};
+
+    struct slot *slots = calloc(depth, sizeof(*slots));
+    if (pipe.aioPtr == NULL || slots == NULL)
+    {
+        fprintf(stderr, "%s", "aioOpen() failed: running jobs without "
+                              "asynchronous I/O\n");
+        if (pipe.aioPtr != NULL)
+        {
+            aioClose(pipe.aioPtr);
+        }
+        free(slots);
+        return runJobs(listPtr, runJob, 1, stats);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    size_t next = 0;     // Index of next job to start
+    size_t finished = 0; // Number of jobs finished
+    while (finished < listPtr->count)
+    {
+        // Starts jobs in free slots, so their reads overlap the work below
+        for (int i = 0; i < depth && next < listPtr->count; i++)
+        {
+            if (slots[i].state == SLOT_FREE)
+            {
+                finished += startJob(&pipe, &slots[i],
+                                     &listPtr->jobs[next++]);
+            }
+        }
+
+        // Collects finished transfers without waiting
+        AIOREQ *reqPtr;
+        while ((reqPtr = aioComplete(pipe.aioPtr, 0)) != NULL)
+        {
+            finished += completeRequest(&pipe, reqPtr);
+        }
+
+        // Processes the oldest ready job, keeping jobs in manifest order
+        struct slot *readyPtr = NULL;
+        for (int i = 0; i < depth; i++)
+        {
+            if (slots[i].state == SLOT_READY &&
+                (readyPtr == NULL ||
+                 slots[i].jobPtr->number < readyPtr->jobPtr->number))
+            {
+                readyPtr = &slots[i];
+            }
+        }
+        if (readyPtr != NULL)
+        {
+            finished += processJob(&pipe, readyPtr);
+            continue;
+        }
+
+        // Waits for a transfer when nothing can be processed
+        reqPtr = aioComplete(pipe.aioPtr, 1);
+        if (reqPtr != NULL)
+        {
+            finished += completeRequest(&pipe, reqPtr);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) +
+                     (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+
+    printf("%zu of %zu jobs succeeded with %s I/O, %d jobs in flight, in "
+           "%.3f s: %.1f images/s, %.1f MB/s\n",
+           sched.succeeded, listPtr->count, aioName(pipe.aioPtr), depth,
+           seconds, sched.succeeded / seconds, sched.bytes / 1e6 / seconds);
+
+    aioClose(pipe.aioPtr);
+    free(slots);
+
+    return sched.failures;
+}
+
+// Runs every job of the list pointed to by listPtr together with shardJobs,
+// as the shards of one secret text, then prints the status line of each job
+// and a throughput summary. Stats printed for each job, if stats is
+// nonzero, are those of the whole set. Returns number of failed jobs.
+static size_t runShardSet(const JOBLIST *listPtr, SHARDFUNC shardJobs,
+                          int stats)
+{
+    struct scheduler sched = {listPtr, NULL, NULL, 1,
+                              PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, stats};
+
+    struct timespec start, end;
+    resetStats();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int status = listPtr->count ? shardJobs(listPtr->jobs, listPtr->count) : 0;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    STATS setStats = getStats();
+
+    double seconds = (end.tv_sec - start.tv_sec) +
+                     (end.tv_nsec - start.tv_nsec) / 1e9;
+    for (size_t i = 0; i < listPtr->count; i++)
+    {
+        reportJob(&sched, &listPtr->jobs[i], status, seconds, setStats);
+    }
+    if (seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+
+    printf("%zu of %zu jobs succeeded as %zu shards in %.3f s: "
+           "%.1f images/s, %.1f MB/s\n",
+           sched.succeeded, listPtr->count, listPtr->count, seconds,
+           sched.succeeded / seconds, sched.bytes / 1e6 / seconds);
+
+    return sched.failures;
+}
+
+// Runs each job given by command line arguments argv with runJob, printing
+// one status line per job in stdout. Jobs are given as filename triples,
+// or listed in a manifest after "-m", and run on the number of threads
+// given after "-j". Option "-s" streams every job in constant memory and
+// option "-b" encodes every job in blind mode. Option "-d" sets the bits
+// encoded per color channel and implies "-b". Option "-z" compresses the
+// secret text of every job. Option "-p" writes only the modified bytes of
+// each stego image over a clone of its cover image. Option "--stats" prints a
+// JSON record of the timings and counters of each job after its status line.
+// Option "-a" pipelines the given number of jobs with asynchronous I/O,
+// processing each in memory with pipeJob. Option "-S" runs every job
+// together with shardJobs as the shards of one secret text. Option "-k"
+// scatters payload bits by a key derived from the given passphrase. Option
+// "-H" embeds with Hamming blocks of the given number of bits per block,
+// which are decoded blind like "-b". Either function may be NULL where jobs
+// cannot be run that way, in which case its option is rejected. Returns
+// EXIT_SUCCESS if every job succeeded and EXIT_FAILURE otherwise.
+int runBatch(int argc, char *argv[], JOBFUNC runJob, PIPEFUNC pipeJob,
+             SHARDFUNC shardJobs, const char *usage)
+{
+    JOBLIST list = {NULL, 0, 0}; // Jobs to be run
+    size_t failures = 0;         // Number of failed jobs and malformed lines
+    int workerCount = 1;         // Number of threads running jobs
+    int stream = 0;              // Nonzero to stream every job
+    int patch = 0;               // Nonzero to patch every stego image
+    int mode = MODE_DIFF;        // Embedding mode of every job
+    int density = 1;             // Bits per color channel of every job
+    int flags = 0;               // Payload flags of every job
+    int stats = 0;               // Nonzero to print stats of every job
+    int depth = 0;               // Jobs in flight, or 0 without pipelining
+    int shard = 0;               // Nonzero to shard one text across jobs
+    unsigned long long key = 0;  // Scattering key of every job, or 0
+
+    setHeadless(1); // Reports errors without clearing the terminal
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help"))
+        {
+            printf("usage: %s %s\n", argv[0], usage);
+            free(list.jobs);
+            return EXIT_SUCCESS;
+        }
+        else if (!strcmp(argv[i], "-m") || !strcmp(argv[i], "--manifest"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+
+            int badLines = readManifest(argv[++i], &list);
+            if (badLines < 0)
+            {
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+            failures += badLines;
+        }
+        else if (!strcmp(argv[i], "-s") || !strcmp(argv[i], "--stream"))
+        {
+            stream = 1;
+        }
+        else if (!strcmp(argv[i], "-p") || !strcmp(argv[i], "--patch"))
+        {
+            patch = 1;
+        }
+        else if (!strcmp(argv[i], "-b") || !strcmp(argv[i], "--blind"))
+        {
+            mode = MODE_LSB;
+        }
+        else if (!strcmp(argv[i], "-z") || !strcmp(argv[i], "--compress"))
+        {
+            flags |= PAYLOAD_COMPRESSED;
+        }
+        else if (!strcmp(argv[i], "-S") || !strcmp(argv[i], "--shard"))
+        {
+            if (shardJobs == NULL)
+            {
+                fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+
+            shard = 1;
+        }
+        else if (!strcmp(argv[i], "--stats"))
+        {
+            stats = 1;
+        }
+        else if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--density"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+
+            // Multiple bits per channel are only decodable in blind mode
+            density = atoi(argv[++i]);
+            mode = MODE_LSB;
+        }
+        else if (!strcmp(argv[i], "-H") || !strcmp(argv[i], "--hamming"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+
+            // Hamming blocks hold their bits per block in the density field
+            density = atoi(argv[++i]);
+            mode = MODE_HAMMING;
+        }
+        else if (!strcmp(argv[i], "-k") || !strcmp(argv[i], "--key"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+
+            key = scatterKey(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-j") || !strcmp(argv[i], "--jobs"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+
+            // Uses every online core if count is 0
+            workerCount = atoi(argv[++i]);
+            if (workerCount <= 0)
+            {
+                workerCount = sysconf(_SC_NPROCESSORS_ONLN);
+            }
+            if (workerCount <= 0)
+            {
+                workerCount = 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-a") || !strcmp(argv[i], "--async"))
+        {
+            if (i + 1 == argc || pipeJob == NULL)
+            {
+                fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+                free(list.jobs);
+                return EXIT_FAILURE;
+            }
+
+            // Uses default depth if count is 0
+            depth = atoi(argv[++i]);
+            if (depth <= 0)
+            {
+                depth = PIPE_DEPTH;
+            }
+        }
+        else if (i + 2 < argc) // Reads job given as a filename triple
+        {
+            failures += addJob(&list, argv[i], argv[i + 1], argv[i + 2]) != 0;
+            i += 2;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+            free(list.jobs);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Applies options to every job, wherever they appeared in argv
+    for (size_t i = 0; i < list.count; i++)
+    {
+        list.jobs[i].stream = stream;
+        list.jobs[i].patch = patch;
+        list.jobs[i].mode = mode;
+        list.jobs[i].density = density;
+        list.jobs[i].flags = flags;
+        list.jobs[i].key = key;
+    }
+
+    // Never starts more workers than there are jobs
+    if ((size_t)workerCount > list.count)
+    {
+        workerCount = list.count ? list.count : 1;
+    }
+
+    // Workers already keep the cores busy, so each encodes its image alone
+    if (workerCount > 1)
+    {
+        setBandThreads(1);
+    }
+
+    // Runs each job and reports its status without stopping on failure.
+    // Streamed and patched jobs read and write in place, so never pipeline
+    enableStats(stats);
+    if (shard)
+    {
+        failures += runShardSet(&list, shardJobs, stats);
+    }
+    else if (depth > 0 && !stream && !patch)
+    {
+        if ((size_t)depth > list.count)
+        {
+            depth = list.count ? list.count : 1;
+        }
+        failures += runPipeline(&list, runJob, pipeJob, depth, stats);
+    }
+    else
+    {
+        failures += runJobs(&list, runJob, workerCount, stats);
+    }
+
+    free(list.jobs);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
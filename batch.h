@@ -0,0 +1,69 @@
+/*
+ *  Filename:
+ *      batch.h
+ *
+ *  Purpose:
+ *      To declare data structures and function prototypes for running
+ *      encoding and decoding jobs non-interactively from command line
+ *      arguments or a manifest of jobs.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - added headers for thread pool
+ *                      - added streaming option to jobs
+ *                      - added embedding mode to jobs
+ *                      - added embedding density to jobs
+ *                      - added payload flags to jobs
+ *                      - added patch option to jobs
+ *                      - added pipelined jobs
+ *                      - added sharded jobs
+ *                      - added scattering key to jobs
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "stegano.h"
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define LINE_MAX_LEN 1024   // Maximum length of a line in a manifest
+#define PIPE_DEPTH 8        // Default number of pipelined jobs in flight
+
+struct job                  // Structure representing one encode or decode job
+{
+    size_t number;          // Position of job in the batch, starting at 1
+    char first[FNAME_MAX];  // Filename of cover image
+    char second[FNAME_MAX]; // Secret text (encode) or stego image (decode)
+    char third[FNAME_MAX];  // Stego image (encode) or decoded text (decode)
+    int stream;             // Nonzero to stream rows in constant memory
+    int patch;              // Nonzero to write only modified bytes
+    int mode;               // Embedding mode used to encode
+    int density;            // Bits encoded per color channel
+    int flags;              // Payload flags used to encode
+    unsigned long long key; // Key scattering payload bits, or 0 if none
+};
+
+typedef struct job JOB; // Defines new data type name for struct job
+
+// Function that runs a single job. Returns 0 on success.
+typedef int (*JOBFUNC)(const JOB *jobPtr);
+
+// Function that processes a single job in memory, given the contents of its
+// first and second files, or NULL for a first file of "-". Stores the
+// allocated content of its third file in the pointer pointed to by outPtr
+// and its size in the integer pointed to by outSizePtr. Returns 0 on success.
+typedef int (*PIPEFUNC)(const JOB *jobPtr, const BYTE *first,
+                        size_t firstSize, const BYTE *second,
+                        size_t secondSize, BYTE **outPtr, size_t *outSizePtr);
+
+// Function that runs count jobs together as the shards of one secret text.
+// Returns 0 on success.
+typedef int (*SHARDFUNC)(const JOB *jobs, size_t count);
+
+// Function prototypes
+int runBatch(int argc, char *argv[], JOBFUNC runJob, PIPEFUNC pipeJob,
+             SHARDFUNC shardJobs, const char *usage);
+
+#endif
@@ -0,0 +1,706 @@
+/*
+ *  Filename:
+ *      bench.c
+ *
+ *  Purpose:
+ *      To measure the speed of the encoding and decoding kernels on the
+ *      pixel array of a cover image, and of encoding and decoding secret
+ *      text with and without compression.
+ *
+ *  Modifications:
+ *      17 October 2026 - created with decoding kernel benchmark
+ *                      - added encoding kernel benchmark
+ *                      - added multi-bit least significant bit benchmark
+ *                      - added compression and end-to-end benchmarks
+ *                      - added scattered end-to-end and permutation
+ *                        benchmarks
+ *                      - added Hamming matrix embedding benchmark
+ *                      - added CRC32C checksum benchmark
+ *                      - added distortion analysis benchmark
+ */
+
+#include "stegano.h"
+#include "kernels.h"
+#include "compress.h"
+#include "scatter.h"
+#include <time.h>
+
+#define REPETITIONS 20 // Number of timed runs of each kernel
+#define E2E_DENSITY 2  // Bits per channel of end-to-end runs, so raw text fits
+#define E2E_STEGO "bench.bmp" // Stego image created by end-to-end runs
+#define E2E_TEXT "bench.txt"  // Decoded text created by end-to-end runs
+#define E2E_KEY "bench"       // Passphrase of scattered end-to-end runs
+
+// Returns current time of the monotonic clock in seconds.
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Decodes characters the way decodeText() did before it used packDiffBits(),
+// one pixel per iteration with pow(). Kept as the baseline of the benchmark.
+// Returns number of characters stored in out.
+static size_t legacyDecode(const BYTE *covPx, const BYTE *stegPx,
+                           size_t charCount, BYTE *out)
+{
+    size_t decodedBit = 0; // Counter for decoded bit of 8-bit character
+    size_t decoded = 0;    // Number of decoded characters
+    int character = 0;     // ASCII decimal value of decoded character
+
+    for (size_t px = 0; px < charCount * CHAR_BIT; px++)
+    {
+        int diff = stegPx[px] - covPx[px];
+        int bit = diff >= 1;
+
+        character += (int)pow(2, 8 - (decodedBit + 1)) * bit;
+        decodedBit++;
+
+        if ((decodedBit != 0) && (decodedBit % CHAR_BIT == 0))
+        {
+            if (character <= ASCII_MIN || character > ASCII_MAX)
+            {
+                break;
+            }
+
+            out[decoded++] = character;
+            decodedBit = 0;
+            character = 0;
+        }
+    }
+
+    return decoded;
+}
+
+typedef size_t (*PACKFUNC)(const BYTE *, const BYTE *, size_t, BYTE *);
+
+// Times REPETITIONS runs of decoding kernel pack over charCount characters of
+// cover pixels covPx and stego pixels stegPx, then prints the fastest run.
+// Returns the fastest run in seconds.
+static double timeDecode(const char *name, PACKFUNC pack, const BYTE *covPx,
+                         const BYTE *stegPx, size_t charCount, BYTE *out,
+                         double baseline)
+{
+    double best = 0;
+
+    pack(covPx, stegPx, charCount, out); // Warms up caches
+
+    for (int i = 0; i < REPETITIONS; i++)
+    {
+        double start = now();
+        size_t decoded = pack(covPx, stegPx, charCount, out);
+        double elapsed = now() - start;
+
+        if (decoded != charCount)
+        {
+            fprintf(stderr, "%s decoded %zu of %zu characters\n",
+                    name, decoded, charCount);
+            exit(EXIT_FAILURE);
+        }
+        if (i == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+
+    size_t pixels = charCount * CHAR_BIT;
+    printf("%-16s %9.3f ms %8.3f ns/px %9.1f MB/s %7.1fx\n", name,
+           best * 1e3, best * 1e9 / pixels, pixels / best / 1e6,
+           baseline > 0 ? baseline / best : 1.0);
+
+    return best;
+}
+
+// Encodes with the scalar reference kernel limited to 255.
+static void embedScalar(BYTE *px, const BYTE *chars, size_t charCount)
+{
+    embedDiffBitsScalar(px, chars, charCount, UCHAR_MAX);
+}
+
+typedef void (*EMBEDFUNC)(BYTE *, const BYTE *, size_t);
+
+// Times REPETITIONS runs of encoding kernel embed of charCount characters
+// chars into a copy of cover pixels covPx stored in px, then prints the
+// fastest run. Returns the fastest run in seconds.
+static double timeEncode(const char *name, EMBEDFUNC embed, const BYTE *covPx,
+                         BYTE *px, const BYTE *chars, size_t charCount,
+                         double baseline)
+{
+    size_t pixels = charCount * CHAR_BIT;
+    double best = 0;
+
+    for (int i = 0; i <= REPETITIONS; i++) // First run warms up caches
+    {
+        memcpy(px, covPx, pixels);
+
+        double start = now();
+        embed(px, chars, charCount);
+        double elapsed = now() - start;
+
+        if (i == 1 || (i > 1 && elapsed < best))
+        {
+            best = elapsed;
+        }
+    }
+
+    printf("%-16s %9.3f ms %8.3f ns/px %9.1f MB/s %7.1fx\n", name,
+           best * 1e3, best * 1e9 / pixels, pixels / best / 1e6,
+           baseline > 0 ? baseline / best : 1.0);
+
+    return best;
+}
+
+typedef void (*GROUPEMBEDFUNC)(BYTE *, const BYTE *, size_t, int);
+typedef void (*GROUPPACKFUNC)(const BYTE *, size_t, BYTE *, int);
+
+// Times REPETITIONS runs of multi-bit kernel embed, encoding groups of
+// density characters chars into a copy of pixels covPx stored in px, or of
+// kernel pack, decoding them from covPx into chars, then prints the fastest
+// run. Each group fills groupPixels pixels. Returns the fastest run in
+// seconds.
+static double timeGroups(const char *name, GROUPEMBEDFUNC embed,
+                         GROUPPACKFUNC pack, const BYTE *covPx, BYTE *px,
+                         BYTE *chars, size_t groups, int density,
+                         size_t groupPixels, double baseline)
+{
+    size_t pixels = groups * groupPixels;
+    double best = 0;
+
+    for (int i = 0; i <= REPETITIONS; i++) // First run warms up caches
+    {
+        if (embed)
+        {
+            memcpy(px, covPx, pixels);
+        }
+
+        double start = now();
+        if (embed)
+        {
+            embed(px, chars, groups, density);
+        }
+        else
+        {
+            pack(covPx, groups, chars, density);
+        }
+        double elapsed = now() - start;
+
+        if (i == 1 || (i > 1 && elapsed < best))
+        {
+            best = elapsed;
+        }
+    }
+
+    printf("%-16s %9.3f ms %8.3f ns/px %9.1f MB/s %7.1fx\n", name,
+           best * 1e3, best * 1e9 / pixels, pixels / best / 1e6,
+           baseline > 0 ? baseline / best : 1.0);
+
+    return best;
+}
+
+typedef void (*DISTFUNC)(const BYTE *, const BYTE *, size_t, DISTORTION *);
+
+// Times REPETITIONS runs of distortion kernel measure over count cover bytes
+// covPx and stego bytes stegPx, then prints the fastest run. Stores the
+// differences in the structure pointed to by distPtr. Returns the fastest
+// run in seconds.
+static double timeDistortion(const char *name, DISTFUNC measure,
+                             const BYTE *covPx, const BYTE *stegPx,
+                             size_t count, DISTORTION *distPtr,
+                             double baseline)
+{
+    double best = 0;
+
+    for (int i = 0; i <= REPETITIONS; i++) // First run warms up caches
+    {
+        DISTORTION dist = {0, 0, 0};
+        double start = now();
+        measure(covPx, stegPx, count, &dist);
+        double elapsed = now() - start;
+        *distPtr = dist;
+
+        if (i == 1 || (i > 1 && elapsed < best))
+        {
+            best = elapsed;
+        }
+    }
+
+    printf("%-16s %9.3f ms %8.3f ns/px %9.1f MB/s %7.1fx\n", name,
+           best * 1e3, best * 1e9 / count, count / best / 1e6,
+           baseline > 0 ? baseline / best : 1.0);
+
+    return best;
+}
+
+typedef unsigned int (*CRCFUNC)(unsigned int, const BYTE *, size_t);
+
+// Times REPETITIONS runs of checksum kernel crc over length bytes data, then
+// prints the fastest run. Stores the checksum in the integer pointed to by
+// crcPtr. Returns the fastest run in seconds.
+static double timeChecksum(const char *name, CRCFUNC crc, const BYTE *data,
+                           size_t length, unsigned int *crcPtr,
+                           double baseline)
+{
+    double best = 0;
+
+    for (int i = 0; i <= REPETITIONS; i++) // First run warms up caches
+    {
+        double start = now();
+        *crcPtr = crc(0, data, length);
+        double elapsed = now() - start;
+
+        if (i == 1 || (i > 1 && elapsed < best))
+        {
+            best = elapsed;
+        }
+    }
+
+    printf("%-16s %9.3f ms %8.3f ns/B  %9.1f MB/s %7.1fx\n", name,
+           best * 1e3, best * 1e9 / length, length / best / 1e6,
+           baseline > 0 ? baseline / best : 1.0);
+
+    return best;
+}
+
+// Returns 1 if the files indicated by first and second have equal content,
+// 0 otherwise.
+static int sameFile(const char *first, const char *second)
+{
+    FILE *a = fopen(first, "rb");
+    FILE *b = fopen(second, "rb");
+    int same = a != NULL && b != NULL;
+
+    while (same)
+    {
+        int x = fgetc(a);
+        same = x == fgetc(b);
+        if (x == EOF)
+        {
+            break;
+        }
+    }
+
+    if (a != NULL)
+    {
+        fclose(a);
+    }
+    if (b != NULL)
+    {
+        fclose(b);
+    }
+    return same;
+}
+
+// Times REPETITIONS runs of compressing and decompressing the length bytes
+// of text, then prints the fastest run of each and the compression ratio.
+// Returns 0 if every run restored text.
+static int timeCodec(const BYTE *text, size_t length)
+{
+    double best[2] = {0, 0}; // Fastest compression and decompression
+    size_t packedLength = 0;
+
+    for (int i = 0; i <= REPETITIONS; i++) // First run warms up caches
+    {
+        BYTE *packed, *restored;
+        size_t restoredLength;
+
+        double start = now();
+        if (compressBytes(text, length, 0, &packed, &packedLength))
+        {
+            return ERR_ALLOC;
+        }
+        double middle = now();
+        int status = decompressBytes(packed, packedLength, &restored,
+                                     &restoredLength);
+        double end = now();
+
+        free(packed);
+        if (status)
+        {
+            return status;
+        }
+        status = restoredLength != length || memcmp(restored, text, length);
+        free(restored);
+        if (status)
+        {
+            return ERR_FORMAT;
+        }
+
+        if (i == 1 || (i > 1 && middle - start < best[0]))
+        {
+            best[0] = middle - start;
+        }
+        if (i == 1 || (i > 1 && end - middle < best[1]))
+        {
+            best[1] = end - middle;
+        }
+    }
+
+    printf("%-16s %9.3f ms %9.1f MB/s %zu -> %zu bytes (%.2fx)\n",
+           "compress", best[0] * 1e3, length / best[0] / 1e6, length,
+           packedLength, (double)length / packedLength);
+    printf("%-16s %9.3f ms %9.1f MB/s\n", "decompress", best[1] * 1e3,
+           length / best[1] / 1e6);
+
+    return 0;
+}
+
+// Times REPETITIONS runs of encoding secret text textName into cover image
+// coverName in blind mode with payload flags flags, saving E2E_STEGO, and of
+// decoding E2E_STEGO into E2E_TEXT, then prints the fastest run of each and
+// the rows written. Payload bits are scattered by key unless it is 0.
+// Returns the fastest encoding in seconds, or 0 on failure.
+static double timeEndToEnd(const char *name, const char *coverName,
+                           const char *textName, size_t length, int flags,
+                           unsigned long long key, double baseline)
+{
+    double best[2] = {0, 0}; // Fastest encoding and decoding
+    LONG rows = 0;           // Rows modified by encoding
+
+    for (int i = 0; i <= REPETITIONS; i++) // First run warms up caches
+    {
+        BMP *imgPtr = loadImage(coverName);
+        if (imgPtr == NULL)
+        {
+            return 0;
+        }
+        imgPtr->key = key;
+
+        double start = now();
+        int status = encodeText(textName, imgPtr, MODE_LSB, E2E_DENSITY,
+                                flags);
+        if (!status)
+        {
+            status = createStego(E2E_STEGO, *imgPtr);
+        }
+        double middle = now();
+        rows = imgPtr->dirtyRows;
+        freeImage(imgPtr);
+
+        // Scattered payloads are decoded from the mapped image, as
+        // decode.exe does
+        BMP *stegPtr = status ? NULL
+                              : (key ? loadImage : openImage)(E2E_STEGO);
+        if (stegPtr == NULL)
+        {
+            return 0;
+        }
+        stegPtr->key = key;
+        status = decodeBlind(*stegPtr, E2E_TEXT);
+        double end = now();
+        freeImage(stegPtr);
+        if (status)
+        {
+            return 0;
+        }
+
+        if (i == 1 || (i > 1 && middle - start < best[0]))
+        {
+            best[0] = middle - start;
+        }
+        if (i == 1 || (i > 1 && end - middle < best[1]))
+        {
+            best[1] = end - middle;
+        }
+    }
+
+    if (!sameFile(textName, E2E_TEXT))
+    {
+        fprintf(stderr, "%s decoded text differs from %s\n", name, textName);
+        return 0;
+    }
+
+    printf("%-16s %9.3f ms encode %9.3f ms decode %9.1f MB/s %6d rows "
+           "%7.1fx\n",
+           name, best[0] * 1e3, best[1] * 1e3,
+           length / (best[0] + best[1]) / 1e6, rows,
+           baseline > 0 ? baseline / (best[0] + best[1]) : 1.0);
+
+    return best[0] + best[1];
+}
+
+// Times REPETITIONS runs of permuting every channel byte of img a block at a
+// time in sorted order, as scattered encoding does, and prints the fastest.
+// Returns none.
+static void timeScatter(BMP img)
+{
+    static unsigned long long pairs[2 * SCATTER_BLOCK];
+    size_t count = (size_t)img.rowChannels * img.height;
+    double best = 0;
+    unsigned long long check = 0; // Keeps permutations from being optimized out
+
+    SCATTER scat;
+    openScatter(&scat, scatterKey(E2E_KEY), count);
+    for (int i = 0; i <= REPETITIONS; i++) // First run warms up caches
+    {
+        double start = now();
+        for (size_t first = 0; first < count; first += SCATTER_BLOCK)
+        {
+            size_t n = count - first < SCATTER_BLOCK ? count - first
+                                                     : SCATTER_BLOCK;
+            scatterBlock(&scat, first, n, pairs);
+            check += pairs[0];
+        }
+        double elapsed = now() - start;
+        if (i == 1 || (i > 1 && elapsed < best))
+        {
+            best = elapsed;
+        }
+    }
+
+    printf("%-16s %9.3f ms %9.1f M indices/s %9.2f ns/index (%llx)\n",
+           "permutation", best * 1e3, count / best / 1e6, best / count * 1e9,
+           check & 0xf);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *fname = argc > 1 ? argv[1] : "assets/sunset.bmp";
+
+    BMP *imagePtr = loadImage(fname); // Pixel array used as cover pixels
+    if (imagePtr == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Builds cover and stego pixels holding text over the whole pixel array
+    size_t charCount = imagePtr->pxArrSize / CHAR_BIT;
+    size_t pixels = charCount * CHAR_BIT;
+    BYTE *covPx = malloc(pixels);
+    BYTE *stegPx = malloc(pixels);
+    BYTE *out = malloc(charCount);
+    if (covPx == NULL || stegPx == NULL || out == NULL)
+    {
+        fprintf(stderr, "%s", "malloc() failed: no memory for benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    for (size_t px = 0; px < pixels; px++)
+    {
+        // Keeps cover pixels away from the limits so no bit is clamped
+        BYTE value = imagePtr->pxArr[px];
+        covPx[px] = value < 1 ? 1 : value > 254 ? 254 : value;
+
+        char character = 'a' + (px / CHAR_BIT) % 26;
+        int bit = (character >> (CHAR_BIT - 1 - px % CHAR_BIT)) & 1;
+        stegPx[px] = bit ? covPx[px] + 1 : covPx[px] - 1;
+    }
+
+    printf("decode kernels on %s (%zu pixels, %s)\n", fname, pixels,
+           kernelName());
+    double baseline = timeDecode("legacy pow()", legacyDecode, covPx, stegPx,
+                                 charCount, out, 0);
+    timeDecode("scalar", packDiffBitsScalar, covPx, stegPx, charCount, out,
+               baseline);
+    double decodeTime = timeDecode(kernelName(), packDiffBits, covPx, stegPx,
+                                   charCount, out, baseline);
+
+    // Checksums the text just decoded, as decoding does with its trailer,
+    // checking the hardware kernel against slicing-by-8
+    unsigned int expected, crc;
+    printf("\nchecksum kernels on %zu decoded bytes\n", charCount);
+    baseline = timeChecksum("slicing-by-8", crc32cScalar, out, charCount,
+                            &expected, 0);
+    double checkTime = timeChecksum("dispatched", crc32c, out, charCount,
+                                    &crc, baseline);
+    if (crc != expected)
+    {
+        fprintf(stderr, "%s", "hardware checksum differs from scalar\n");
+        return EXIT_FAILURE;
+    }
+    printf("%-16s %9.1f %% of %s decoding\n", "checksum cost",
+           checkTime / decodeTime * 100, kernelName());
+
+    // Measures distortion of the stego pixels against the cover pixels, as
+    // analyze.exe does, checking the vector kernel against the scalar one
+    DISTORTION expectedDist, dist;
+    printf("\ndistortion kernels on %s (%zu pixels, %s)\n", fname, pixels,
+           kernelName());
+    baseline = timeDistortion("scalar", measureDistortionScalar, covPx,
+                              stegPx, pixels, &expectedDist, 0);
+    timeDistortion(kernelName(), measureDistortion, covPx, stegPx, pixels,
+                   &dist, baseline);
+    if (dist.squares != expectedDist.squares ||
+        dist.changed != expectedDist.changed ||
+        dist.maxDelta != expectedDist.maxDelta)
+    {
+        fprintf(stderr, "%s", "vector distortion differs from scalar\n");
+        return EXIT_FAILURE;
+    }
+
+    // Encodes text over the cover pixels with some pixels set to 0 and 255,
+    // where the vector kernel must saturate exactly like the scalar one
+    BYTE *refPx = malloc(pixels);
+    if (refPx == NULL)
+    {
+        fprintf(stderr, "%s", "malloc() failed: no memory for benchmark\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < charCount; i++)
+    {
+        out[i] = 'a' + i % 26;
+    }
+    for (size_t px = 0; px < pixels; px += 97)
+    {
+        covPx[px] = px % 2 ? 0 : UCHAR_MAX;
+    }
+
+    printf("\nencode kernels on %s (%zu pixels, %s)\n", fname, pixels,
+           kernelName());
+    baseline = timeEncode("scalar", embedScalar, covPx, refPx, out,
+                          charCount, 0);
+    timeEncode(kernelName(), embedDiffBits, covPx, stegPx, out, charCount,
+               baseline);
+    if (memcmp(refPx, stegPx, pixels))
+    {
+        fprintf(stderr, "%s", "vector encoding differs from scalar\n");
+        return EXIT_FAILURE;
+    }
+
+    // Encodes and decodes groups of density characters, which fill 8 pixels
+    // each, checking the deposit and extract kernels against scalar ones
+    BYTE *chars = malloc(charCount);
+    if (chars == NULL)
+    {
+        fprintf(stderr, "%s", "malloc() failed: no memory for benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("\nmulti-bit kernels on %s (%zu pixels, %s)\n", fname, pixels,
+           kernelName());
+    for (int density = 1; density <= DENSITY_MAX; density++)
+    {
+        size_t groups = charCount / density;
+        char name[32];
+
+        snprintf(name, sizeof(name), "embed %d scalar", density);
+        baseline = timeGroups(name, embedLsbGroupsScalar, NULL, covPx, refPx,
+                              out, groups, density, CHAR_BIT, 0);
+        snprintf(name, sizeof(name), "embed %d %s", density,
+                 lsbGroupsKernelName(density));
+        timeGroups(name, embedLsbGroups, NULL, covPx, stegPx, out, groups,
+                   density, CHAR_BIT, baseline);
+        if (memcmp(refPx, stegPx, groups * CHAR_BIT))
+        {
+            fprintf(stderr, "%s", "vector embedding differs from scalar\n");
+            return EXIT_FAILURE;
+        }
+
+        snprintf(name, sizeof(name), "extract %d scalar", density);
+        baseline = timeGroups(name, NULL, packLsbGroupsScalar, stegPx, NULL,
+                              chars, groups, density, CHAR_BIT, 0);
+        snprintf(name, sizeof(name), "extract %d %s", density,
+                 lsbGroupsKernelName(density));
+        timeGroups(name, NULL, packLsbGroups, stegPx, NULL, chars, groups,
+                   density, CHAR_BIT, baseline);
+        if (memcmp(chars, out, groups * density))
+        {
+            fprintf(stderr, "%s", "vector extraction differs from text\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Encodes and decodes groups of k characters in Hamming blocks of 2^k-1
+    // pixels, counting the pixels changed per bit of text against the
+    // one-in-two of 1-bit embedding
+    printf("\nHamming kernels on %s (%zu pixels, %s)\n", fname, pixels,
+           kernelName());
+    for (int k = 2; k <= HAMMING_MAX; k++)
+    {
+        size_t groupPixels = (size_t)HAMMING_PIXELS(k) * CHAR_BIT;
+        size_t groups = pixels / groupPixels;
+        char name[32];
+
+        snprintf(name, sizeof(name), "embed %d scalar", k);
+        baseline = timeGroups(name, embedHammingGroupsScalar, NULL, covPx,
+                              refPx, out, groups, k, groupPixels, 0);
+        snprintf(name, sizeof(name), "embed %d %s", k,
+                 hammingKernelName(k));
+        timeGroups(name, embedHammingGroups, NULL, covPx, stegPx, out, groups,
+                   k, groupPixels, baseline);
+        if (memcmp(refPx, stegPx, groups * groupPixels))
+        {
+            fprintf(stderr, "%s", "vector embedding differs from scalar\n");
+            return EXIT_FAILURE;
+        }
+
+        snprintf(name, sizeof(name), "extract %d scalar", k);
+        baseline = timeGroups(name, NULL, packHammingGroupsScalar, stegPx,
+                              NULL, chars, groups, k, groupPixels, 0);
+        snprintf(name, sizeof(name), "extract %d %s", k,
+                 hammingKernelName(k));
+        timeGroups(name, NULL, packHammingGroups, stegPx, NULL, chars, groups,
+                   k, groupPixels, baseline);
+        if (memcmp(chars, out, groups * k))
+        {
+            fprintf(stderr, "%s", "vector extraction differs from text\n");
+            return EXIT_FAILURE;
+        }
+
+        size_t changed = 0;
+        for (size_t px = 0; px < groups * groupPixels; px++)
+        {
+            changed += refPx[px] != covPx[px];
+        }
+        printf("%-16s %9.3f changed px/bit %6.2f bits/px\n", "changes",
+               (double)changed / (groups * k * CHAR_BIT),
+               (double)k / HAMMING_PIXELS(k));
+    }
+    free(chars);
+    free(refPx);
+
+    free(covPx);
+    free(stegPx);
+    free(out);
+
+    printf("\nkeyed permutation of %s\n", fname);
+    timeScatter(*imagePtr);
+    freeImage(imagePtr);
+
+    // Compares encoding and decoding of secret text with and without
+    // compression or scattering, from reading the text to writing the
+    // decoded file
+    if (argc > 2)
+    {
+        FILE *textFile = fopen(argv[2], "rb");
+        if (textFile == NULL)
+        {
+            fprintf(stderr, "%s could not be opened\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        fseek(textFile, 0, SEEK_END);
+        size_t length = ftell(textFile);
+        rewind(textFile);
+        BYTE *text = malloc(length ? length : 1);
+        if (text == NULL || fread(text, 1, length, textFile) != length)
+        {
+            fprintf(stderr, "%s could not be read\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        fclose(textFile);
+
+        printf("\ncompression of %s\n", argv[2]);
+        if (timeCodec(text, length))
+        {
+            fprintf(stderr, "%s", "decompressed text differs from text\n");
+            return EXIT_FAILURE;
+        }
+        free(text);
+
+        printf("\nend-to-end on %s at %d bits per channel\n", fname,
+               E2E_DENSITY);
+        baseline = timeEndToEnd("raw", fname, argv[2], length, 0, 0, 0);
+        double compressed = timeEndToEnd("compressed", fname, argv[2], length,
+                                         PAYLOAD_COMPRESSED, 0, baseline);
+        double scattered = timeEndToEnd("scattered", fname, argv[2], length,
+                                        0, scatterKey(E2E_KEY), baseline);
+        remove(E2E_STEGO);
+        remove(E2E_TEXT);
+        if (baseline == 0 || compressed == 0 || scattered == 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*
+ *  Filename:
+ *      client.c
+ *
+ *  Purpose:
+ *      To send encoding and decoding jobs to the stego daemon over a Unix
+ *      socket, taking the same options and filenames as encode.exe and
+ *      decode.exe in batch mode.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - sent scattering key with each job
+ *                      - listed --hamming option in usage
+ */
+
+#include "server.h"
+#include <errno.h>
+
+static const char *socketPath = NULL; // Socket the daemon listens at
+static char workDir[PATH_MAX];        // Directory relative filenames are in
+
+// Sends the job pointed to by jobPtr as a request of operation op to the
+// daemon and waits for its reply. Returns the status of the job.
+static int sendJob(const JOB *jobPtr, const char *op)
+{
+    // Filenames holding field or line separators cannot be sent
+    const char *names[] = {jobPtr->first, jobPtr->second, jobPtr->third,
+                           workDir};
+    for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++)
+    {
+        if (strpbrk(names[i], "\t\n") != NULL)
+        {
+            fprintf(stderr, "invalid filename: %s holds a tab or newline\n",
+                    names[i]);
+            return ERR_FILENAME;
+        }
+    }
+
+    char request[REQUEST_MAX];
+    int length = snprintf(request, sizeof(request),
+                          "%s\t%s\t%d\t%d\t%d\t%llx\t%s\t%s\t%s\n", op,
+                          workDir, jobPtr->mode, jobPtr->density,
+                          jobPtr->flags, jobPtr->key, jobPtr->first,
+                          jobPtr->second, jobPtr->third);
+    if (length < 0 || (size_t)length >= sizeof(request))
+    {
+        fprintf(stderr, "%s", "invalid request: filenames are too long\n");
+        return ERR_FILENAME;
+    }
+
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socketPath);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        fprintf(stderr, "connect() failed: no daemon listens at %s\n",
+                socketPath);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return ERR_OPEN;
+    }
+
+    // Sends whole request, then reads the reply until the daemon hangs up
+    int status = ERR_WRITE;
+    if (write(fd, request, length) == length)
+    {
+        char reply[REPLY_MAX];
+        size_t got = 0;
+        ssize_t count;
+        while (got < sizeof(reply) - 1 &&
+               ((count = read(fd, reply + got, sizeof(reply) - 1 - got)) > 0 ||
+                (count < 0 && errno == EINTR)))
+        {
+            got += count > 0 ? count : 0;
+        }
+        reply[got] = '\0';
+        status = got > 0 ? atoi(reply) : ERR_FORMAT;
+    }
+    close(fd);
+
+    return status;
+}
+
+// Encodes the secret text of jobPtr on the daemon. Returns 0 on success.
+static int encodeJob(const JOB *jobPtr)
+{
+    return sendJob(jobPtr, REQUEST_ENCODE);
+}
+
+// Decodes the secret text of jobPtr on the daemon. Returns 0 on success.
+static int decodeJob(const JOB *jobPtr)
+{
+    return sendJob(jobPtr, REQUEST_DECODE);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *encodeUsage = "[-j N] [-b] [-d K] [-H K] [-z] [-k KEY] "
+                              "[-m MANIFEST|-] "
+                              "[COVER.bmp SECRET.txt STEGO.bmp]...";
+    const char *decodeUsage = "[-j N] [-k KEY] [-m MANIFEST|-] "
+                              "[COVER.bmp|- STEGO.bmp DECODED.txt]...";
+
+    if (argc < 3 || (strcmp(argv[2], REQUEST_ENCODE) &&
+                     strcmp(argv[2], REQUEST_DECODE)))
+    {
+        fprintf(stderr, "usage: %s SOCKET encode %s\n"
+                        "       %s SOCKET decode %s\n",
+                argv[0], encodeUsage, argv[0], decodeUsage);
+        return EXIT_FAILURE;
+    }
+
+    socketPath = argv[1];
+    if (getcwd(workDir, sizeof(workDir)) == NULL)
+    {
+        fprintf(stderr, "%s", "getcwd() failed: working directory is "
+                              "unknown\n");
+        return EXIT_FAILURE;
+    }
+
+    // Runs jobs as the batch mode of encode.exe or decode.exe does, with
+    // the operation in place of the program name
+    if (!strcmp(argv[2], REQUEST_ENCODE))
+    {
+        return runBatch(argc - 2, argv + 2, encodeJob, NULL, NULL,
+                        encodeUsage);
+    }
+    return runBatch(argc - 2, argv + 2, decodeJob, NULL, NULL,
+                    decodeUsage);
+}
@@ -0,0 +1,752 @@
+/*
+ *  Filename:
+ *      compress.c
+ *
+ *  Purpose:
+ *      To define a self-contained LZ77 and Huffman codec for secret text.
+ *      Repeated strings are replaced by length and distance pairs found with
+ *      hash chains, then literals, lengths and distances are written with
+ *      canonical Huffman codes rebuilt for every block, as in DEFLATE.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ */
+
+#include "compress.h"
+
+#define HASH_BITS 15               // Bits of the hash of 3 bytes
+#define HASH_SIZE (1 << HASH_BITS) // Number of hash chains
+#define MAX_CHAIN 32               // Most earlier positions tried per match
+#define LAZY_LIMIT 32              // Matches this long are taken at once
+#define END_OF_BLOCK 256           // Literal and length code ending a block
+#define TABLE_SIZE (1 << HUFF_MAX_BITS) // Entries of a decoding table
+
+// Base and extra bits of length codes 257 to 285
+static const WORD lengthBase[29] = {3,   4,   5,   6,   7,  8,  9,  10,
+                                    11,  13,  15,  17,  19, 23, 27, 31,
+                                    35,  43,  51,  59,  67, 83, 99, 115,
+                                    131, 163, 195, 227, 258};
+static const BYTE lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                     1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                     4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Base and extra bits of distance codes 0 to 29
+static const WORD distBase[30] = {1,    2,    3,    4,     5,     7,
+                                  9,    13,   17,   25,    33,    49,
+                                  65,   97,   129,  193,   257,   385,
+                                  513,  769,  1025, 1537,  2049,  3073,
+                                  4097, 6145, 8193, 12289, 16385, 24577};
+static const BYTE distExtra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                   4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                   9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+struct token      // Structure representing a literal or a repeated string
+{
+    WORD value;   // Literal byte, or length of repeated string
+    WORD dist;    // Distance back to repeated string, or 0 for a literal
+};
+
+struct matcher                 // Structure representing hash chains of input
+{
+    const BYTE *in;            // Input being compressed
+    size_t length;             // Number of bytes of input
+    long long head[HASH_SIZE]; // Latest position of each hash, or -1
+    long long prev[LZ_WINDOW]; // Earlier position with the same hash, or -1
+};
+
+struct bitWriter      // Structure representing compressed output
+{
+    BYTE *out;        // Output written so far
+    size_t length;    // Number of bytes of output
+    size_t capacity;  // Number of bytes the output can hold
+    uint64_t bits;    // Bits not yet stored in output, first bit lowest
+    unsigned count;   // Number of bits held in bits
+    int failed;       // Nonzero if the output could not grow
+};
+
+struct bitReader      // Structure representing compressed input
+{
+    const BYTE *in;   // Compressed input
+    size_t length;    // Number of bytes of input
+    size_t next;      // Index of next byte not yet held in bits
+    uint64_t bits;    // Bits not yet consumed, first bit lowest
+    unsigned count;   // Number of bits held in bits
+};
+
+// Returns hash of the 3 bytes pointed to by p.
+static unsigned hash3(const BYTE *p)
+{
+    DWORD key = (DWORD)p[0] << 16 | (DWORD)p[1] << 8 | p[2];
+    return (key * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Adds position pos of the input of the matcher pointed to by mPtr to its
+// hash chain. Returns none.
+static void insertString(struct matcher *mPtr, size_t pos)
+{
+    if (pos + LZ_MIN_MATCH <= mPtr->length)
+    {
+        unsigned hash = hash3(mPtr->in + pos);
+        mPtr->prev[pos & (LZ_WINDOW - 1)] = mPtr->head[hash];
+        mPtr->head[hash] = pos;
+    }
+}
+
+// Returns number of equal leading bytes of a and b, up to limit.
+static size_t matchLength(const BYTE *a, const BYTE *b, size_t limit)
+{
+    size_t length = 0;
+
+    // Compares 8 bytes at a time; the lowest differing byte ends the match
+    while (length + 8 <= limit)
+    {
+        uint64_t x, y;
+        memcpy(&x, a + length, 8);
+        memcpy(&y, b + length, 8);
+        if (x != y)
+        {
+            return length + __builtin_ctzll(x ^ y) / CHAR_BIT;
+        }
+        length += 8;
+    }
+
+    while (length < limit && a[length] == b[length])
+    {
+        length++;
+    }
+
+    return length;
+}
+
+// Finds the longest earlier string within LZ_WINDOW bytes that repeats the
+// input of the matcher pointed to by mPtr at position pos, following at most
+// MAX_CHAIN positions of its hash chain. Stores its distance in the integer
+// pointed to by distPtr. Returns its length, or 0 if none is long enough.
+static size_t findMatch(const struct matcher *mPtr, size_t pos,
+                        size_t *distPtr)
+{
+    size_t limit = mPtr->length - pos < LZ_MAX_MATCH ? mPtr->length - pos
+                                                     : LZ_MAX_MATCH;
+    if (limit < LZ_MIN_MATCH)
+    {
+        return 0;
+    }
+
+    const BYTE *cur = mPtr->in + pos;
+    size_t best = LZ_MIN_MATCH - 1;
+    long long cand = mPtr->head[hash3(cur)];
+
+    for (int chain = MAX_CHAIN;
+         cand >= 0 && pos - cand <= LZ_WINDOW && chain > 0; chain--)
+    {
+        const BYTE *old = mPtr->in + cand;
+
+        // Skips candidates that cannot beat the best match
+        if (old[best] == cur[best] && old[0] == cur[0])
+        {
+            size_t length = matchLength(old, cur, limit);
+            if (length > best)
+            {
+                best = length;
+                *distPtr = pos - cand;
+                if (length == limit)
+                {
+                    break;
+                }
+            }
+        }
+
+        // Stops at a slot already reused by a later position
+        long long next = mPtr->prev[cand & (LZ_WINDOW - 1)];
+        if (next >= cand)
+        {
+            break;
+        }
+        cand = next;
+    }
+
+    return best >= LZ_MIN_MATCH ? best : 0;
+}
+
+// Returns literal and length code of a repeated string of length bytes.
+static unsigned lengthSymbol(unsigned length)
+{
+    unsigned x = length - LZ_MIN_MATCH;
+
+    if (length == LZ_MAX_MATCH)
+    {
+        return 285;
+    }
+    if (x < 8)
+    {
+        return 257 + x;
+    }
+
+    // Each power of 2 holds 4 codes told apart by the next 2 bits
+    int log2 = 31 - __builtin_clz(x);
+    return 257 + 4 * (log2 - 1) + ((x >> (log2 - 2)) & 3);
+}
+
+// Returns distance code of a repeated string dist bytes back.
+static unsigned distSymbol(unsigned dist)
+{
+    unsigned x = dist - 1;
+
+    if (x < 4)
+    {
+        return x;
+    }
+
+    // Each power of 2 holds 2 codes told apart by the next bit
+    int log2 = 31 - __builtin_clz(x);
+    return 2 * log2 + ((x >> (log2 - 1)) & 1);
+}
+
+// Stores in lengths the Huffman code length of each of the n symbols with
+// frequencies freq, at most HUFF_MAX_BITS bits long. Unused symbols get
+// length 0 and a lone used symbol gets length 1. Returns none.
+static void buildLengths(const size_t *freq, int n, BYTE *lengths)
+{
+    size_t weight[2 * LITLEN_CODES]; // Weight of leaves, then of tree nodes
+    int parent[2 * LITLEN_CODES];    // Parent node of each node
+    int depth[2 * LITLEN_CODES];     // Depth of each node in the tree
+    int active[LITLEN_CODES];        // Nodes not yet given a parent
+    int shift = 0;                   // Halvings of frequencies so far
+
+    for (;;)
+    {
+        int activeCount = 0;
+        int nodes = n; // Leaves are nodes 0 to n - 1
+
+        memset(lengths, 0, n);
+        for (int i = 0; i < n; i++)
+        {
+            if (freq[i])
+            {
+                // Halving keeps rare symbols above 0 while flattening the tree
+                weight[i] = (freq[i] >> shift) | 1;
+                active[activeCount++] = i;
+            }
+        }
+
+        if (activeCount == 0)
+        {
+            return;
+        }
+        if (activeCount == 1)
+        {
+            lengths[active[0]] = 1;
+            return;
+        }
+
+        // Joins the two lightest nodes until one tree is left
+        while (activeCount > 1)
+        {
+            int a = 0, b = 1; // Indexes in active of two lightest nodes
+            if (weight[active[b]] < weight[active[a]])
+            {
+                a = 1;
+                b = 0;
+            }
+            for (int i = 2; i < activeCount; i++)
+            {
+                if (weight[active[i]] < weight[active[a]])
+                {
+                    b = a;
+                    a = i;
+                }
+                else if (weight[active[i]] < weight[active[b]])
+                {
+                    b = i;
+                }
+            }
+
+            weight[nodes] = weight[active[a]] + weight[active[b]];
+            parent[active[a]] = nodes;
+            parent[active[b]] = nodes;
+            active[a] = nodes++;
+            active[b] = active[--activeCount];
+        }
+
+        // Parents are created after their children, so depths are found
+        // from the root down
+        int maxDepth = 0;
+        depth[nodes - 1] = 0;
+        for (int i = nodes - 2; i >= 0; i--)
+        {
+            if (i < n && !freq[i])
+            {
+                continue;
+            }
+            depth[i] = depth[parent[i]] + 1;
+            if (i < n)
+            {
+                lengths[i] = depth[i];
+                maxDepth = depth[i] > maxDepth ? depth[i] : maxDepth;
+            }
+        }
+
+        if (maxDepth <= HUFF_MAX_BITS)
+        {
+            return;
+        }
+        shift++;
+    }
+}
+
+// Stores in codes the canonical Huffman code of each of the n symbols with
+// code lengths lengths, bit-reversed so its first bit is lowest. Returns 1 if
+// the codes fit in HUFF_MAX_BITS bits, 0 if the lengths are oversubscribed.
+static int buildCodes(const BYTE *lengths, int n, WORD *codes)
+{
+    unsigned count[HUFF_MAX_BITS + 1] = {0}; // Codes of each length
+    unsigned next[HUFF_MAX_BITS + 1];        // Next code of each length
+    unsigned code = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        count[lengths[i]]++;
+    }
+    count[0] = 0;
+
+    for (int bits = 1; bits <= HUFF_MAX_BITS; bits++)
+    {
+        code = (code + count[bits - 1]) << 1;
+        next[bits] = code;
+        if (next[bits] + count[bits] > (1u << bits))
+        {
+            return 0;
+        }
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        int bits = lengths[i];
+        unsigned value = bits ? next[bits]++ : 0;
+        unsigned reversed = 0;
+
+        for (int j = 0; j < bits; j++)
+        {
+            reversed = (reversed << 1) | ((value >> j) & 1);
+        }
+        codes[i] = reversed;
+    }
+
+    return 1;
+}
+
+// Appends the lowest n bits of value, at most 32, to the output of the
+// writer pointed to by wPtr, growing the output as needed. Returns none.
+static void putBits(struct bitWriter *wPtr, unsigned value, unsigned n)
+{
+    wPtr->bits |= (uint64_t)value << wPtr->count;
+    wPtr->count += n;
+
+    if (wPtr->count >= 32)
+    {
+        if (wPtr->length + 4 > wPtr->capacity && !wPtr->failed)
+        {
+            BYTE *bigger = realloc(wPtr->out, wPtr->capacity * 2);
+            if (bigger == NULL)
+            {
+                wPtr->failed = 1;
+            }
+            else
+            {
+                wPtr->out = bigger;
+                wPtr->capacity *= 2;
+            }
+        }
+        if (!wPtr->failed)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                wPtr->out[wPtr->length++] = (BYTE)(wPtr->bits >> (i * 8));
+            }
+        }
+        wPtr->bits >>= 32;
+        wPtr->count -= 32;
+    }
+}
+
+// Appends the bits held by the writer pointed to by wPtr to its output,
+// padding the last byte with 0 bits. Returns none.
+static void flushBits(struct bitWriter *wPtr)
+{
+    // Pads to a multiple of 32 bits, then drops the bytes that only pad
+    unsigned bytes = (wPtr->count + 7) / 8;
+    size_t length = wPtr->length;
+
+    putBits(wPtr, 0, 32 - wPtr->count);
+    if (!wPtr->failed)
+    {
+        wPtr->length = length + bytes;
+    }
+}
+
+// Writes count tokens as one block of the writer pointed to by wPtr: a bit
+// that is 1 if final is nonzero, the 4-bit Huffman code lengths of every
+// literal and length code and every distance code, then the coded tokens
+// and END_OF_BLOCK. Returns none.
+static void writeBlock(struct bitWriter *wPtr, const struct token *tokens,
+                       size_t count, int final)
+{
+    size_t litFreq[LITLEN_CODES] = {0};
+    size_t distFreq[DIST_CODES] = {0};
+    BYTE litLengths[LITLEN_CODES], distLengths[DIST_CODES];
+    WORD litCodes[LITLEN_CODES], distCodes[DIST_CODES];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (tokens[i].dist)
+        {
+            litFreq[lengthSymbol(tokens[i].value)]++;
+            distFreq[distSymbol(tokens[i].dist)]++;
+        }
+        else
+        {
+            litFreq[tokens[i].value]++;
+        }
+    }
+    litFreq[END_OF_BLOCK]++;
+
+    buildLengths(litFreq, LITLEN_CODES, litLengths);
+    buildLengths(distFreq, DIST_CODES, distLengths);
+    buildCodes(litLengths, LITLEN_CODES, litCodes);
+    buildCodes(distLengths, DIST_CODES, distCodes);
+
+    putBits(wPtr, final != 0, 1);
+    for (int i = 0; i < LITLEN_CODES; i++)
+    {
+        putBits(wPtr, litLengths[i], 4);
+    }
+    for (int i = 0; i < DIST_CODES; i++)
+    {
+        putBits(wPtr, distLengths[i], 4);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned value = tokens[i].value;
+
+        if (tokens[i].dist == 0)
+        {
+            putBits(wPtr, litCodes[value], litLengths[value]);
+            continue;
+        }
+
+        unsigned symbol = lengthSymbol(value);
+        putBits(wPtr, litCodes[symbol], litLengths[symbol]);
+        putBits(wPtr, value - lengthBase[symbol - 257],
+                lengthExtra[symbol - 257]);
+
+        symbol = distSymbol(tokens[i].dist);
+        putBits(wPtr, distCodes[symbol], distLengths[symbol]);
+        putBits(wPtr, tokens[i].dist - distBase[symbol], distExtra[symbol]);
+    }
+
+    putBits(wPtr, litCodes[END_OF_BLOCK], litLengths[END_OF_BLOCK]);
+}
+
+// Compresses the first length bytes of in into allocated memory after
+// reserve bytes left for the caller: the 8-byte little-endian length of in,
+// followed by blocks of at most BLOCK_TOKENS literals and repeated strings.
+// Stores pointer to the memory in the pointer pointed to by outPtr and number
+// of compressed bytes, excluding reserve, in the integer pointed to by
+// lengthPtr. Returns 0 on success or ERR_ALLOC.
+int compressBytes(const BYTE *in, size_t length, size_t reserve,
+                  BYTE **outPtr, size_t *lengthPtr)
+{
+    struct matcher *mPtr = malloc(sizeof(*mPtr));
+    struct token *tokens = malloc(BLOCK_TOKENS * sizeof(*tokens));
+    size_t capacity = reserve + 8 + length / 2 + BUFSIZ; // Grows if needed
+    struct bitWriter w = {malloc(capacity), reserve + 8, capacity, 0, 0, 0};
+
+    if (mPtr == NULL || tokens == NULL || w.out == NULL)
+    {
+        free(mPtr);
+        free(tokens);
+        free(w.out);
+        return ERR_ALLOC;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        w.out[reserve + i] = (BYTE)((unsigned long long)length >> (i * 8));
+    }
+
+    mPtr->in = in;
+    mPtr->length = length;
+    memset(mPtr->head, 0xff, sizeof(mPtr->head)); // Sets every position to -1
+
+    size_t count = 0; // Tokens of current block
+    size_t pos = 0;   // Position of next byte to be compressed
+
+    while (pos < length)
+    {
+        // Leaves room for the literals of lazy matching
+        if (count + LZ_MAX_MATCH + 1 > BLOCK_TOKENS)
+        {
+            writeBlock(&w, tokens, count, 0);
+            count = 0;
+        }
+
+        size_t dist = 0;
+        size_t matchLen = findMatch(mPtr, pos, &dist);
+        insertString(mPtr, pos);
+
+        // Emits a literal instead if the next position has a longer match
+        while (matchLen && matchLen < LAZY_LIMIT)
+        {
+            size_t nextDist = 0;
+            size_t nextLen = findMatch(mPtr, pos + 1, &nextDist);
+            if (nextLen <= matchLen)
+            {
+                break;
+            }
+
+            tokens[count++] = (struct token){in[pos], 0};
+            insertString(mPtr, ++pos);
+            matchLen = nextLen;
+            dist = nextDist;
+        }
+
+        if (matchLen)
+        {
+            tokens[count++] = (struct token){matchLen, dist};
+            for (size_t i = 1; i < matchLen; i++)
+            {
+                insertString(mPtr, pos + i);
+            }
+            pos += matchLen;
+        }
+        else
+        {
+            tokens[count++] = (struct token){in[pos], 0};
+            pos++;
+        }
+    }
+
+    writeBlock(&w, tokens, count, 1);
+    flushBits(&w);
+
+    free(mPtr);
+    free(tokens);
+
+    if (w.failed)
+    {
+        free(w.out);
+        return ERR_ALLOC;
+    }
+
+    *outPtr = w.out;
+    *lengthPtr = w.length - reserve;
+    return 0;
+}
+
+// Fills the bits of the reader pointed to by rPtr with the next bytes of its
+// input until it holds at least 57 bits or the input ends. Returns none.
+static void refillBits(struct bitReader *rPtr)
+{
+    while (rPtr->count <= 56 && rPtr->next < rPtr->length)
+    {
+        rPtr->bits |= (uint64_t)rPtr->in[rPtr->next++] << rPtr->count;
+        rPtr->count += 8;
+    }
+}
+
+// Consumes n bits, at most 16, of the reader pointed to by rPtr and stores
+// them in the integer pointed to by valuePtr. Returns 0 on success or
+// ERR_FORMAT if the input ended.
+static int getBits(struct bitReader *rPtr, unsigned n, unsigned *valuePtr)
+{
+    if (rPtr->count < n)
+    {
+        return ERR_FORMAT;
+    }
+
+    *valuePtr = rPtr->bits & ((1u << n) - 1);
+    rPtr->bits >>= n;
+    rPtr->count -= n;
+    return 0;
+}
+
+// Consumes one Huffman code of the reader pointed to by rPtr using decoding
+// table table and stores its symbol in the integer pointed to by symbolPtr.
+// Returns 0 on success or ERR_FORMAT for an unused code or ended input.
+static int getSymbol(struct bitReader *rPtr, const WORD *table,
+                     unsigned *symbolPtr)
+{
+    WORD entry = table[rPtr->bits & (TABLE_SIZE - 1)];
+    unsigned bits = entry & 0xf; // Code length; 0 if code is unused
+
+    if (bits == 0 || bits > rPtr->count)
+    {
+        return ERR_FORMAT;
+    }
+
+    *symbolPtr = entry >> 4;
+    rPtr->bits >>= bits;
+    rPtr->count -= bits;
+    return 0;
+}
+
+// Fills decoding table table of TABLE_SIZE entries for the n symbols with
+// code lengths lengths. Each entry indexed by the next HUFF_MAX_BITS bits
+// holds the symbol of the code they start with, shifted left by 4, and its
+// length. Returns 0 on success or ERR_FORMAT if the lengths are
+// oversubscribed.
+static int buildTable(const BYTE *lengths, int n, WORD *table)
+{
+    WORD codes[LITLEN_CODES];
+
+    if (!buildCodes(lengths, n, codes))
+    {
+        return ERR_FORMAT;
+    }
+
+    memset(table, 0, TABLE_SIZE * sizeof(*table));
+    for (int i = 0; i < n; i++)
+    {
+        // Fills every entry whose low bits are the code
+        for (unsigned index = codes[i]; lengths[i] && index < TABLE_SIZE;
+             index += 1u << lengths[i])
+        {
+            table[index] = (WORD)(i << 4 | lengths[i]);
+        }
+    }
+
+    return 0;
+}
+
+// Decompresses the length bytes of in, written by compressBytes(), into
+// allocated memory. Stores pointer to the memory in the pointer pointed to
+// by outPtr and number of decompressed bytes in the integer pointed to by
+// lengthPtr. Returns 0 on success, ERR_FORMAT if in is malformed or
+// ERR_ALLOC.
+int decompressBytes(const BYTE *in, size_t length, BYTE **outPtr,
+                    size_t *lengthPtr)
+{
+    if (length < 8)
+    {
+        return ERR_FORMAT;
+    }
+
+    unsigned long long total = 0; // Number of decompressed bytes
+    for (int i = 7; i >= 0; i--)
+    {
+        total = (total << 8) | in[i];
+    }
+
+    // Rejects lengths that no stream of this size can reach: every 2 bits
+    // yield at most one repeated string
+    if (total / LZ_MAX_MATCH > (length - 8) * 4)
+    {
+        return ERR_FORMAT;
+    }
+
+    BYTE *out = malloc(total ? total : 1);
+    WORD *litTable = malloc(2 * TABLE_SIZE * sizeof(*litTable));
+    WORD *distTable = litTable + TABLE_SIZE;
+    if (out == NULL || litTable == NULL)
+    {
+        free(out);
+        free(litTable);
+        return ERR_ALLOC;
+    }
+
+    struct bitReader r = {in, length, 8, 0, 0};
+    size_t produced = 0; // Number of decompressed bytes so far
+    unsigned final = 0;  // Nonzero once the last block is read
+    int status = 0;
+
+    while (!final && !status)
+    {
+        BYTE lengths[LITLEN_CODES + DIST_CODES];
+
+        refillBits(&r);
+        status = getBits(&r, 1, &final);
+        for (int i = 0; i < LITLEN_CODES + DIST_CODES && !status; i++)
+        {
+            unsigned bits;
+            refillBits(&r);
+            status = getBits(&r, 4, &bits);
+            lengths[i] = bits;
+        }
+        if (!status)
+        {
+            status = buildTable(lengths, LITLEN_CODES, litTable);
+        }
+        if (!status)
+        {
+            status = buildTable(lengths + LITLEN_CODES, DIST_CODES, distTable);
+        }
+
+        // Decodes tokens until END_OF_BLOCK
+        while (!status)
+        {
+            unsigned symbol, extra, dsymbol, dextra;
+
+            refillBits(&r); // Holds enough bits for a whole token
+            status = getSymbol(&r, litTable, &symbol);
+            if (status || symbol == END_OF_BLOCK)
+            {
+                break;
+            }
+
+            if (symbol < END_OF_BLOCK)
+            {
+                if (produced == total)
+                {
+                    status = ERR_FORMAT;
+                    break;
+                }
+                out[produced++] = symbol;
+                continue;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29 ||
+                (status = getBits(&r, lengthExtra[symbol], &extra)) ||
+                (status = getSymbol(&r, distTable, &dsymbol)) ||
+                dsymbol >= DIST_CODES ||
+                (status = getBits(&r, distExtra[dsymbol], &dextra)))
+            {
+                status = ERR_FORMAT;
+                break;
+            }
+
+            size_t copyLen = lengthBase[symbol] + extra;
+            size_t dist = distBase[dsymbol] + dextra;
+            if (dist > produced || copyLen > total - produced)
+            {
+                status = ERR_FORMAT;
+                break;
+            }
+
+            // Copies byte by byte since the string may overlap itself
+            const BYTE *from = out + produced - dist;
+            for (size_t i = 0; i < copyLen; i++)
+            {
+                out[produced + i] = from[i];
+            }
+            produced += copyLen;
+        }
+    }
+
+    free(litTable);
+
+    if (!status && produced != total)
+    {
+        status = ERR_FORMAT;
+    }
+    if (status)
+    {
+        free(out);
+        return status;
+    }
+
+    *outPtr = out;
+    *lengthPtr = produced;
+    return 0;
+}
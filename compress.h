@@ -0,0 +1,32 @@
+/*
+ *  Filename:
+ *      compress.h
+ *
+ *  Purpose:
+ *      To declare function prototypes for compressing secret text before
+ *      it is encoded and decompressing it after it is decoded.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include "stegano.h"
+
+#define LZ_WINDOW 32768     // Farthest distance of a repeated string
+#define LZ_MIN_MATCH 3      // Shortest repeated string that is replaced
+#define LZ_MAX_MATCH 258    // Longest repeated string that is replaced
+#define HUFF_MAX_BITS 15    // Longest Huffman code in bits
+#define LITLEN_CODES 286    // Literals, end of block and length codes
+#define DIST_CODES 30       // Distance codes
+#define BLOCK_TOKENS 65536  // Literals and matches coded with one Huffman table
+
+// Function prototypes
+int compressBytes(const BYTE *in, size_t length, size_t reserve,
+                  BYTE **outPtr, size_t *lengthPtr);
+int decompressBytes(const BYTE *in, size_t length, BYTE **outPtr,
+                    size_t *lengthPtr);
+
+#endif
@@ -17,14 +17,230 @@
  *      25 April 2022 - ignored non-ASCII characters
  *      01 May 2022   - added text file for user prompt
  *      04 May 2022   - fixed rizal.bmp
+ *      17 October 2026 - added headless batch mode for command line arguments
+ *                      - added --jobs option for multi-threaded batches
+ *                      - added --stream option for very large images
+ *                      - read only the rows holding the payload
+ *                      - decoded blind stego images without cover image
+ *                      - added --stats option for per-job timings
+ *                      - added --async option for pipelined batches
+ *                      - added --shard option for text spread over covers
+ *                      - added --key option for scattered payload bits
+ *                      - decoded Hamming stego images without cover image
  */
 
-#include "stegano.h"
+#include "batch.h"
 
-int main(void)
+// Decodes the secret text hidden in the stego image of jobPtr and saves it
+// in the decoded text file. A cover image given as "-" is not opened, which
+// works for stego images encoded in blind mode. Returns 0 on success.
+int decodeJob(const JOB *jobPtr)
 {
+    // Scattered payloads touch rows all over the images, which are mapped
+    // whole rather than read a row at a time
+    BMP *(*openFunc)(const char *) = jobPtr->key ? loadImage : openImage;
+
+    if (!strcmp(jobPtr->first, "-"))
+    {
+        BMP *stegoImagePtr = openFunc(jobPtr->second); // Opens stego image
+        if (stegoImagePtr == NULL)
+        {
+            return ERR_OPEN;
+        }
+        stegoImagePtr->key = jobPtr->key;
+
+        int status = decodeBlind(*stegoImagePtr, jobPtr->third);
+        freeImage(stegoImagePtr);
+
+        return status;
+    }
+
+    // Reads only image headers; decodeText() reads just the rows holding the
+    // payload, so both images are opened for streaming whatever the options
+    BMP *coverImagePtr = openFunc(jobPtr->first); // Opens cover image
+    if (coverImagePtr == NULL)
+    {
+        return ERR_OPEN;
+    }
+
+    BMP *stegoImagePtr = openFunc(jobPtr->second); // Opens stego image
+    if (stegoImagePtr == NULL)
+    {
+        freeImage(coverImagePtr);
+        return ERR_OPEN;
+    }
+    stegoImagePtr->key = jobPtr->key;
+
+    // Compares cover and stego image to decode secret text
+    int status = decodeText(*coverImagePtr, *stegoImagePtr, jobPtr->third);
+
+    // Releases memory allocated to cover and stego image
+    freeImage(coverImagePtr);
+    freeImage(stegoImagePtr);
+
+    return status;
+}
+
+// Decodes the secret text hidden in stego image second, the content of the
+// stego image file of jobPtr, using cover image first, the content of its
+// cover image file, or NULL if it was given as "-". Stores the allocated
+// decoded text in the pointer pointed to by outPtr. Returns 0 on success.
+int decodePipe(const JOB *jobPtr, const BYTE *first, size_t firstSize,
+               const BYTE *second, size_t secondSize, BYTE **outPtr,
+               size_t *outSizePtr)
+{
+    if ((first != NULL &&
+         verifyFilename(jobPtr->first, ".bmp", "decodePipe()")) ||
+        verifyFilename(jobPtr->second, ".bmp", "decodePipe()") ||
+        verifyFilename(jobPtr->third, ".txt", "decodePipe()"))
+    {
+        return ERR_FILENAME;
+    }
+
+    int status;
+    BMP *stegoImagePtr = parseImage(second, secondSize, &status);
+    if (stegoImagePtr == NULL)
+    {
+        reportError("file error: %s is not a supported bitmap in "
+                    "decodePipe()\n",
+                    jobPtr->second);
+        return status;
+    }
+    stegoImagePtr->key = jobPtr->key;
+
+    BMP *coverImagePtr = NULL;
+    if (first != NULL &&
+        (coverImagePtr = parseImage(first, firstSize, &status)) == NULL)
+    {
+        reportError("file error: %s is not a supported bitmap in "
+                    "decodePipe()\n",
+                    jobPtr->first);
+        freeImage(stegoImagePtr);
+        return status;
+    }
+
+    if (coverImagePtr == NULL && stegoImagePtr->mode == MODE_DIFF)
+    {
+        reportError("%s", "stego image was not encoded in blind mode: its "
+                          "cover image is needed in decodePipe()\n");
+        freeImage(stegoImagePtr);
+        return ERR_MISMATCH;
+    }
+
+    // Sizes buffer for the capacity of the stego image, which only
+    // compressed text can exceed; such text is decoded again at its length
+    int density = stegoImagePtr->mode != MODE_DIFF ? stegoImagePtr->density
+                                                   : 1;
+    size_t size = payloadCapacity(stegoImagePtr->mode, density,
+                                  (size_t)stegoImagePtr->rowChannels *
+                                      stegoImagePtr->height);
+    for (int tries = 0; tries < 2; tries++)
+    {
+        *outPtr = malloc(size ? size : 1);
+        if (*outPtr == NULL)
+        {
+            status = ERR_ALLOC;
+            break;
+        }
+
+        status = decodeBytes(coverImagePtr, stegoImagePtr, *outPtr, size,
+                             outSizePtr);
+        if (status != ERR_BUFFER)
+        {
+            break;
+        }
+        free(*outPtr);
+        *outPtr = NULL;
+        size = *outSizePtr;
+    }
+
+    // Releases memory allocated to cover and stego image
+    if (coverImagePtr != NULL)
+    {
+        freeImage(coverImagePtr);
+    }
+    freeImage(stegoImagePtr);
+
+    return status;
+}
+
+// Decodes the secret text spread as shards over the stego images of the
+// count jobs at jobs and saves it in the decoded text file they share. A
+// cover image given as "-" is not opened, which works for stego images
+// encoded in blind mode. Returns 0 on success.
+int decodeShards(const JOB *jobs, size_t count)
+{
+    if (count > SHARD_MAX)
+    {
+        reportError("invalid shards: %zu jobs given but at most %d are "
+                    "allowed in decodeShards()\n",
+                    count, SHARD_MAX);
+        return ERR_FORMAT;
+    }
+
+    // Reads only image headers; shardDecode() reads just the rows holding
+    // each shard. Scattered shards touch rows all over the images, which are
+    // mapped whole instead
+    BMP *(*openFunc)(const char *) = jobs[0].key ? loadImage : openImage;
+    BMP *covers[SHARD_MAX] = {NULL}; // Cover image of each job, if any
+    BMP *stegos[SHARD_MAX] = {NULL}; // Stego image of each job
+    int status = 0;
+    for (size_t i = 0; i < count && !status; i++)
+    {
+        if (strcmp(jobs[i].third, jobs[0].third))
+        {
+            reportError("invalid shards: every job must have decoded text %s "
+                        "in decodeShards()\n",
+                        jobs[0].third);
+            status = ERR_FILENAME;
+        }
+        else if ((strcmp(jobs[i].first, "-") &&
+                  (covers[i] = openFunc(jobs[i].first)) == NULL) ||
+                 (stegos[i] = openFunc(jobs[i].second)) == NULL)
+        {
+            status = ERR_OPEN;
+        }
+        else
+        {
+            stegos[i]->key = jobs[i].key;
+        }
+    }
+
+    if (!status)
+    {
+        status = shardDecode(covers, stegos, count, jobs[0].third);
+    }
+
+    // Releases memory allocated to cover and stego images
+    for (size_t i = 0; i < count; i++)
+    {
+        if (covers[i] != NULL)
+        {
+            freeImage(covers[i]);
+        }
+        if (stegos[i] != NULL)
+        {
+            freeImage(stegos[i]);
+        }
+    }
+
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    // Runs jobs given by command line arguments without user prompts
+    if (argc > 1)
+    {
+        return runBatch(argc, argv, decodeJob, decodePipe, decodeShards,
+                        "[-j N] [-a N] [-S] [-s] [-k KEY] [--stats] [-m MANIFEST|-] [COVER.bmp|- STEGO.bmp DECODED.txt]...");
+    }
+
     const char *asciiArt = "assets\\computerArt.txt"; // Filename of ASCII art
-    showBackground(asciiArt);                         // Displays terminal background
+    if (showBackground(asciiArt))                     // Displays terminal background
+    {
+        exit(EXIT_FAILURE);
+    }
 
     setCursorPos(26, 16);                             // Moves position of terminal cursor
     puts("Ready to DECODE your secret text?");        // Displays user prompt
@@ -50,15 +266,22 @@ int main(void)
     printf("%s", "Decoded text (.txt): ");
     scanf("%s", decoded);
 
-    BMP *coverImagePtr = loadImage(cover); // Opens cover image
-    BMP *stegoImagePtr = loadImage(stego); // Opens stego image
+    BMP *coverImagePtr = openImage(cover); // Opens cover image
+    BMP *stegoImagePtr = openImage(stego); // Opens stego image
+    if (coverImagePtr == NULL || stegoImagePtr == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
 
     // Dereferences pointer to prepare for passing by value
     BMP coverImage = *coverImagePtr;
     BMP stegoImage = *stegoImagePtr;
 
     // Compares cover and stego image to decode secret text
-    decodeText(coverImage, stegoImage, decoded);
+    if (decodeText(coverImage, stegoImage, decoded))
+    {
+        exit(EXIT_FAILURE);
+    }
 
     // Releases memory allocated to cover and stego image
     freeImage(coverImagePtr);
@@ -18,14 +18,175 @@
  *      25 April 2022 - ignored non-ASCII characters
  *      01 May 2022   - added text file for user prompt
  *      04 May 2022   - fixed rizal.bmp
+ *      17 October 2026 - added headless batch mode for command line arguments
+ *                      - added --jobs option for multi-threaded batches
+ *                      - added --stream option for very large images
+ *                      - added --blind option for cover-less decoding
+ *                      - counted color channels of truecolor images
+ *                      - added --density option for multi-bit embedding
+ *                      - added --compress option for smaller payloads
+ *                      - added --stats option for per-job timings
+ *                      - added --patch option to write only modified bytes
+ *                      - added --async option for pipelined batches
+ *                      - added --shard option for text spread over covers
+ *                      - added --key option for scattered payload bits
+ *                      - added --hamming option for matrix embedding
+ *                      - left room for the payload trailer
  */
 
-#include "stegano.h"
+#include "batch.h"
+#include "kernels.h"
 
-int main(void)
+// Encodes the secret text of jobPtr into its cover image and saves the
+// stego image. Returns 0 on success.
+int encodeJob(const JOB *jobPtr)
 {
+    // Creates BMP for cover image, reading only its header when streaming
+    BMP *imagePtr = jobPtr->stream ? openImage(jobPtr->first)
+                                   : loadImage(jobPtr->first);
+    if (imagePtr == NULL)
+    {
+        return ERR_OPEN;
+    }
+    imagePtr->key = jobPtr->key;
+
+    // Hides secret text into the cover image, then creates stego image
+    int status;
+    if (jobPtr->stream)
+    {
+        status = streamEncode(jobPtr->second, *imagePtr, jobPtr->third,
+                              jobPtr->mode, jobPtr->density, jobPtr->flags);
+    }
+    else if (!(status = encodeText(jobPtr->second, imagePtr, jobPtr->mode,
+                                   jobPtr->density, jobPtr->flags)))
+    {
+        status = jobPtr->patch ? patchStego(jobPtr->third, *imagePtr)
+                               : createStego(jobPtr->third, *imagePtr);
+    }
+
+    freeImage(imagePtr); // Releases memory allocated for cover image
+
+    return status;
+}
+
+// Encodes secret text second, the content of the secret text file of
+// jobPtr, into cover image first, the content of its cover image file, and
+// stores the allocated content of its stego image in the pointer pointed to
+// by outPtr. Returns 0 on success.
+int encodePipe(const JOB *jobPtr, const BYTE *first, size_t firstSize,
+               const BYTE *second, size_t secondSize, BYTE **outPtr,
+               size_t *outSizePtr)
+{
+    if (verifyFilename(jobPtr->first, ".bmp", "encodePipe()") ||
+        verifyFilename(jobPtr->second, ".txt", "encodePipe()") ||
+        verifyFilename(jobPtr->third, ".bmp", "encodePipe()"))
+    {
+        return ERR_FILENAME;
+    }
+
+    // Rejects text containing non-ASCII character, as encodeText() does
+    if (!isAscii(second, secondSize))
+    {
+        reportError("file error: %s contains non-ASCII character\n",
+                    jobPtr->second);
+        return ERR_FORMAT;
+    }
+
+    int status;
+    BMP *imagePtr = parseImage(first, firstSize, &status);
+    if (imagePtr == NULL)
+    {
+        reportError("file error: %s is not a supported bitmap in "
+                    "encodePipe()\n",
+                    jobPtr->first);
+        return status;
+    }
+    imagePtr->key = jobPtr->key;
+
+    // Hides secret text into the cover image, then lays out stego image
+    status = encodeBytes(imagePtr, second, secondSize, jobPtr->mode,
+                         jobPtr->density, jobPtr->flags);
+    if (!status)
+    {
+        *outSizePtr = stegoSize(*imagePtr);
+        *outPtr = malloc(*outSizePtr);
+        status = *outPtr == NULL
+                     ? ERR_ALLOC
+                     : writeStego(*imagePtr, *outPtr, *outSizePtr);
+    }
+
+    freeImage(imagePtr); // Releases memory allocated for cover image
+
+    return status;
+}
+
+// Encodes the secret text shared by the count jobs at jobs as shards spread
+// over their cover images, creating the stego image of each job. Returns 0
+// on success.
+int encodeShards(const JOB *jobs, size_t count)
+{
+    if (count > SHARD_MAX)
+    {
+        reportError("invalid shards: %zu jobs given but at most %d are "
+                    "allowed in encodeShards()\n",
+                    count, SHARD_MAX);
+        return ERR_FORMAT;
+    }
+
+    BMP *images[SHARD_MAX];        // Cover image of each job
+    const char *names[SHARD_MAX];  // Stego image of each job
+    int status = 0;
+    size_t loaded = 0;
+    for (; loaded < count && !status; loaded++)
+    {
+        if (strcmp(jobs[loaded].second, jobs[0].second))
+        {
+            reportError("invalid shards: every job must have secret text %s "
+                        "in encodeShards()\n",
+                        jobs[0].second);
+            status = ERR_FILENAME;
+            break;
+        }
+
+        images[loaded] = loadImage(jobs[loaded].first);
+        names[loaded] = jobs[loaded].third;
+        if (images[loaded] == NULL)
+        {
+            status = ERR_OPEN;
+            break;
+        }
+        images[loaded]->key = jobs[loaded].key;
+    }
+
+    if (!status)
+    {
+        status = shardEncode(jobs[0].second, images, names, count,
+                             jobs[0].mode, jobs[0].density, jobs[0].flags);
+    }
+
+    // Releases memory allocated for cover images
+    for (size_t i = 0; i < loaded; i++)
+    {
+        freeImage(images[i]);
+    }
+
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    // Runs jobs given by command line arguments without user prompts
+    if (argc > 1)
+    {
+        return runBatch(argc, argv, encodeJob, encodePipe, encodeShards,
+                        "[-j N] [-a N] [-S] [-s] [-b] [-d K] [-H K] [-z] [-k KEY] [-p] [--stats] [-m MANIFEST|-] [COVER.bmp SECRET.txt STEGO.bmp]...");
+    }
+
     const char *asciiArt = "assets\\computerArt.txt"; // Filename of ASCII art
-    showBackground(asciiArt);                         // Displays terminal background
+    if (showBackground(asciiArt))                     // Displays terminal background
+    {
+        exit(EXIT_FAILURE);
+    }
 
     setCursorPos(26, 16);                             // Moves position of terminal cursor
     puts("Ready to ENCODE your secret text?");        // Displays user prompt
@@ -42,26 +203,52 @@ int main(void)
     scanf("%s", cover);
 
     BMP *imagePtr = loadImage(cover); // Creates BMP structure for cover image
+    if (imagePtr == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
 
-    // Computes maximum number of characters for secret text
-    unsigned int maxChar = (imagePtr->width * imagePtr->height) / CHAR_BIT;
+    // Obtains bits encoded per color channel, where more than 1 bit needs
+    // blind mode
+    int density = 1;
     setCursorPos(14, 20);
-    printf("Note: Secret text must have at most %u characters", maxChar);
+    printf("Bits per channel (1-%d): ", DENSITY_MAX);
+    if (scanf("%d", &density) != 1 || density < 1 || density > DENSITY_MAX)
+    {
+        density = 1;
+    }
+    int mode = density > 1 ? MODE_LSB : MODE_DIFF;
 
-    // Obtains filename of secret text
+    // Computes maximum number of characters for secret text, leaving room
+    // for the payload header and trailer
+    const size_t frame = PAYLOAD_HEADER_SIZE + PAYLOAD_TRAILER_SIZE;
+    size_t maxChar = (size_t)imagePtr->rowChannels * imagePtr->height *
+                     density / CHAR_BIT;
+    maxChar = maxChar > frame ? maxChar - frame : 0;
     setCursorPos(14, 21);
+    printf("Note: Secret text must have at most %zu characters", maxChar);
+
+    // Obtains filename of secret text
+    setCursorPos(14, 22);
     printf("%s", "Secret text (.txt): ");
     scanf("%s", secret);
 
-    encodeText(secret, imagePtr);     // Hides secret text into the cover image
+    // Hides secret text into the cover image
+    if (encodeText(secret, imagePtr, mode, density, 0))
+    {
+        exit(EXIT_FAILURE);
+    }
 
     // Obtains filename of stego image
-    setCursorPos(14, 22);
+    setCursorPos(14, 23);
     printf("%s", "Stego image (.bmp): ");
     scanf("%s", stego);
 
     BMP image = *imagePtr;     // Dereferences pointer for passing by value     
-    createStego(stego, image); // Creates stego image from modified cover image
+    if (createStego(stego, image)) // Creates stego image from modified cover image
+    {
+        exit(EXIT_FAILURE);
+    }
     freeImage(imagePtr);       // Releases memory allocated for cover image
 
     showBackground(asciiArt);  // Displays terminal background
@@ -0,0 +1,226 @@
+/*
+ *  Filename:
+ *      genbmp.c
+ *
+ *  Purpose:
+ *      To generate synthetic 8-bit, 24-bit and 32-bit bitmap images of a
+ *      given size for benchmarks, with odd widths so rows are padded.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - added saturated pixels
+ */
+
+#include "stegano.h"
+
+#define ASPECT_WIDTH 4  // Width of aspect ratio of generated images
+#define ASPECT_HEIGHT 3 // Height of aspect ratio of generated images
+
+// Returns next pseudorandom number of xorshift state pointed to by statePtr.
+static uint32_t nextRandom(uint32_t *statePtr)
+{
+    uint32_t x = *statePtr;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *statePtr = x;
+}
+
+// Stores value as a 2-byte little-endian integer at out. Returns none.
+static void putWord(BYTE *out, unsigned value)
+{
+    out[0] = (BYTE)value;
+    out[1] = (BYTE)(value >> 8);
+}
+
+// Stores value as a 4-byte little-endian integer at out. Returns none.
+static void putDword(BYTE *out, unsigned long value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (BYTE)(value >> (i * 8));
+    }
+}
+
+// Writes a width by height bitmap image of depth bits per pixel into the file
+// indicated by fname. Pixels are a smooth gradient with noise from seed, kept
+// within 1 and 254 so +1/-1 deltas are never clamped, except for about
+// clipped percent of channel bytes set to 0 or 255, which exercise clamping.
+// Rows are written one at a time, so memory use does not depend on image
+// size. Returns 0 on success.
+static int writeImage(const char *fname, LONG width, LONG height, int depth,
+                      uint32_t seed, int clipped)
+{
+    int pxSize = depth / CHAR_BIT;
+    size_t rowSize = ((size_t)width * pxSize + 3) / 4 * 4;
+    DWORD tableSize = depth == 8 ? 256 * sizeof(DWORD) : 0;
+    DWORD offset = FILEHEADER_SIZE + INFOHEADER_SIZE + tableSize;
+    unsigned long long fileSize = offset + (unsigned long long)rowSize * height;
+
+    if (fileSize > UINT_MAX)
+    {
+        fprintf(stderr, "%s would be larger than 4 GB\n", fname);
+        return ERR_FORMAT;
+    }
+
+    FILE *imgOut = fopen(fname, "wb");
+    if (imgOut == NULL)
+    {
+        fprintf(stderr, "fopen() failed: %s could not be created\n", fname);
+        return ERR_OPEN;
+    }
+
+    // Builds file header and BITMAPINFOHEADER of an uncompressed image
+    BYTE header[FILEHEADER_SIZE + INFOHEADER_SIZE] = {'B', 'M'};
+    putDword(&header[2], fileSize);
+    putDword(&header[10], offset);
+    putDword(&header[14], INFOHEADER_SIZE);
+    putDword(&header[18], width);
+    putDword(&header[22], height);
+    putWord(&header[26], 1);     // Color planes
+    putWord(&header[28], depth);
+    putDword(&header[30], BI_RGB);
+    putDword(&header[34], rowSize * height);
+    putDword(&header[38], 2835); // 72 DPI
+    putDword(&header[42], 2835);
+    putDword(&header[46], depth == 8 ? 256 : 0);
+
+    int failed = fwrite(header, sizeof(*header), sizeof(header), imgOut) !=
+                 sizeof(header);
+
+    // Grayscale palette of 8-bit images
+    for (int i = 0; i < 256 && depth == 8 && !failed; i++)
+    {
+        BYTE entry[4] = {i, i, i, 0};
+        failed = fwrite(entry, sizeof(*entry), sizeof(entry), imgOut) !=
+                 sizeof(entry);
+    }
+
+    BYTE *row = calloc(rowSize, 1); // Padding stays 0
+    if (row == NULL)
+    {
+        fprintf(stderr, "%s", "calloc() failed: no memory for row\n");
+        fclose(imgOut);
+        return ERR_ALLOC;
+    }
+
+    uint32_t state = seed ? seed : 1;
+    for (LONG y = 0; y < height && !failed; y++)
+    {
+        for (LONG x = 0; x < width; x++)
+        {
+            BYTE *px = row + (size_t)x * pxSize;
+            for (int c = 0; c < pxSize; c++)
+            {
+                // Alpha of 32-bit pixels is opaque and stores no bits
+                if (c == 3)
+                {
+                    px[c] = UCHAR_MAX;
+                    continue;
+                }
+
+                unsigned gradient = (unsigned)((size_t)x * 160 / width +
+                                               (size_t)y * 64 / height) +
+                                    c * 16;
+                unsigned value = gradient + nextRandom(&state) % 31;
+                px[c] = 1 + value % 254;
+
+                // Draws no extra numbers unless asked, so images stay the same
+                if (clipped && nextRandom(&state) % 100 < (unsigned)clipped)
+                {
+                    px[c] = state & 0x100 ? UCHAR_MAX : 0;
+                }
+            }
+        }
+        failed = fwrite(row, sizeof(*row), rowSize, imgOut) != rowSize;
+    }
+
+    free(row);
+    if (fclose(imgOut) || failed)
+    {
+        fprintf(stderr, "fwrite() failed: %s could not be written\n", fname);
+        return ERR_WRITE;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *usage = "[-m MEGAPIXELS | -s WIDTHxHEIGHT] [-d 8|24|32] "
+                        "[-r SEED] [-c PERCENT] OUT.bmp";
+    double megapixels = 1;
+    LONG width = 0, height = 0;
+    int depth = 24;
+    uint32_t seed = 1;
+    int clipped = 0; // Percent of channel bytes set to 0 or 255
+    const char *fname = NULL;
+
+    setHeadless(1); // Reports errors without clearing the terminal
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-m") && i + 1 < argc)
+        {
+            megapixels = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2)
+            {
+                width = height = -1;
+            }
+        }
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+        {
+            depth = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+        {
+            clipped = atoi(argv[++i]);
+        }
+        else if (fname == NULL && argv[i][0] != '-')
+        {
+            fname = argv[i];
+        }
+        else
+        {
+            fname = NULL;
+            break;
+        }
+    }
+
+    if (fname == NULL || verifyFilename(fname, ".bmp", "genbmp") ||
+        (depth != 8 && depth != 24 && depth != 32) || clipped < 0 ||
+        clipped > 100)
+    {
+        fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+        return EXIT_FAILURE;
+    }
+
+    // Picks an odd width of the aspect ratio, so rows of 8-bit and 24-bit
+    // images need padding, and enough rows for the requested pixels
+    if (width == 0)
+    {
+        double pixels = megapixels * 1e6;
+        width = (LONG)sqrt(pixels * ASPECT_WIDTH / ASPECT_HEIGHT) | 1;
+        height = (LONG)ceil(pixels / width);
+    }
+    if (width <= 0 || height <= 0)
+    {
+        fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+        return EXIT_FAILURE;
+    }
+
+    if (writeImage(fname, width, height, depth, seed, clipped))
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %d x %d, %d-bit\n", fname, width, height, depth);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1783 @@
+/*
+ *  Filename:
+ *      kernels.c
+ *
+ *  Purpose:
+ *      To define vectorized kernels, with scalar fallbacks, for the inner
+ *      loops of encoding and decoding.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - added embedding kernels
+ *                      - added ASCII validation kernels
+ *                      - added packing kernels for payloads of known length
+ *                      - added least significant bit kernels for blind mode
+ *                      - added channel kernels for 32-bit pixels
+ *                      - added multi-bit least significant bit kernels
+ *                      - added Hamming matrix embedding kernels
+ *                      - added CRC32C checksum kernels
+ *                      - added distortion kernels for image analysis
+ */
+
+#include "kernels.h"
+#include <pthread.h>
+
+static unsigned int crcTable[8][256];    // Slicing-by-8 tables of CRC32C
+static unsigned int strideTable[4][256]; // Shifts of remainders by a stride
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT; // Fills tables once
+
+// Returns nonzero if character ends the secret text, which happens at the
+// first null or non-ASCII character.
+static int endsText(BYTE character)
+{
+    return character == ASCII_MIN || character > ASCII_MAX;
+}
+
+// Packs the bits stored in 8 * charCount pixels of cover pixels covPx and
+// stego pixels stegPx into characters in out, one pixel per bit from the
+// most significant bit. A pixel stores 1 if the stego pixel is greater than
+// the cover pixel. If untilEnd is nonzero, stops before the first character
+// that ends the secret text. Returns number of characters stored in out.
+static inline size_t packScalar(const BYTE *covPx, const BYTE *stegPx,
+                                size_t charCount, BYTE *out, int untilEnd)
+{
+    for (size_t i = 0; i < charCount; i++)
+    {
+        BYTE character = 0; // Decoded character
+
+        for (unsigned int bit = 0; bit < CHAR_BIT; bit++)
+        {
+            size_t px = i * CHAR_BIT + bit;
+            character = (character << 1) | (stegPx[px] > covPx[px]);
+        }
+
+        if (untilEnd && endsText(character))
+        {
+            return i;
+        }
+        out[i] = character;
+    }
+
+    return charCount;
+}
+
+// Scalar version of packDiffBits(). Reference for the vectorized packing
+// kernels. Returns number of characters stored in out.
+size_t packDiffBitsScalar(const BYTE *covPx, const BYTE *stegPx,
+                          size_t charCount, BYTE *out)
+{
+    return packScalar(covPx, stegPx, charCount, out, 1);
+}
+
+// Encodes the bits of charCount characters chars into 8 * charCount pixels
+// px, one pixel per bit from the most significant bit, keeping each pixel
+// within 0 and maxPxValue. Reference for the vectorized embedding kernels.
+// Returns none.
+void embedDiffBitsScalar(BYTE *px, const BYTE *chars, size_t charCount,
+                         int maxPxValue)
+{
+    for (size_t i = 0; i < charCount; i++)
+    {
+        BYTE character = chars[i]; // Bits of character not yet encoded
+
+        for (unsigned int bit = 0; bit < CHAR_BIT; bit++)
+        {
+            embedDiffBit(&px[i * CHAR_BIT + bit], character >> (CHAR_BIT - 1),
+                         maxPxValue);
+            character <<= 1;
+        }
+    }
+}
+
+// Encodes the bits of charCount characters chars into the least significant
+// bit of 8 * charCount pixels px, one pixel per bit from the most significant
+// bit. Reference for the vectorized kernels. Returns none.
+void embedLsbBitsScalar(BYTE *px, const BYTE *chars, size_t charCount)
+{
+    for (size_t i = 0; i < charCount; i++)
+    {
+        for (unsigned int bit = 0; bit < CHAR_BIT; bit++)
+        {
+            embedLsbBit(&px[i * CHAR_BIT + bit],
+                        (chars[i] >> (CHAR_BIT - 1 - bit)) & 1);
+        }
+    }
+}
+
+// Packs the least significant bits of 8 * charCount stego pixels stegPx into
+// charCount bytes in out, one pixel per bit from the most significant bit.
+// Reference for the vectorized kernels. Returns none.
+void packLsbBytesScalar(const BYTE *stegPx, size_t charCount, BYTE *out)
+{
+    for (size_t i = 0; i < charCount; i++)
+    {
+        BYTE character = 0; // Decoded character
+
+        for (unsigned int bit = 0; bit < CHAR_BIT; bit++)
+        {
+            character = (character << 1) | (stegPx[i * CHAR_BIT + bit] & 1);
+        }
+        out[i] = character;
+    }
+}
+
+// Returns the 8 * density bits of density characters chars as one value,
+// first character in the most significant bits.
+static inline unsigned long long loadGroup(const BYTE *chars, int density)
+{
+    unsigned long long value = 0;
+
+    for (int i = 0; i < density; i++)
+    {
+        value = (value << CHAR_BIT) | chars[i];
+    }
+
+    return value;
+}
+
+// Stores the 8 * density bits of value into density characters in out,
+// first character from the most significant bits. Returns none.
+static inline void storeGroup(BYTE *out, unsigned long long value, int density)
+{
+    for (int i = density - 1; i >= 0; i--)
+    {
+        out[i] = (BYTE)value;
+        value >>= CHAR_BIT;
+    }
+}
+
+// Encodes groups of density characters chars into the density least
+// significant bits of 8 pixels px per group, one pixel per density bits from
+// the most significant bit. Reference for the vectorized kernel.
+// Returns none.
+void embedLsbGroupsScalar(BYTE *px, const BYTE *chars, size_t groups,
+                          int density)
+{
+    const BYTE mask = (1u << density) - 1; // Bits of pixel replaced
+
+    for (size_t g = 0; g < groups; g++)
+    {
+        unsigned long long value = loadGroup(chars + g * density, density);
+
+        for (unsigned int i = 0; i < CHAR_BIT; i++)
+        {
+            unsigned int shift = density * (CHAR_BIT - 1 - i);
+            BYTE *pxPtr = &px[g * CHAR_BIT + i];
+            *pxPtr = (*pxPtr & ~mask) | ((value >> shift) & mask);
+        }
+    }
+}
+
+// Packs the density least significant bits of 8 stego pixels stegPx per
+// group into density bytes in out, one pixel per density bits from the most
+// significant bit. Reference for the vectorized kernel. Returns none.
+void packLsbGroupsScalar(const BYTE *stegPx, size_t groups, BYTE *out,
+                         int density)
+{
+    const BYTE mask = (1u << density) - 1; // Bits of pixel read
+
+    for (size_t g = 0; g < groups; g++)
+    {
+        unsigned long long value = 0;
+
+        for (unsigned int i = 0; i < CHAR_BIT; i++)
+        {
+            value = (value << density) | (stegPx[g * CHAR_BIT + i] & mask);
+        }
+        storeGroup(out + g * density, value, density);
+    }
+}
+
+// Returns syndrome of the Hamming block of k bits at px, HAMMING_PIXELS(k)
+// pixels long: the exclusive or of the positions, counted from 1, of the
+// pixels whose least significant bit is set.
+static inline unsigned int syndromeScalar(const BYTE *px, int k)
+{
+    unsigned int syndrome = 0;
+
+    for (unsigned int i = 0; i < HAMMING_PIXELS(k); i++)
+    {
+        syndrome ^= (i + 1) & -(unsigned int)(px[i] & 1);
+    }
+
+    return syndrome;
+}
+
+// Encodes groups of k characters chars into 8 Hamming blocks of
+// HAMMING_PIXELS(k) pixels px per group, k bits per block from the most
+// significant bit. Each block is given the syndrome of its bits by flipping
+// the least significant bit of at most one pixel, the one whose position is
+// the exclusive or of the current and wanted syndromes. Reference for the
+// vectorized kernel. Returns none.
+void embedHammingGroupsScalar(BYTE *px, const BYTE *chars, size_t groups,
+                              int k)
+{
+    const unsigned int n = HAMMING_PIXELS(k); // Pixels of each block
+
+    for (size_t g = 0; g < groups; g++)
+    {
+        unsigned long long value = loadGroup(chars + g * k, k);
+
+        for (unsigned int i = 0; i < CHAR_BIT; i++)
+        {
+            BYTE *block = px + (g * CHAR_BIT + i) * n;
+            unsigned int bits = (value >> (k * (CHAR_BIT - 1 - i))) & n;
+            unsigned int change = syndromeScalar(block, k) ^ bits;
+            if (change)
+            {
+                block[change - 1] ^= 1;
+            }
+        }
+    }
+}
+
+// Packs the syndromes of 8 Hamming blocks of HAMMING_PIXELS(k) stego pixels
+// stegPx per group into k bytes in out, one block per k bits from the most
+// significant bit. Reference for the vectorized kernel. Returns none.
+void packHammingGroupsScalar(const BYTE *stegPx, size_t groups, BYTE *out,
+                             int k)
+{
+    const unsigned int n = HAMMING_PIXELS(k); // Pixels of each block
+
+    for (size_t g = 0; g < groups; g++)
+    {
+        unsigned long long value = 0;
+
+        for (unsigned int i = 0; i < CHAR_BIT; i++)
+        {
+            value = (value << k) |
+                    syndromeScalar(stegPx + (g * CHAR_BIT + i) * n, k);
+        }
+        storeGroup(out + g * k, value, k);
+    }
+}
+
+// Copies the blue, green and red channels of width 32-bit BGRA pixels in row
+// into 3 * width bytes in out, dropping alpha. Reference for the vectorized
+// kernel. Returns none.
+void gatherChannelsScalar(const BYTE *row, LONG width, BYTE *out)
+{
+    for (LONG px = 0; px < width; px++)
+    {
+        out[px * 3] = row[px * 4];
+        out[px * 3 + 1] = row[px * 4 + 1];
+        out[px * 3 + 2] = row[px * 4 + 2];
+    }
+}
+
+// Copies 3 * width bytes of channels back into the blue, green and red
+// channels of width 32-bit BGRA pixels in row, keeping alpha. Reference for
+// the vectorized kernel. Returns none.
+void scatterChannelsScalar(BYTE *row, LONG width, const BYTE *channels)
+{
+    for (LONG px = 0; px < width; px++)
+    {
+        row[px * 4] = channels[px * 3];
+        row[px * 4 + 1] = channels[px * 3 + 1];
+        row[px * 4 + 2] = channels[px * 3 + 2];
+    }
+}
+
+// Returns nonzero if each of the length characters chars is ASCII. Checks
+// 8 characters at a time for a set high bit. Reference for the vectorized
+// validation kernels.
+int isAsciiScalar(const BYTE *chars, size_t length)
+{
+    unsigned long long high = 0; // Union of the bits of every character
+    size_t i = 0;
+
+    for (; i + sizeof(high) <= length; i += sizeof(high))
+    {
+        unsigned long long eight;
+        memcpy(&eight, chars + i, sizeof(eight));
+        high |= eight;
+    }
+    for (; i < length; i++)
+    {
+        high |= chars[i];
+    }
+
+    return (high & 0x8080808080808080ULL) == 0;
+}
+
+// Adds to the structure pointed to by distPtr the differences between count
+// cover bytes covPx and stego bytes stegPx: the sum of their squares, the
+// number of bytes that differ and the largest. Reference for the vectorized
+// distortion kernels. Returns none.
+void measureDistortionScalar(const BYTE *covPx, const BYTE *stegPx,
+                             size_t count, DISTORTION *distPtr)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        int delta = abs(covPx[i] - stegPx[i]);
+        distPtr->squares += delta * delta;
+        distPtr->changed += delta != 0;
+        if (delta > distPtr->maxDelta)
+        {
+            distPtr->maxDelta = delta;
+        }
+    }
+}
+
+// Returns the product of polynomials a and b modulo the CRC32C polynomial,
+// each stored with its bits reversed, x^0 in the most significant bit.
+static unsigned int multiplyModPoly(unsigned int a, unsigned int b)
+{
+    unsigned int product = 0;
+
+    for (unsigned int bit = 1u << 31; bit != 0; bit >>= 1)
+    {
+        if (a & bit)
+        {
+            product ^= b;
+        }
+        b = b & 1 ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+
+    return product;
+}
+
+// Returns x^(8 * length) modulo the CRC32C polynomial, the factor that moves
+// a CRC32C remainder past length bytes, through repeated squaring.
+static unsigned int shiftModPoly(size_t length)
+{
+    unsigned int shift = 1u << 31; // x^0
+    unsigned int power = 1u << 23; // x^8, the shift of one byte
+
+    for (; length > 0; length >>= 1)
+    {
+        if (length & 1)
+        {
+            shift = multiplyModPoly(power, shift);
+        }
+        power = multiplyModPoly(power, power);
+    }
+
+    return shift;
+}
+
+// Fills crcTable, where entry [0][b] is the CRC32C remainder of byte b and
+// entry [j][b] that of byte b followed by j null bytes, and strideTable,
+// where entry [j][b] is byte j of a remainder holding b moved past
+// CRC_STRIDE bytes. Returns none.
+static void fillCrcTable(void)
+{
+    for (unsigned int b = 0; b < 256; b++)
+    {
+        unsigned int crc = b;
+        for (int i = 0; i < CHAR_BIT; i++)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crcTable[0][b] = crc;
+    }
+    for (unsigned int b = 0; b < 256; b++)
+    {
+        for (int j = 1; j < 8; j++)
+        {
+            unsigned int prev = crcTable[j - 1][b];
+            crcTable[j][b] = (prev >> CHAR_BIT) ^ crcTable[0][prev & 0xFF];
+        }
+    }
+
+    unsigned int shift = shiftModPoly(CRC_STRIDE);
+    for (int j = 0; j < 4; j++)
+    {
+        for (unsigned int b = 0; b < 256; b++)
+        {
+            strideTable[j][b] = multiplyModPoly(shift, b << (j * CHAR_BIT));
+        }
+    }
+}
+
+// Returns the CRC32C of the length bytes data appended to bytes whose CRC32C
+// is crc, which is 0 for no bytes. Folds 8 bytes at a time through the
+// slicing-by-8 tables. Reference for the hardware kernel.
+unsigned int crc32cScalar(unsigned int crc, const BYTE *data, size_t length)
+{
+    pthread_once(&crcOnce, fillCrcTable);
+    crc = ~crc;
+
+    for (; length >= 8; data += 8, length -= 8)
+    {
+        unsigned int low = crc ^ (data[0] | data[1] << 8 | data[2] << 16 |
+                                  (unsigned int)data[3] << 24);
+        unsigned int high = data[4] | data[5] << 8 | data[6] << 16 |
+                            (unsigned int)data[7] << 24;
+        crc = crcTable[7][low & 0xFF] ^ crcTable[6][(low >> 8) & 0xFF] ^
+              crcTable[5][(low >> 16) & 0xFF] ^ crcTable[4][low >> 24] ^
+              crcTable[3][high & 0xFF] ^ crcTable[2][(high >> 8) & 0xFF] ^
+              crcTable[1][(high >> 16) & 0xFF] ^ crcTable[0][high >> 24];
+    }
+    for (; length > 0; data++, length--)
+    {
+        crc = (crc >> CHAR_BIT) ^ crcTable[0][(crc ^ *data) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+// Returns the CRC32C of bytes whose CRC32C is first followed by length bytes
+// whose CRC32C is second, so that runs checksummed apart can be joined
+// without reading them again.
+unsigned int crc32cCombine(unsigned int first, unsigned int second,
+                           size_t length)
+{
+    return multiplyModPoly(shiftModPoly(length), first) ^ second;
+}
+
+#ifdef KERNELS_BMI2
+
+// BMI2 version of embedLsbGroupsScalar(), depositing the bits of each group
+// into the low bits of the 8 bytes of a 64-bit word in one instruction.
+__attribute__((target("bmi2")))
+static void embedLsbGroupsBmi2(BYTE *px, const BYTE *chars, size_t groups,
+                               int density)
+{
+    // Low density bits of each byte
+    const unsigned long long low = 0x0101010101010101ULL * ((1u << density) - 1);
+
+    for (size_t g = 0; g < groups; g++)
+    {
+        // Deposit fills the last pixel first, so bytes are swapped back into
+        // pixel order
+        unsigned long long value = loadGroup(chars + g * density, density);
+        unsigned long long bits = __builtin_bswap64(_pdep_u64(value, low));
+
+        unsigned long long word;
+        memcpy(&word, px + g * CHAR_BIT, sizeof(word));
+        word = (word & ~low) | bits;
+        memcpy(px + g * CHAR_BIT, &word, sizeof(word));
+    }
+}
+
+// BMI2 version of packLsbGroupsScalar(), extracting the low bits of the 8
+// bytes of a 64-bit word in one instruction.
+__attribute__((target("bmi2")))
+static void packLsbGroupsBmi2(const BYTE *stegPx, size_t groups, BYTE *out,
+                              int density)
+{
+    const unsigned long long low = 0x0101010101010101ULL * ((1u << density) - 1);
+
+    for (size_t g = 0; g < groups; g++)
+    {
+        unsigned long long word;
+        memcpy(&word, stegPx + g * CHAR_BIT, sizeof(word));
+        storeGroup(out + g * density,
+                   _pext_u64(__builtin_bswap64(word), low), density);
+    }
+}
+
+#endif
+
+#ifdef KERNELS_X86
+
+// Table of each byte with the order of its bits reversed. Movemask numbers
+// pixels from the least significant bit, while characters store the first
+// pixel in the most significant bit.
+#define R2(n) n, n + 2 * 64, n + 1 * 64, n + 3 * 64
+#define R4(n) R2(n), R2(n + 2 * 16), R2(n + 1 * 16), R2(n + 3 * 16)
+#define R6(n) R4(n), R4(n + 2 * 4), R4(n + 1 * 4), R4(n + 3 * 4)
+static const BYTE reversedBits[256] = {R6(0), R6(2), R6(1), R6(3)};
+#undef R2
+#undef R4
+#undef R6
+
+// Returns nonzero if any of the 4 characters packed in chars ends the secret
+// text, using bit tricks to test every byte at once.
+static int anyEndsText(DWORD chars)
+{
+    DWORD hasZero = (chars - 0x01010101u) & ~chars & 0x80808080u;
+    DWORD hasHigh = chars & 0x80808080u;
+    return (hasZero | hasHigh) != 0;
+}
+
+// SSE2 version of packScalar(), packing 16 pixels into 2 characters per step.
+__attribute__((target("sse2"), always_inline))
+static inline size_t packSse2(const BYTE *covPx, const BYTE *stegPx,
+                              size_t charCount, BYTE *out, int untilEnd)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 2 <= charCount; i += 2)
+    {
+        __m128i cov = _mm_loadu_si128((const __m128i *)(covPx + i * CHAR_BIT));
+        __m128i steg = _mm_loadu_si128((const __m128i *)(stegPx + i * CHAR_BIT));
+
+        // Stego pixel is greater where the saturated difference is nonzero
+        __m128i same = _mm_cmpeq_epi8(_mm_subs_epu8(steg, cov), zero);
+        unsigned int mask = ~_mm_movemask_epi8(same) & 0xFFFF;
+
+        BYTE first = reversedBits[mask & 0xFF];
+        BYTE second = reversedBits[mask >> 8];
+        if (untilEnd && endsText(first))
+        {
+            return i;
+        }
+        out[i] = first;
+        if (untilEnd && endsText(second))
+        {
+            return i + 1;
+        }
+        out[i + 1] = second;
+    }
+
+    return i + packScalar(covPx + i * CHAR_BIT, stegPx + i * CHAR_BIT,
+                          charCount - i, out + i, untilEnd);
+}
+
+// AVX2 version of packScalar(), packing 32 pixels into 4 characters per step.
+__attribute__((target("avx2"), always_inline))
+static inline size_t packAvx2(const BYTE *covPx, const BYTE *stegPx,
+                              size_t charCount, BYTE *out, int untilEnd)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    // Reverses the 8 pixels of each character, so that movemask yields the
+    // first pixel in the most significant bit of each byte
+    const __m256i reverse = _mm256_setr_epi8(
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    size_t i = 0;
+
+    for (; i + 4 <= charCount; i += 4)
+    {
+        __m256i cov =
+            _mm256_loadu_si256((const __m256i *)(covPx + i * CHAR_BIT));
+        __m256i steg =
+            _mm256_loadu_si256((const __m256i *)(stegPx + i * CHAR_BIT));
+
+        // Stego pixel is greater where the saturated difference is nonzero
+        __m256i same = _mm256_cmpeq_epi8(_mm256_subs_epu8(steg, cov), zero);
+        same = _mm256_shuffle_epi8(same, reverse);
+        DWORD chars = ~(DWORD)_mm256_movemask_epi8(same);
+
+        // Lets the SSE2 loop find which character ends the secret text
+        if (untilEnd && anyEndsText(chars))
+        {
+            break;
+        }
+        memcpy(out + i, &chars, sizeof(chars)); // Bytes are in pixel order
+    }
+
+    return i + packSse2(covPx + i * CHAR_BIT, stegPx + i * CHAR_BIT,
+                        charCount - i, out + i, untilEnd);
+}
+
+// SSE2 version of packDiffBitsScalar().
+__attribute__((target("sse2")))
+static size_t packDiffBitsSse2(const BYTE *covPx, const BYTE *stegPx,
+                               size_t charCount, BYTE *out)
+{
+    return packSse2(covPx, stegPx, charCount, out, 1);
+}
+
+// AVX2 version of packDiffBitsScalar().
+__attribute__((target("avx2")))
+static size_t packDiffBitsAvx2(const BYTE *covPx, const BYTE *stegPx,
+                               size_t charCount, BYTE *out)
+{
+    return packAvx2(covPx, stegPx, charCount, out, 1);
+}
+
+// SSE2 version of packDiffBytes().
+__attribute__((target("sse2")))
+static void packDiffBytesSse2(const BYTE *covPx, const BYTE *stegPx,
+                              size_t charCount, BYTE *out)
+{
+    packSse2(covPx, stegPx, charCount, out, 0);
+}
+
+// AVX2 version of packDiffBytes().
+__attribute__((target("avx2")))
+static void packDiffBytesAvx2(const BYTE *covPx, const BYTE *stegPx,
+                              size_t charCount, BYTE *out)
+{
+    packAvx2(covPx, stegPx, charCount, out, 0);
+}
+
+// Returns a mask of the 16 pixels storing 2 characters chars, set to all ones
+// where the pixel stores a bit value of 1.
+__attribute__((target("sse2"), always_inline))
+static inline __m128i spreadBitsSse2(const BYTE *chars)
+{
+    // Bit of its character that each pixel stores
+    const __m128i select = _mm_setr_epi8(
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+    // Copies each character into the 8 pixels storing it
+    __m128i spread = _mm_set_epi64x(
+        (long long)(chars[1] * 0x0101010101010101ULL),
+        (long long)(chars[0] * 0x0101010101010101ULL));
+    return _mm_cmpeq_epi8(_mm_and_si128(spread, select), select);
+}
+
+// Returns a mask of the 32 pixels storing 4 characters chars, set to all ones
+// where the pixel stores a bit value of 1.
+__attribute__((target("avx2"), always_inline))
+static inline __m256i spreadBitsAvx2(const BYTE *chars)
+{
+    const __m256i select = _mm256_setr_epi8(
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+
+    // Copies character k of 4 into the 8 pixels storing it
+    const __m256i spreadIndex = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+        2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+
+    DWORD four;
+    memcpy(&four, chars, sizeof(four));
+    __m256i spread = _mm256_shuffle_epi8(_mm256_set1_epi32((int)four),
+                                         spreadIndex);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(spread, select), select);
+}
+
+// SSE2 version of embedDiffBitsScalar() for 8-bit pixels, expanding 2
+// characters into a +1/-1 mask of 16 pixels per step.
+__attribute__((target("sse2")))
+static void embedDiffBitsSse2(BYTE *px, const BYTE *chars, size_t charCount)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    size_t i = 0;
+
+    for (; i + 2 <= charCount; i += 2)
+    {
+        __m128i ones = spreadBitsSse2(chars + i);
+
+        // Adds 1 where bit is 1 and subtracts 1 where bit is 0, saturating
+        // at 255 and 0
+        __m128i add = _mm_and_si128(ones, one);
+        __m128i sub = _mm_andnot_si128(ones, one);
+        __m128i *ptr = (__m128i *)(px + i * CHAR_BIT);
+        __m128i value = _mm_loadu_si128(ptr);
+        value = _mm_subs_epu8(_mm_adds_epu8(value, add), sub);
+        _mm_storeu_si128(ptr, value);
+    }
+
+    embedDiffBitsScalar(px + i * CHAR_BIT, chars + i, charCount - i,
+                        UCHAR_MAX);
+}
+
+// AVX2 version of embedDiffBitsScalar() for 8-bit pixels, expanding 4
+// characters into a +1/-1 mask of 32 pixels per step.
+__attribute__((target("avx2")))
+static void embedDiffBitsAvx2(BYTE *px, const BYTE *chars, size_t charCount)
+{
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i = 0;
+
+    for (; i + 4 <= charCount; i += 4)
+    {
+        __m256i ones = spreadBitsAvx2(chars + i);
+
+        // Adds 1 where bit is 1 and subtracts 1 where bit is 0, saturating
+        // at 255 and 0
+        __m256i add = _mm256_and_si256(ones, one);
+        __m256i sub = _mm256_andnot_si256(ones, one);
+        __m256i *ptr = (__m256i *)(px + i * CHAR_BIT);
+        __m256i value = _mm256_loadu_si256(ptr);
+        value = _mm256_subs_epu8(_mm256_adds_epu8(value, add), sub);
+        _mm256_storeu_si256(ptr, value);
+    }
+
+    embedDiffBitsSse2(px + i * CHAR_BIT, chars + i, charCount - i);
+}
+
+// SSE2 version of embedLsbBitsScalar(), replacing the least significant bit
+// of 16 pixels per step.
+__attribute__((target("sse2")))
+static void embedLsbBitsSse2(BYTE *px, const BYTE *chars, size_t charCount)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    size_t i = 0;
+
+    for (; i + 2 <= charCount; i += 2)
+    {
+        __m128i bits = _mm_and_si128(spreadBitsSse2(chars + i), one);
+        __m128i *ptr = (__m128i *)(px + i * CHAR_BIT);
+        __m128i value = _mm_andnot_si128(one, _mm_loadu_si128(ptr));
+        _mm_storeu_si128(ptr, _mm_or_si128(value, bits));
+    }
+
+    embedLsbBitsScalar(px + i * CHAR_BIT, chars + i, charCount - i);
+}
+
+// AVX2 version of embedLsbBitsScalar(), replacing the least significant bit
+// of 32 pixels per step.
+__attribute__((target("avx2")))
+static void embedLsbBitsAvx2(BYTE *px, const BYTE *chars, size_t charCount)
+{
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i = 0;
+
+    for (; i + 4 <= charCount; i += 4)
+    {
+        __m256i bits = _mm256_and_si256(spreadBitsAvx2(chars + i), one);
+        __m256i *ptr = (__m256i *)(px + i * CHAR_BIT);
+        __m256i value = _mm256_andnot_si256(one, _mm256_loadu_si256(ptr));
+        _mm256_storeu_si256(ptr, _mm256_or_si256(value, bits));
+    }
+
+    embedLsbBitsSse2(px + i * CHAR_BIT, chars + i, charCount - i);
+}
+
+// SSE2 version of packLsbBytesScalar(), packing 16 pixels into 2 characters
+// per step.
+__attribute__((target("sse2")))
+static void packLsbBytesSse2(const BYTE *stegPx, size_t charCount, BYTE *out)
+{
+    size_t i = 0;
+
+    for (; i + 2 <= charCount; i += 2)
+    {
+        // Moves the least significant bit of each pixel to its sign bit
+        __m128i value =
+            _mm_loadu_si128((const __m128i *)(stegPx + i * CHAR_BIT));
+        unsigned int mask = _mm_movemask_epi8(_mm_slli_epi16(value, 7));
+
+        out[i] = reversedBits[mask & 0xFF];
+        out[i + 1] = reversedBits[mask >> 8];
+    }
+
+    packLsbBytesScalar(stegPx + i * CHAR_BIT, charCount - i, out + i);
+}
+
+// AVX2 version of packLsbBytesScalar(), packing 32 pixels into 4 characters
+// per step.
+__attribute__((target("avx2")))
+static void packLsbBytesAvx2(const BYTE *stegPx, size_t charCount, BYTE *out)
+{
+    const __m256i reverse = _mm256_setr_epi8(
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    size_t i = 0;
+
+    for (; i + 4 <= charCount; i += 4)
+    {
+        __m256i value =
+            _mm256_loadu_si256((const __m256i *)(stegPx + i * CHAR_BIT));
+        value = _mm256_shuffle_epi8(_mm256_slli_epi16(value, 7), reverse);
+        DWORD chars = (DWORD)_mm256_movemask_epi8(value);
+        memcpy(out + i, &chars, sizeof(chars)); // Bytes are in pixel order
+    }
+
+    packLsbBytesSse2(stegPx + i * CHAR_BIT, charCount - i, out + i);
+}
+
+// SSSE3 version of gatherChannelsScalar(), compacting 4 pixels per step. Each
+// step stores 16 bytes, of which the last 4 are overwritten by the next step,
+// so the loop stops while 6 pixels are left.
+__attribute__((target("ssse3")))
+static void gatherChannelsSsse3(const BYTE *row, LONG width, BYTE *out)
+{
+    const __m128i compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13,
+                                          14, -1, -1, -1, -1);
+    LONG px = 0;
+
+    for (; px + 6 <= width; px += 4)
+    {
+        __m128i value = _mm_loadu_si128((const __m128i *)(row + px * 4));
+        _mm_storeu_si128((__m128i *)(out + px * 3),
+                         _mm_shuffle_epi8(value, compact));
+    }
+
+    gatherChannelsScalar(row + px * 4, width - px, out + px * 3);
+}
+
+// SSSE3 version of scatterChannelsScalar(), expanding 4 pixels per step.
+// Each step loads 16 bytes of channels, so the loop stops while 6 pixels are
+// left.
+__attribute__((target("ssse3")))
+static void scatterChannelsSsse3(BYTE *row, LONG width, const BYTE *channels)
+{
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8,
+                                         -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    LONG px = 0;
+
+    for (; px + 6 <= width; px += 4)
+    {
+        __m128i value =
+            _mm_loadu_si128((const __m128i *)(channels + px * 3));
+        __m128i *ptr = (__m128i *)(row + px * 4);
+        __m128i kept = _mm_and_si128(_mm_loadu_si128(ptr), alpha);
+        _mm_storeu_si128(ptr, _mm_or_si128(kept,
+                                           _mm_shuffle_epi8(value, expand)));
+    }
+
+    scatterChannelsScalar(row + px * 4, width - px, channels + px * 3);
+}
+
+static BYTE syndromeTable[CHAR_BIT][256]; // Syndromes of each byte of a block
+static pthread_once_t syndromeOnce = PTHREAD_ONCE_INIT; // Fills table once
+
+// Fills syndromeTable, where entry [j][b] is the exclusive or of the
+// positions 8 * j + i of the bits i set in b: the share of the syndrome of a
+// Hamming block held by its byte j, once each pixel's bit is at its position
+// counted from 1. Returns none.
+static void fillSyndromeTable(void)
+{
+    for (unsigned int j = 0; j < CHAR_BIT; j++)
+    {
+        for (unsigned int b = 0; b < 256; b++)
+        {
+            BYTE syndrome = 0;
+            for (unsigned int i = 0; i < CHAR_BIT; i++)
+            {
+                syndrome ^= (b >> i) & 1 ? CHAR_BIT * j + i : 0;
+            }
+            syndromeTable[j][b] = syndrome;
+        }
+    }
+}
+
+// Stores in syndromes the syndromes of the HAMMING_CHUNK groups of 8 Hamming
+// blocks of k bits at px. The least significant bits of the chunk, which
+// fill HAMMING_PIXELS(k) words exactly, are gathered into a bitmap 16 pixels
+// at a time, then the syndrome of each block is looked up in syndromeTable a
+// byte at a time, one byte for blocks of up to 7 pixels. Returns none.
+__attribute__((target("sse2"), always_inline))
+static inline void chunkSyndromesSse2(const BYTE *px, int k,
+                               BYTE syndromes[HAMMING_CHUNK * CHAR_BIT])
+{
+    const unsigned int n = HAMMING_PIXELS(k);  // Pixels of each block
+    const unsigned int bytes = (n + CHAR_BIT) / CHAR_BIT; // Bytes of a block
+    const unsigned long long mask = ~0ULL >> (63 - n) & ~1ULL; // Positions
+    unsigned long long bitmap[HAMMING_PIXELS(HAMMING_MAX) + 1];
+
+    for (unsigned int w = 0; w < n; w++)
+    {
+        const BYTE *word = px + (size_t)w * 64;
+        unsigned long long bits = 0;
+        for (unsigned int i = 0; i < 64; i += 16)
+        {
+            __m128i value = _mm_loadu_si128((const __m128i *)(word + i));
+            bits |= (unsigned long long)(unsigned int)_mm_movemask_epi8(
+                        _mm_slli_epi16(value, 7))
+                    << i;
+        }
+        bitmap[w] = bits;
+    }
+    bitmap[n] = 0; // Read past the last block, never used
+
+    for (unsigned int b = 0; b < HAMMING_CHUNK * CHAR_BIT; b++)
+    {
+        size_t offset = (size_t)b * n; // First bit of block in bitmap
+        unsigned long long block = bitmap[offset / 64] >> (offset % 64);
+        if (offset % 64)
+        {
+            block |= bitmap[offset / 64 + 1] << (64 - offset % 64);
+        }
+        block = (block << 1) & mask; // Pixel i at position i + 1
+
+        unsigned int syndrome = 0;
+        for (unsigned int j = 0; j < bytes; j++)
+        {
+            syndrome ^= syndromeTable[j][(block >> (CHAR_BIT * j)) & 0xFF];
+        }
+        syndromes[b] = syndrome;
+    }
+}
+
+// Encodes the HAMMING_CHUNK groups of k characters chars into the chunk of
+// Hamming blocks at px, looking up their syndromes at once. The pixel of
+// each block is flipped without branching, since a block needs no change
+// only once in 2^k. Returns none.
+__attribute__((target("sse2"), always_inline))
+static inline void embedChunkSse2(BYTE *px, const BYTE *chars, int k)
+{
+    const unsigned int n = HAMMING_PIXELS(k); // Pixels of each block
+    BYTE syndromes[HAMMING_CHUNK * CHAR_BIT];
+
+    chunkSyndromesSse2(px, k, syndromes);
+    for (unsigned int c = 0; c < HAMMING_CHUNK; c++)
+    {
+        unsigned long long value = loadGroup(chars + c * k, k);
+        for (unsigned int i = 0; i < CHAR_BIT; i++)
+        {
+            unsigned int b = c * CHAR_BIT + i; // Block in chunk
+            unsigned int bits = (value >> (k * (CHAR_BIT - 1 - i))) & n;
+            unsigned int change = syndromes[b] ^ bits;
+            unsigned int flip = change != 0;
+            px[b * n + change - flip] ^= flip;
+        }
+    }
+}
+
+// Packs the syndromes of the chunk of Hamming blocks at stegPx into
+// HAMMING_CHUNK groups of k bytes in out. Returns none.
+__attribute__((target("sse2"), always_inline))
+static inline void packChunkSse2(const BYTE *stegPx, BYTE *out, int k)
+{
+    BYTE syndromes[HAMMING_CHUNK * CHAR_BIT];
+
+    chunkSyndromesSse2(stegPx, k, syndromes);
+    for (unsigned int c = 0; c < HAMMING_CHUNK; c++)
+    {
+        unsigned long long value = 0;
+        for (unsigned int i = 0; i < CHAR_BIT; i++)
+        {
+            value = (value << k) | syndromes[c * CHAR_BIT + i];
+        }
+        storeGroup(out + c * k, value, k);
+    }
+}
+
+// Calls chunk routine call, written with k, with k as a constant for each
+// size of block, so shifts and loops over block bits are unrolled.
+#define HAMMING_CASES(call)                                                    \
+    switch (k)                                                                 \
+    {                                                                          \
+    case 2: { const int k = 2; call; } break;                                  \
+    case 3: { const int k = 3; call; } break;                                  \
+    case 4: { const int k = 4; call; } break;                                  \
+    case 5: { const int k = 5; call; } break;                                  \
+    default: { const int k = HAMMING_MAX; call; } break;                       \
+    }
+
+// SSE2 version of embedHammingGroupsScalar(), looking up the syndromes of
+// HAMMING_CHUNK groups at a time.
+__attribute__((target("sse2")))
+static void embedHammingGroupsSse2(BYTE *px, const BYTE *chars, size_t groups,
+                                   int k)
+{
+    const unsigned int n = HAMMING_PIXELS(k); // Pixels of each block
+    size_t g = 0;
+
+    pthread_once(&syndromeOnce, fillSyndromeTable);
+    for (; g + HAMMING_CHUNK <= groups; g += HAMMING_CHUNK)
+    {
+        HAMMING_CASES(embedChunkSse2(px + g * CHAR_BIT * n, chars + g * k, k))
+    }
+
+    embedHammingGroupsScalar(px + g * CHAR_BIT * n, chars + g * k,
+                             groups - g, k);
+}
+
+// SSE2 version of packHammingGroupsScalar(), looking up the syndromes of
+// HAMMING_CHUNK groups at a time.
+__attribute__((target("sse2")))
+static void packHammingGroupsSse2(const BYTE *stegPx, size_t groups,
+                                  BYTE *out, int k)
+{
+    const unsigned int n = HAMMING_PIXELS(k); // Pixels of each block
+    size_t g = 0;
+
+    pthread_once(&syndromeOnce, fillSyndromeTable);
+    for (; g + HAMMING_CHUNK <= groups; g += HAMMING_CHUNK)
+    {
+        HAMMING_CASES(packChunkSse2(stegPx + g * CHAR_BIT * n, out + g * k, k))
+    }
+
+    packHammingGroupsScalar(stegPx + g * CHAR_BIT * n, groups - g,
+                            out + g * k, k);
+}
+
+#undef HAMMING_CASES
+
+struct hammingLanes   // Structure representing Hamming blocks moved to lanes
+{
+    BYTE spread[16];          // Moves each block of a window into a lane
+    BYTE broadcast[16];       // Copies the first byte of each lane over it
+    BYTE positions[16];       // Position of each pixel in its block, 0 if none
+    BYTE back[16][2][16];     // Moves lanes of each window back to its vectors
+    BYTE gather[16][16];      // Moves first byte of each lane of a window to
+                              // the place of its block in the tile
+    BYTE wanted[256][16];     // Syndromes wanted of a window, by its text bits
+};
+
+static struct hammingLanes hammingLanes[HAMMING_LANE_MAX - 1]; // By k - 2
+static pthread_once_t lanesOnce = PTHREAD_ONCE_INIT; // Fills lanes once
+
+// Fills hammingLanes for blocks of 2 to HAMMING_LANE_MAX bits. A window of
+// 16 bytes holds 16 / (n + 1) blocks of n pixels, each moved into a lane of
+// n + 1 bytes, so a tile of 16 blocks spans n vectors and 16 / (n + 1)
+// windows. Returns none.
+static void fillHammingLanes(void)
+{
+    for (int k = 2; k <= HAMMING_LANE_MAX; k++)
+    {
+        struct hammingLanes *lanesPtr = &hammingLanes[k - 2];
+        const int n = HAMMING_PIXELS(k); // Pixels of each block
+        const int lane = n + 1;          // Bytes of each lane
+        const int blocks = 16 / lane;    // Blocks of each window
+        const int pixels = blocks * n;   // Pixels of each window
+
+        for (int j = 0; j < 16; j++)
+        {
+            int offset = j % lane; // Pixel of block held by byte j of lane
+            lanesPtr->spread[j] = offset < n ? j / lane * n + offset : 0x80;
+            lanesPtr->broadcast[j] = j - offset;
+            lanesPtr->positions[j] = offset < n ? offset + 1 : 0;
+        }
+
+        for (int w = 0; w < 16 / blocks; w++)
+        {
+            int first = w * pixels; // First pixel of window in tile
+            for (int j = 0; j < 16; j++)
+            {
+                for (int r = 0; r < 2; r++)
+                {
+                    int p = (first / 16 + r) * 16 + j - first; // In window
+                    lanesPtr->back[w][r][j] =
+                        p >= 0 && p < pixels ? p / n * lane + p % n : 0x80;
+                }
+                lanesPtr->gather[w][j] =
+                    j / blocks == w ? j % blocks * lane : 0x80;
+            }
+        }
+
+        for (int bits = 0; bits < 1 << (blocks * k); bits++)
+        {
+            for (int i = 0; i < blocks; i++)
+            {
+                lanesPtr->wanted[bits][i * lane] =
+                    (bits >> (k * (blocks - 1 - i))) & n;
+            }
+        }
+    }
+}
+
+// Returns the syndromes of the blocks of k bits in the window at px, each in
+// the first byte of its lane, by folding the positions of pixels whose least
+// significant bit is set over their lane.
+__attribute__((target("ssse3"), always_inline))
+static inline __m128i windowSyndromesSsse3(const BYTE *px, int k,
+                                           const struct hammingLanes *lanesPtr)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i value = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i *)px),
+        _mm_loadu_si128((const __m128i *)lanesPtr->spread));
+    __m128i syndromes = _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_and_si128(value, one), one),
+        _mm_loadu_si128((const __m128i *)lanesPtr->positions));
+
+    if (k == 2)
+    {
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_epi32(syndromes, 16));
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_epi32(syndromes, 8));
+    }
+    else if (k == 3)
+    {
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_epi64(syndromes, 32));
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_epi64(syndromes, 16));
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_epi64(syndromes, 8));
+    }
+    else
+    {
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_si128(syndromes, 8));
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_si128(syndromes, 4));
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_si128(syndromes, 2));
+        syndromes = _mm_xor_si128(syndromes, _mm_srli_si128(syndromes, 1));
+    }
+
+    return syndromes;
+}
+
+// Encodes 2 groups of k characters chars into the tile of 16 Hamming blocks
+// at px. The pixels to flip are found a window at a time, moved back to the
+// n vectors of the tile and flipped once every window is read. Reads up to
+// 4 bytes past the tile. Returns none.
+__attribute__((target("ssse3"), always_inline))
+static inline void embedTileSsse3(BYTE *px, const BYTE *chars, int k)
+{
+    const struct hammingLanes *lanesPtr = &hammingLanes[k - 2];
+    const int n = HAMMING_PIXELS(k);            // Pixels of each block
+    const int blocks = 16 / (n + 1);            // Blocks of each window
+    const int pixels = blocks * n;              // Pixels of each window
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i broadcast =
+        _mm_loadu_si128((const __m128i *)lanesPtr->broadcast);
+    const __m128i positions =
+        _mm_loadu_si128((const __m128i *)lanesPtr->positions);
+    unsigned long long text = loadGroup(chars, 2 * k);
+    __m128i flips[HAMMING_PIXELS(HAMMING_LANE_MAX)];
+
+    for (int r = 0; r < n; r++)
+    {
+        flips[r] = _mm_setzero_si128();
+    }
+
+    for (int w = 0; w < 16 / blocks; w++)
+    {
+        int shift = 2 * k * CHAR_BIT - blocks * k * (w + 1); // Window bits
+        unsigned int bits = (text >> shift) & ((1u << (blocks * k)) - 1);
+        __m128i change = _mm_xor_si128(
+            windowSyndromesSsse3(px + w * pixels, k, lanesPtr),
+            _mm_loadu_si128((const __m128i *)lanesPtr->wanted[bits]));
+        __m128i flip = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_shuffle_epi8(change, broadcast), positions),
+            one);
+
+        int r = w * pixels / 16; // First vector overlapped by window
+        for (int i = 0; i < 2 && r + i < n; i++)
+        {
+            __m128i back =
+                _mm_loadu_si128((const __m128i *)lanesPtr->back[w][i]);
+            flips[r + i] =
+                _mm_or_si128(flips[r + i], _mm_shuffle_epi8(flip, back));
+        }
+    }
+
+    for (int r = 0; r < n; r++)
+    {
+        __m128i *ptr = (__m128i *)(px + r * 16);
+        _mm_storeu_si128(ptr, _mm_xor_si128(_mm_loadu_si128(ptr), flips[r]));
+    }
+}
+
+// Packs the syndromes of the tile of 16 Hamming blocks at stegPx into 2
+// groups of k bytes in out. Reads up to 4 bytes past the tile. Returns none.
+__attribute__((target("ssse3"), always_inline))
+static inline void packTileSsse3(const BYTE *stegPx, BYTE *out, int k)
+{
+    const struct hammingLanes *lanesPtr = &hammingLanes[k - 2];
+    const int n = HAMMING_PIXELS(k);            // Pixels of each block
+    const int blocks = 16 / (n + 1);            // Blocks of each window
+    __m128i tile = _mm_setzero_si128();
+    BYTE blockSyndromes[16];
+
+    for (int w = 0; w < 16 / blocks; w++)
+    {
+        __m128i syndromes =
+            windowSyndromesSsse3(stegPx + w * blocks * n, k, lanesPtr);
+        __m128i gather = _mm_loadu_si128((const __m128i *)lanesPtr->gather[w]);
+        tile = _mm_or_si128(tile, _mm_shuffle_epi8(syndromes, gather));
+    }
+    _mm_storeu_si128((__m128i *)blockSyndromes, tile);
+
+    unsigned long long value = 0;
+    for (int b = 0; b < 16; b++)
+    {
+        value = (value << k) | blockSyndromes[b];
+    }
+    storeGroup(out, value, 2 * k);
+}
+
+// Calls tile routine call, written with k, with k as a constant for each
+// size of block moved into lanes.
+#define LANE_CASES(call)                                                       \
+    switch (k)                                                                 \
+    {                                                                          \
+    case 2: { const int k = 2; call; } break;                                  \
+    case 3: { const int k = 3; call; } break;                                  \
+    default: { const int k = HAMMING_LANE_MAX; call; } break;                  \
+    }
+
+// SSSE3 version of embedHammingGroupsScalar() for k of up to
+// HAMMING_LANE_MAX, encoding 2 groups at a time with each block in a lane of
+// its own. The tiles leave at least one group to the scalar kernel, as their
+// windows read past them.
+__attribute__((target("ssse3")))
+static void embedHammingGroupsSsse3(BYTE *px, const BYTE *chars,
+                                    size_t groups, int k)
+{
+    const unsigned int n = HAMMING_PIXELS(k); // Pixels of each block
+    size_t g = 0;
+
+    pthread_once(&lanesOnce, fillHammingLanes);
+    for (; g + 2 < groups; g += 2)
+    {
+        LANE_CASES(embedTileSsse3(px + g * CHAR_BIT * n, chars + g * k, k))
+    }
+
+    embedHammingGroupsScalar(px + g * CHAR_BIT * n, chars + g * k,
+                             groups - g, k);
+}
+
+// SSSE3 version of packHammingGroupsScalar() for k of up to
+// HAMMING_LANE_MAX, packing 2 groups at a time with each block in a lane of
+// its own.
+__attribute__((target("ssse3")))
+static void packHammingGroupsSsse3(const BYTE *stegPx, size_t groups,
+                                   BYTE *out, int k)
+{
+    const unsigned int n = HAMMING_PIXELS(k); // Pixels of each block
+    size_t g = 0;
+
+    pthread_once(&lanesOnce, fillHammingLanes);
+    for (; g + 2 < groups; g += 2)
+    {
+        LANE_CASES(packTileSsse3(stegPx + g * CHAR_BIT * n, out + g * k, k))
+    }
+
+    packHammingGroupsScalar(stegPx + g * CHAR_BIT * n, groups - g,
+                            out + g * k, k);
+}
+
+#undef LANE_CASES
+
+// Returns CRC32C remainder crc moved past CRC_STRIDE null bytes, looking up
+// each of its bytes in strideTable.
+static inline unsigned int shiftStride(unsigned int crc)
+{
+    return strideTable[0][crc & 0xFF] ^ strideTable[1][(crc >> 8) & 0xFF] ^
+           strideTable[2][(crc >> 16) & 0xFF] ^ strideTable[3][crc >> 24];
+}
+
+// SSE4.2 version of crc32cScalar(), folding 8 bytes at a time, or 4 on 32-bit
+// processors, with the crc32 instruction. Three strides of CRC_STRIDE bytes
+// are folded at once, hiding the latency of the instruction, then joined by
+// moving the remainders of the first two past the strides after them.
+__attribute__((target("sse4.2")))
+static unsigned int crc32cSse42(unsigned int crc, const BYTE *data,
+                                size_t length)
+{
+    crc = ~crc;
+
+#ifdef __x86_64__
+    if (length >= 3 * CRC_STRIDE)
+    {
+        pthread_once(&crcOnce, fillCrcTable);
+    }
+    for (; length >= 3 * CRC_STRIDE;
+         data += 3 * CRC_STRIDE, length -= 3 * CRC_STRIDE)
+    {
+        unsigned long long first = crc, second = 0, third = 0;
+        for (size_t i = 0; i < CRC_STRIDE; i += 8)
+        {
+            unsigned long long words[3];
+            memcpy(&words[0], data + i, sizeof(words[0]));
+            memcpy(&words[1], data + CRC_STRIDE + i, sizeof(words[1]));
+            memcpy(&words[2], data + 2 * CRC_STRIDE + i, sizeof(words[2]));
+            first = _mm_crc32_u64(first, words[0]);
+            second = _mm_crc32_u64(second, words[1]);
+            third = _mm_crc32_u64(third, words[2]);
+        }
+        crc = shiftStride(shiftStride((unsigned int)first) ^
+                          (unsigned int)second) ^
+              (unsigned int)third;
+    }
+
+    unsigned long long wide = crc; // Remainder kept in a 64-bit register
+    for (; length >= 8; data += 8, length -= 8)
+    {
+        unsigned long long eight;
+        memcpy(&eight, data, sizeof(eight));
+        wide = _mm_crc32_u64(wide, eight);
+    }
+    crc = (unsigned int)wide;
+#endif
+    for (; length >= 4; data += 4, length -= 4)
+    {
+        unsigned int four;
+        memcpy(&four, data, sizeof(four));
+        crc = _mm_crc32_u32(crc, four);
+    }
+    for (; length > 0; data++, length--)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+
+    return ~crc;
+}
+
+// SSE2 version of isAsciiScalar(), merging 64 characters per step.
+__attribute__((target("sse2")))
+static int isAsciiSse2(const BYTE *chars, size_t length)
+{
+    __m128i high = _mm_setzero_si128(); // Union of the bits of characters
+    size_t i = 0;
+
+    for (; i + 64 <= length; i += 64)
+    {
+        const __m128i *ptr = (const __m128i *)(chars + i);
+        __m128i a = _mm_or_si128(_mm_loadu_si128(ptr), _mm_loadu_si128(ptr + 1));
+        __m128i b = _mm_or_si128(_mm_loadu_si128(ptr + 2),
+                                 _mm_loadu_si128(ptr + 3));
+        high = _mm_or_si128(high, _mm_or_si128(a, b));
+    }
+
+    // Movemask gathers the high bit of each byte
+    return _mm_movemask_epi8(high) == 0 &&
+           isAsciiScalar(chars + i, length - i);
+}
+
+// AVX2 version of isAsciiScalar(), merging 128 characters per step.
+__attribute__((target("avx2")))
+static int isAsciiAvx2(const BYTE *chars, size_t length)
+{
+    __m256i high = _mm256_setzero_si256(); // Union of the bits of characters
+    size_t i = 0;
+
+    for (; i + 128 <= length; i += 128)
+    {
+        const __m256i *ptr = (const __m256i *)(chars + i);
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256(ptr),
+                                    _mm256_loadu_si256(ptr + 1));
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256(ptr + 2),
+                                    _mm256_loadu_si256(ptr + 3));
+        high = _mm256_or_si256(high, _mm256_or_si256(a, b));
+    }
+
+    return _mm256_movemask_epi8(high) == 0 &&
+           isAsciiSse2(chars + i, length - i);
+}
+
+// SSE2 version of measureDistortionScalar(), measuring 16 bytes per step.
+// Squares are summed in 32-bit lanes, which DISTORTION_STEPS steps cannot
+// overflow, then widened to 64 bits.
+__attribute__((target("sse2")))
+static void measureDistortionSse2(const BYTE *covPx, const BYTE *stegPx,
+                                  size_t count, DISTORTION *distPtr)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i squares = zero;  // 64-bit sums of squared differences
+    __m128i changed = zero;  // 64-bit counts of differing bytes
+    __m128i maxDelta = zero; // Largest difference of each byte lane
+    size_t i = 0;
+
+    while (i + 16 <= count)
+    {
+        size_t end = count - i > 16 * DISTORTION_STEPS
+                         ? i + 16 * DISTORTION_STEPS
+                         : count;
+        __m128i partial = zero; // 32-bit sums of squares of these steps
+
+        for (; i + 16 <= end; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)(covPx + i));
+            __m128i b = _mm_loadu_si128((const __m128i *)(stegPx + i));
+
+            // Saturated subtraction both ways leaves the absolute difference
+            __m128i delta = _mm_or_si128(_mm_subs_epu8(a, b),
+                                         _mm_subs_epu8(b, a));
+            maxDelta = _mm_max_epu8(maxDelta, delta);
+
+            // Sums 1 for each nonzero difference across 8-byte halves
+            changed = _mm_add_epi64(
+                changed, _mm_sad_epu8(_mm_min_epu8(delta, one), zero));
+
+            __m128i low = _mm_unpacklo_epi8(delta, zero);
+            __m128i high = _mm_unpackhi_epi8(delta, zero);
+            partial = _mm_add_epi32(partial,
+                                    _mm_add_epi32(_mm_madd_epi16(low, low),
+                                                  _mm_madd_epi16(high, high)));
+        }
+
+        squares = _mm_add_epi64(squares,
+                                _mm_add_epi64(_mm_unpacklo_epi32(partial, zero),
+                                              _mm_unpackhi_epi32(partial, zero)));
+    }
+
+    unsigned long long sums[2], counts[2];
+    BYTE deltas[16];
+    _mm_storeu_si128((__m128i *)sums, squares);
+    _mm_storeu_si128((__m128i *)counts, changed);
+    _mm_storeu_si128((__m128i *)deltas, maxDelta);
+
+    distPtr->squares += sums[0] + sums[1];
+    distPtr->changed += counts[0] + counts[1];
+    for (int lane = 0; lane < 16; lane++)
+    {
+        if (deltas[lane] > distPtr->maxDelta)
+        {
+            distPtr->maxDelta = deltas[lane];
+        }
+    }
+
+    measureDistortionScalar(covPx + i, stegPx + i, count - i, distPtr);
+}
+
+// AVX2 version of measureDistortionScalar(), measuring 32 bytes per step.
+__attribute__((target("avx2")))
+static void measureDistortionAvx2(const BYTE *covPx, const BYTE *stegPx,
+                                  size_t count, DISTORTION *distPtr)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    __m256i squares = zero;  // 64-bit sums of squared differences
+    __m256i changed = zero;  // 64-bit counts of differing bytes
+    __m256i maxDelta = zero; // Largest difference of each byte lane
+    size_t i = 0;
+
+    while (i + 32 <= count)
+    {
+        size_t end = count - i > 32 * DISTORTION_STEPS
+                         ? i + 32 * DISTORTION_STEPS
+                         : count;
+        __m256i partial = zero; // 32-bit sums of squares of these steps
+
+        for (; i + 32 <= end; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(covPx + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(stegPx + i));
+            __m256i delta = _mm256_or_si256(_mm256_subs_epu8(a, b),
+                                            _mm256_subs_epu8(b, a));
+            maxDelta = _mm256_max_epu8(maxDelta, delta);
+            changed = _mm256_add_epi64(
+                changed, _mm256_sad_epu8(_mm256_min_epu8(delta, one), zero));
+
+            // Unpacking within 128-bit lanes reorders bytes, which sums
+            // ignore
+            __m256i low = _mm256_unpacklo_epi8(delta, zero);
+            __m256i high = _mm256_unpackhi_epi8(delta, zero);
+            partial = _mm256_add_epi32(
+                partial, _mm256_add_epi32(_mm256_madd_epi16(low, low),
+                                          _mm256_madd_epi16(high, high)));
+        }
+
+        squares = _mm256_add_epi64(
+            squares, _mm256_add_epi64(_mm256_unpacklo_epi32(partial, zero),
+                                      _mm256_unpackhi_epi32(partial, zero)));
+    }
+
+    unsigned long long sums[4], counts[4];
+    BYTE deltas[32];
+    _mm256_storeu_si256((__m256i *)sums, squares);
+    _mm256_storeu_si256((__m256i *)counts, changed);
+    _mm256_storeu_si256((__m256i *)deltas, maxDelta);
+
+    distPtr->squares += sums[0] + sums[1] + sums[2] + sums[3];
+    distPtr->changed += counts[0] + counts[1] + counts[2] + counts[3];
+    for (int lane = 0; lane < 32; lane++)
+    {
+        if (deltas[lane] > distPtr->maxDelta)
+        {
+            distPtr->maxDelta = deltas[lane];
+        }
+    }
+
+    measureDistortionSse2(covPx + i, stegPx + i, count - i, distPtr);
+}
+
+#endif
+
+// Returns nonzero if each of the length characters chars is ASCII, using the
+// widest vector instructions the processor supports.
+int isAscii(const BYTE *chars, size_t length)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return isAsciiAvx2(chars, length);
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return isAsciiSse2(chars, length);
+    }
+#endif
+
+    return isAsciiScalar(chars, length);
+}
+
+// Adds to the structure pointed to by distPtr the differences between count
+// cover bytes covPx and stego bytes stegPx, using the widest vector
+// instructions the processor supports. Returns none.
+void measureDistortion(const BYTE *covPx, const BYTE *stegPx, size_t count,
+                       DISTORTION *distPtr)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        measureDistortionAvx2(covPx, stegPx, count, distPtr);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        measureDistortionSse2(covPx, stegPx, count, distPtr);
+        return;
+    }
+#endif
+
+    measureDistortionScalar(covPx, stegPx, count, distPtr);
+}
+
+// Encodes the bits of charCount characters chars into 8 * charCount 8-bit
+// pixels px using the widest vector instructions the processor supports.
+// Output is identical to embedDiffBitsScalar() with a limit of 255.
+// Returns none.
+void embedDiffBits(BYTE *px, const BYTE *chars, size_t charCount)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        embedDiffBitsAvx2(px, chars, charCount);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        embedDiffBitsSse2(px, chars, charCount);
+        return;
+    }
+#endif
+
+    embedDiffBitsScalar(px, chars, charCount, UCHAR_MAX);
+}
+
+// Packs the bits stored in 8 * charCount pixels of cover pixels covPx and
+// stego pixels stegPx into characters in out, using the widest vector
+// instructions the processor supports. Stops before the first character that
+// ends the secret text. Returns number of characters stored in out.
+size_t packDiffBits(const BYTE *covPx, const BYTE *stegPx, size_t charCount,
+                    BYTE *out)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return packDiffBitsAvx2(covPx, stegPx, charCount, out);
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return packDiffBitsSse2(covPx, stegPx, charCount, out);
+    }
+#endif
+
+    return packDiffBitsScalar(covPx, stegPx, charCount, out);
+}
+
+// Packs the bits stored in 8 * charCount pixels of cover pixels covPx and
+// stego pixels stegPx into exactly charCount bytes in out, whatever their
+// values, using the widest vector instructions the processor supports. Used
+// for payloads whose length is known in advance. Returns none.
+void packDiffBytes(const BYTE *covPx, const BYTE *stegPx, size_t charCount,
+                   BYTE *out)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        packDiffBytesAvx2(covPx, stegPx, charCount, out);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        packDiffBytesSse2(covPx, stegPx, charCount, out);
+        return;
+    }
+#endif
+
+    packScalar(covPx, stegPx, charCount, out, 0);
+}
+
+// Encodes the bits of charCount characters chars into the least significant
+// bit of 8 * charCount pixels px using the widest vector instructions the
+// processor supports. Returns none.
+void embedLsbBits(BYTE *px, const BYTE *chars, size_t charCount)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        embedLsbBitsAvx2(px, chars, charCount);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        embedLsbBitsSse2(px, chars, charCount);
+        return;
+    }
+#endif
+
+    embedLsbBitsScalar(px, chars, charCount);
+}
+
+// Packs the least significant bits of 8 * charCount stego pixels stegPx into
+// charCount bytes in out using the widest vector instructions the processor
+// supports. Returns none.
+void packLsbBytes(const BYTE *stegPx, size_t charCount, BYTE *out)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        packLsbBytesAvx2(stegPx, charCount, out);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        packLsbBytesSse2(stegPx, charCount, out);
+        return;
+    }
+#endif
+
+    packLsbBytesScalar(stegPx, charCount, out);
+}
+
+// Copies the blue, green and red channels of width 32-bit BGRA pixels in row
+// into 3 * width bytes in out, dropping alpha, using vector instructions if
+// the processor supports them. Returns none.
+void gatherChannels(const BYTE *row, LONG width, BYTE *out)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        gatherChannelsSsse3(row, width, out);
+        return;
+    }
+#endif
+
+    gatherChannelsScalar(row, width, out);
+}
+
+// Copies 3 * width bytes of channels back into the blue, green and red
+// channels of width 32-bit BGRA pixels in row, keeping alpha, using vector
+// instructions if the processor supports them. Returns none.
+void scatterChannels(BYTE *row, LONG width, const BYTE *channels)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        scatterChannelsSsse3(row, width, channels);
+        return;
+    }
+#endif
+
+    scatterChannelsScalar(row, width, channels);
+}
+
+// Encodes groups of density characters chars into the density least
+// significant bits of 8 pixels px per group, for a density of 1 to 4 bits per
+// pixel, using the fastest kernel the processor supports. Returns none.
+void embedLsbGroups(BYTE *px, const BYTE *chars, size_t groups, int density)
+{
+    if (density == 1)
+    {
+        embedLsbBits(px, chars, groups);
+        return;
+    }
+#ifdef KERNELS_BMI2
+    if (__builtin_cpu_supports("bmi2"))
+    {
+        embedLsbGroupsBmi2(px, chars, groups, density);
+        return;
+    }
+#endif
+
+    embedLsbGroupsScalar(px, chars, groups, density);
+}
+
+// Packs the density least significant bits of 8 stego pixels stegPx per
+// group into density bytes in out, for a density of 1 to 4 bits per pixel,
+// using the fastest kernel the processor supports. Returns none.
+void packLsbGroups(const BYTE *stegPx, size_t groups, BYTE *out, int density)
+{
+    if (density == 1)
+    {
+        packLsbBytes(stegPx, groups, out);
+        return;
+    }
+#ifdef KERNELS_BMI2
+    if (__builtin_cpu_supports("bmi2"))
+    {
+        packLsbGroupsBmi2(stegPx, groups, out, density);
+        return;
+    }
+#endif
+
+    packLsbGroupsScalar(stegPx, groups, out, density);
+}
+
+// Encodes groups of k characters chars into 8 Hamming blocks of
+// HAMMING_PIXELS(k) pixels px per group, for k of 2 to HAMMING_MAX, using the
+// fastest kernel the processor supports. Returns none.
+void embedHammingGroups(BYTE *px, const BYTE *chars, size_t groups, int k)
+{
+#ifdef KERNELS_X86
+    if (k <= HAMMING_LANE_MAX && __builtin_cpu_supports("ssse3"))
+    {
+        embedHammingGroupsSsse3(px, chars, groups, k);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        embedHammingGroupsSse2(px, chars, groups, k);
+        return;
+    }
+#endif
+
+    embedHammingGroupsScalar(px, chars, groups, k);
+}
+
+// Packs the syndromes of 8 Hamming blocks of HAMMING_PIXELS(k) stego pixels
+// stegPx per group into k bytes in out, for k of 2 to HAMMING_MAX, using the
+// fastest kernel the processor supports. Returns none.
+void packHammingGroups(const BYTE *stegPx, size_t groups, BYTE *out, int k)
+{
+#ifdef KERNELS_X86
+    if (k <= HAMMING_LANE_MAX && __builtin_cpu_supports("ssse3"))
+    {
+        packHammingGroupsSsse3(stegPx, groups, out, k);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        packHammingGroupsSse2(stegPx, groups, out, k);
+        return;
+    }
+#endif
+
+    packHammingGroupsScalar(stegPx, groups, out, k);
+}
+
+// Returns the CRC32C of the length bytes data appended to bytes whose CRC32C
+// is crc, which is 0 for no bytes, using the fastest kernel the processor
+// supports.
+unsigned int crc32c(unsigned int crc, const BYTE *data, size_t length)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return crc32cSse42(crc, data, length);
+    }
+#endif
+
+    return crc32cScalar(crc, data, length);
+}
+
+// Returns name of the instruction set used by the kernels.
+const char *kernelName(void)
+{
+#ifdef KERNELS_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return "avx2";
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return "sse2";
+    }
+#endif
+
+    return "scalar";
+}
+
+// Returns name of the instruction set used by embedLsbGroups() and
+// packLsbGroups() for density bits per pixel.
+const char *lsbGroupsKernelName(int density)
+{
+    if (density == 1)
+    {
+        return kernelName();
+    }
+#ifdef KERNELS_BMI2
+    if (__builtin_cpu_supports("bmi2"))
+    {
+        return "bmi2";
+    }
+#endif
+
+    return "scalar";
+}
+
+// Returns name of the instruction set used by embedHammingGroups() and
+// packHammingGroups() for blocks of k bits.
+const char *hammingKernelName(int k)
+{
+#ifdef KERNELS_X86
+    if (k <= HAMMING_LANE_MAX && __builtin_cpu_supports("ssse3"))
+    {
+        return "ssse3";
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return "sse2";
+    }
+#endif
+
+    return "scalar";
+}
@@ -0,0 +1,120 @@
+/*
+ *  Filename:
+ *      kernels.h
+ *
+ *  Purpose:
+ *      To declare vectorized kernels, with scalar fallbacks, for the inner
+ *      loops of encoding and decoding.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - added embedding kernels
+ *                      - added ASCII validation kernels
+ *                      - added packing kernels for payloads of known length
+ *                      - added least significant bit kernels for blind mode
+ *                      - added channel kernels for 32-bit pixels
+ *                      - added multi-bit least significant bit kernels
+ *                      - added Hamming matrix embedding kernels
+ *                      - added CRC32C checksum kernels
+ *                      - added distortion kernels for image analysis
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "stegano.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1       // Vector kernels are compiled in
+#include <immintrin.h>
+#ifdef __x86_64__
+#define KERNELS_BMI2 1      // 64-bit deposit and extract kernels are compiled in
+#endif
+#endif
+
+#define HAMMING_CHUNK 8      // Groups of Hamming blocks filling a bitmap of words
+#define HAMMING_LANE_MAX 4   // Largest k with a Hamming block in each vector lane
+#define CRC32C_POLY 0x82F63B78u // Castagnoli polynomial, bits reversed
+#define CRC_STRIDE 512       // Bytes of each of 3 strides checksummed at once
+#define DISTORTION_STEPS 4096 // Vector steps summing squares in 32-bit lanes
+
+struct distortion     // Structure representing differences between pixels
+{
+    unsigned long long squares; // Sum of squared differences
+    unsigned long long changed; // Number of bytes that differ
+    BYTE maxDelta;              // Largest absolute difference
+};
+
+typedef struct distortion DISTORTION; // Defines new data type name for struct distortion
+
+// Encodes bit into the pixel pointed to by pxPtr by adding 1 for a bit value
+// of 1 and subtracting 1 for a bit value of 0, keeping the pixel within 0 and
+// maxPxValue. Returns none.
+static inline void embedDiffBit(BYTE *pxPtr, int bit, int maxPxValue)
+{
+    if (bit) // Current bit is 1
+    {
+        // Increases pixel value by 1 up to the limit of the color depth
+        if (*pxPtr < maxPxValue)
+        {
+            *pxPtr += 1;
+        }
+    }
+    else if (*pxPtr > 0) // Current bit is 0; avoids negative pixel value
+    {
+        *pxPtr -= 1; // Decreases pixel value by 1
+    }
+}
+
+// Encodes bit into the pixel pointed to by pxPtr by replacing its least
+// significant bit. Returns none.
+static inline void embedLsbBit(BYTE *pxPtr, int bit)
+{
+    *pxPtr = (*pxPtr & ~1) | bit;
+}
+
+// Function prototypes
+size_t packDiffBits(const BYTE *covPx, const BYTE *stegPx, size_t charCount,
+                    BYTE *out);
+size_t packDiffBitsScalar(const BYTE *covPx, const BYTE *stegPx,
+                          size_t charCount, BYTE *out);
+void packDiffBytes(const BYTE *covPx, const BYTE *stegPx, size_t charCount,
+                   BYTE *out);
+void embedDiffBits(BYTE *px, const BYTE *chars, size_t charCount);
+void embedDiffBitsScalar(BYTE *px, const BYTE *chars, size_t charCount,
+                         int maxPxValue);
+void embedLsbBits(BYTE *px, const BYTE *chars, size_t charCount);
+void embedLsbBitsScalar(BYTE *px, const BYTE *chars, size_t charCount);
+void packLsbBytes(const BYTE *stegPx, size_t charCount, BYTE *out);
+void packLsbBytesScalar(const BYTE *stegPx, size_t charCount, BYTE *out);
+void embedLsbGroups(BYTE *px, const BYTE *chars, size_t groups, int density);
+void embedLsbGroupsScalar(BYTE *px, const BYTE *chars, size_t groups,
+                          int density);
+void packLsbGroups(const BYTE *stegPx, size_t groups, BYTE *out, int density);
+void packLsbGroupsScalar(const BYTE *stegPx, size_t groups, BYTE *out,
+                         int density);
+void embedHammingGroups(BYTE *px, const BYTE *chars, size_t groups, int k);
+void embedHammingGroupsScalar(BYTE *px, const BYTE *chars, size_t groups,
+                              int k);
+void packHammingGroups(const BYTE *stegPx, size_t groups, BYTE *out, int k);
+void packHammingGroupsScalar(const BYTE *stegPx, size_t groups, BYTE *out,
+                             int k);
+void gatherChannels(const BYTE *row, LONG width, BYTE *out);
+void gatherChannelsScalar(const BYTE *row, LONG width, BYTE *out);
+void scatterChannels(BYTE *row, LONG width, const BYTE *channels);
+void scatterChannelsScalar(BYTE *row, LONG width, const BYTE *channels);
+int isAscii(const BYTE *chars, size_t length);
+int isAsciiScalar(const BYTE *chars, size_t length);
+unsigned int crc32c(unsigned int crc, const BYTE *data, size_t length);
+unsigned int crc32cScalar(unsigned int crc, const BYTE *data, size_t length);
+unsigned int crc32cCombine(unsigned int first, unsigned int second,
+                           size_t length);
+void measureDistortion(const BYTE *covPx, const BYTE *stegPx, size_t count,
+                       DISTORTION *distPtr);
+void measureDistortionScalar(const BYTE *covPx, const BYTE *stegPx,
+                             size_t count, DISTORTION *distPtr);
+const char *kernelName(void);
+const char *lsbGroupsKernelName(int density);
+const char *hammingKernelName(int k);
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ *  Filename:
+ *      scatter.c
+ *
+ *  Purpose:
+ *      To define a keyed permutation of the channel indices of an image. A
+ *      balanced Feistel network permutes the smallest domain of an even
+ *      number of bits holding every index, and indices it maps outside the
+ *      image are permuted again until they land inside, which keeps the
+ *      mapping a bijection. Indices are permuted a block at a time and
+ *      sorted by destination, so pixels are visited in ascending order.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ */
+
+#include "scatter.h"
+
+#define RADIX_BITS 11                // Bits sorted by each radix pass
+#define RADIX_SIZE (1 << RADIX_BITS) // Number of buckets of a radix pass
+#define ROUND_MULTIPLIER 0x9e3779b97f4a7c15ULL // Odd multiplier of each round
+
+// Returns x with its bits mixed by the finalizer of SplitMix64, so that
+// each input bit affects every output bit.
+static unsigned long long mixBits(unsigned long long x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Returns a nonzero key derived from the string passphrase with 64-bit
+// FNV-1a, then mixed so that similar passphrases give unrelated keys.
+unsigned long long scatterKey(const char *passphrase)
+{
+    unsigned long long hash = 0xcbf29ce484222325ULL; // FNV offset basis
+    for (; *passphrase != '\0'; passphrase++)
+    {
+        hash = (hash ^ (BYTE)*passphrase) * 0x100000001b3ULL; // FNV prime
+    }
+
+    hash = mixBits(hash);
+    return hash ? hash : 1; // Key 0 means no scattering
+}
+
+// Prepares the permutation pointed to by scatPtr of count indices, from 0
+// to count - 1, under key. Returns none.
+void openScatter(SCATTER *scatPtr, unsigned long long key, size_t count)
+{
+    // Finds smallest domain of 2 * halfBits bits holding every index
+    unsigned int bits = 2;
+    while (bits < 64 && ((size_t)1 << bits) < count)
+    {
+        bits += 2;
+    }
+
+    scatPtr->halfBits = bits / 2;
+    scatPtr->mask = (1ULL << scatPtr->halfBits) - 1;
+    scatPtr->count = count;
+    for (int i = 0; i < SCATTER_ROUNDS; i++)
+    {
+        scatPtr->keys[i] = mixBits(key + 0x9e3779b97f4a7c15ULL * (i + 1));
+    }
+}
+
+// Returns value mapped once by the Feistel network of the permutation pointed
+// to by scatPtr, which may lie outside the permuted indices. Each round takes
+// the top bits of a multiplication of one half by its round key, which
+// depend on every bit of that half.
+static unsigned long long feistelPass(const SCATTER *scatPtr,
+                                      unsigned long long value)
+{
+    unsigned int half = scatPtr->halfBits;
+    unsigned long long left = value >> half;
+    unsigned long long right = value & scatPtr->mask;
+
+    for (int i = 0; i < SCATTER_ROUNDS; i++)
+    {
+        unsigned long long next =
+            left ^ (((right ^ scatPtr->keys[i]) * ROUND_MULTIPLIER) >>
+                    (64 - half));
+        left = right;
+        right = next;
+    }
+
+    return (left << half) | right;
+}
+
+// Returns destination of index, below the count of the permutation pointed
+// to by scatPtr. Each pass of the Feistel network maps the domain onto
+// itself; passes are repeated while the destination is outside the
+// permuted indices, which takes fewer than 4 passes on average.
+size_t scatterIndex(const SCATTER *scatPtr, size_t index)
+{
+    unsigned long long value = index;
+    do
+    {
+        value = feistelPass(scatPtr, value);
+    } while (value >= scatPtr->count);
+
+    return value;
+}
+
+// Permutes the count indices starting at index first, at most
+// SCATTER_BLOCK, of the permutation pointed to by scatPtr, storing each as a
+// pair of its destination shifted left by SCATTER_SLOT_BITS and its slot,
+// the index minus first. Pairs are sorted by destination with a radix sort
+// that uses the count pairs after them as scratch, so pairs must hold
+// 2 * count elements. Returns none.
+void scatterBlock(const SCATTER *scatPtr, size_t first, size_t count,
+                  unsigned long long *pairs)
+{
+    unsigned long long *front = pairs; // Where sorted pairs must end up
+    unsigned long long *scratch = pairs + count;
+
+    for (size_t slot = 0; slot < count; slot++)
+    {
+        pairs[slot] =
+            ((unsigned long long)scatterIndex(scatPtr, first + slot)
+             << SCATTER_SLOT_BITS) |
+            slot;
+    }
+
+    // Destinations are unique, so only their bits need sorting
+    unsigned int topBit = SCATTER_SLOT_BITS + 2 * scatPtr->halfBits;
+    for (unsigned int shift = SCATTER_SLOT_BITS; shift < topBit;
+         shift += RADIX_BITS)
+    {
+        size_t counts[RADIX_SIZE] = {0};
+        for (size_t i = 0; i < count; i++)
+        {
+            counts[(pairs[i] >> shift) & (RADIX_SIZE - 1)]++;
+        }
+
+        size_t total = 0; // Turns counts into starting positions
+        for (size_t digit = 0; digit < RADIX_SIZE; digit++)
+        {
+            size_t bucket = counts[digit];
+            counts[digit] = total;
+            total += bucket;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            scratch[counts[(pairs[i] >> shift) & (RADIX_SIZE - 1)]++] =
+                pairs[i];
+        }
+
+        unsigned long long *swap = pairs; // Sorted pairs become the input
+        pairs = scratch;
+        scratch = swap;
+    }
+
+    // Moves sorted pairs to the front after an odd number of passes
+    if (pairs != front)
+    {
+        memcpy(front, pairs, count * sizeof(*pairs));
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ *  Filename:
+ *      scatter.h
+ *
+ *  Purpose:
+ *      To declare data structures and function prototypes for a keyed
+ *      permutation of channel indices, which scatters payload bits over the
+ *      whole pixel array without storing a table of indices.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ */
+
+#ifndef SCATTER_H
+#define SCATTER_H
+
+#include "stegano.h"
+
+#define SCATTER_ROUNDS 4        // Rounds of the Feistel network
+#define SCATTER_SLOT_BITS 12    // Bits of the slot of an index in its block
+#define SCATTER_BLOCK (1 << SCATTER_SLOT_BITS) // Indices permuted at a time
+
+struct scatter                  // Structure representing a keyed permutation
+{
+    unsigned long long keys[SCATTER_ROUNDS]; // Key of each round
+    unsigned long long mask;    // Mask of each half of the Feistel domain
+    unsigned int halfBits;      // Number of bits in each half of the domain
+    size_t count;               // Number of indices permuted
+};
+
+typedef struct scatter SCATTER; // Defines new data type name for struct scatter
+
+// Function prototypes
+unsigned long long scatterKey(const char *passphrase);
+void openScatter(SCATTER *scatPtr, unsigned long long key, size_t count);
+size_t scatterIndex(const SCATTER *scatPtr, size_t index);
+void scatterBlock(const SCATTER *scatPtr, size_t first, size_t count,
+                  unsigned long long *pairs);
+
+#endif
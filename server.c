@@ -0,0 +1,547 @@
+/*
+ *  Filename:
+ *      server.c
+ *
+ *  Purpose:
+ *      To run a long-lived stego daemon that encodes and decodes secret text
+ *      for clients over a Unix socket, keeping recently used cover images
+ *      loaded in a size-bounded cache.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - scattered payload bits by the key of a request
+ */
+
+#include "server.h"
+#include <errno.h>
+#include <signal.h>
+
+struct entry            // Structure representing a cached cover image
+{
+    char *path;         // Absolute filename of the cover image
+    dev_t device;       // Device of the file when it was loaded
+    ino_t inode;        // Inode of the file when it was loaded
+    off_t size;         // Size of the file when it was loaded
+    struct timespec mtime; // Modification time of the file when loaded
+    BMP *imgPtr;        // Loaded cover image, shared read-only by requests
+    size_t bytes;       // Memory held by the cover image in bytes
+    int users;          // Number of requests using the cover image
+    int evicted;        // Nonzero once removed from the cache
+    struct entry *prev; // More recently used entry, or NULL if first
+    struct entry *next; // Less recently used entry, or NULL if last
+};
+
+struct cache              // Structure representing the cover image cache
+{
+    struct entry *first;  // Most recently used entry
+    struct entry *last;   // Least recently used entry, evicted first
+    size_t bytes;         // Memory held by cached cover images in bytes
+    size_t limit;         // Most memory held by cached cover images
+    size_t hits;          // Number of requests served from the cache
+    size_t misses;        // Number of requests that loaded the cover image
+    pthread_mutex_t lock; // Guards every member above and each entry
+};
+
+static struct cache covers = {NULL, NULL, 0, 0, 0, 0,
+                              PTHREAD_MUTEX_INITIALIZER};
+static volatile sig_atomic_t stopping = 0; // Nonzero once a signal arrived
+
+// Records a termination signal so the accept loop ends. Returns none.
+static void stopServer(int signal)
+{
+    (void)signal;
+    stopping = 1;
+}
+
+// Releases the entry pointed to by entPtr and its cover image. Returns none.
+static void freeEntry(struct entry *entPtr)
+{
+    freeImage(entPtr->imgPtr);
+    free(entPtr->path);
+    free(entPtr);
+}
+
+// Removes the entry pointed to by entPtr from the cache, releasing it unless
+// a request still uses it. Caller must hold the cache lock. Returns none.
+static void evictEntry(struct entry *entPtr)
+{
+    if (entPtr->prev != NULL)
+    {
+        entPtr->prev->next = entPtr->next;
+    }
+    else
+    {
+        covers.first = entPtr->next;
+    }
+    if (entPtr->next != NULL)
+    {
+        entPtr->next->prev = entPtr->prev;
+    }
+    else
+    {
+        covers.last = entPtr->prev;
+    }
+
+    covers.bytes -= entPtr->bytes;
+    entPtr->evicted = 1;
+    if (entPtr->users == 0)
+    {
+        freeEntry(entPtr);
+    }
+}
+
+// Moves the entry pointed to by entPtr, which may not be in the cache yet,
+// to the front of the cache. Caller must hold the cache lock. Returns none.
+static void touchEntry(struct entry *entPtr, int cached)
+{
+    if (cached)
+    {
+        if (covers.first == entPtr)
+        {
+            return;
+        }
+
+        // Unlinks entry; it is not first, so it has a previous entry
+        entPtr->prev->next = entPtr->next;
+        if (entPtr->next != NULL)
+        {
+            entPtr->next->prev = entPtr->prev;
+        }
+        else
+        {
+            covers.last = entPtr->prev;
+        }
+    }
+
+    entPtr->prev = NULL;
+    entPtr->next = covers.first;
+    if (covers.first != NULL)
+    {
+        covers.first->prev = entPtr;
+    }
+    covers.first = entPtr;
+    if (covers.last == NULL)
+    {
+        covers.last = entPtr;
+    }
+}
+
+// Returns the cached entry of the file with path and status info, or NULL if
+// it is not cached. A stale entry of a file modified since it was loaded is
+// evicted. Caller must hold the cache lock.
+static struct entry *findEntry(const char *path, const struct stat *infoPtr)
+{
+    for (struct entry *entPtr = covers.first; entPtr != NULL;
+         entPtr = entPtr->next)
+    {
+        if (strcmp(entPtr->path, path))
+        {
+            continue;
+        }
+
+        if (entPtr->device == infoPtr->st_dev &&
+            entPtr->inode == infoPtr->st_ino &&
+            entPtr->size == infoPtr->st_size &&
+            entPtr->mtime.tv_sec == infoPtr->st_mtim.tv_sec &&
+            entPtr->mtime.tv_nsec == infoPtr->st_mtim.tv_nsec)
+        {
+            return entPtr;
+        }
+
+        evictEntry(entPtr);
+        return NULL;
+    }
+
+    return NULL;
+}
+
+// Obtains the cover image indicated by path from the cache, loading it on a
+// miss. The cover image is loaded without holding the cache lock, so other
+// requests are served meanwhile. Returns pointer to its entry, which must be
+// given back with releaseCover(), or NULL on failure.
+static struct entry *acquireCover(const char *path)
+{
+    struct stat info;
+    if (stat(path, &info))
+    {
+        reportError("stat() failed: %s could not be opened in "
+                    "acquireCover()\n",
+                    path);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&covers.lock);
+    struct entry *entPtr = findEntry(path, &info);
+    if (entPtr != NULL)
+    {
+        touchEntry(entPtr, 1);
+        entPtr->users++;
+        covers.hits++;
+        pthread_mutex_unlock(&covers.lock);
+        return entPtr;
+    }
+    covers.misses++;
+    pthread_mutex_unlock(&covers.lock);
+
+    entPtr = calloc(1, sizeof(*entPtr));
+    if (entPtr == NULL || (entPtr->path = strdup(path)) == NULL ||
+        (entPtr->imgPtr = loadImage(path)) == NULL)
+    {
+        if (entPtr != NULL)
+        {
+            free(entPtr->path);
+        }
+        free(entPtr);
+        return NULL;
+    }
+
+    BMP *imgPtr = entPtr->imgPtr;
+    entPtr->device = info.st_dev;
+    entPtr->inode = info.st_ino;
+    entPtr->size = info.st_size;
+    entPtr->mtime = info.st_mtim;
+    entPtr->bytes = imgPtr->map != NULL ? imgPtr->mapSize : stegoSize(*imgPtr);
+    entPtr->users = 1;
+
+    pthread_mutex_lock(&covers.lock);
+
+    // Uses the entry of a request that loaded the same file meanwhile
+    struct entry *loadedPtr = findEntry(path, &info);
+    if (loadedPtr != NULL)
+    {
+        touchEntry(loadedPtr, 1);
+        loadedPtr->users++;
+        pthread_mutex_unlock(&covers.lock);
+        freeEntry(entPtr);
+        return loadedPtr;
+    }
+
+    // Serves a cover image larger than the whole cache without caching it
+    if (entPtr->bytes > covers.limit)
+    {
+        entPtr->evicted = 1;
+        pthread_mutex_unlock(&covers.lock);
+        return entPtr;
+    }
+
+    // Evicts least recently used cover images until the new one fits
+    while (covers.last != NULL && covers.bytes + entPtr->bytes > covers.limit)
+    {
+        evictEntry(covers.last);
+    }
+    touchEntry(entPtr, 0);
+    covers.bytes += entPtr->bytes;
+    pthread_mutex_unlock(&covers.lock);
+
+    return entPtr;
+}
+
+// Gives back the entry pointed to by entPtr obtained with acquireCover(),
+// releasing it if it was evicted while in use. Returns none.
+static void releaseCover(struct entry *entPtr)
+{
+    pthread_mutex_lock(&covers.lock);
+    int unused = --entPtr->users == 0 && entPtr->evicted;
+    pthread_mutex_unlock(&covers.lock);
+
+    if (unused)
+    {
+        freeEntry(entPtr);
+    }
+}
+
+// Stores fname in path, prefixed by directory dir unless it is absolute or
+// "-". Returns 0 on success.
+static int resolvePath(char path[PATH_MAX], const char *dir, const char *fname)
+{
+    int length = fname[0] == '/' || !strcmp(fname, "-")
+                     ? snprintf(path, PATH_MAX, "%s", fname)
+                     : snprintf(path, PATH_MAX, "%s/%s", dir, fname);
+
+    return length < 0 || length >= PATH_MAX ? ERR_FILENAME : 0;
+}
+
+// Encodes secret text secret into a copy of the cached cover image cover and
+// saves stego image stego, scattering payload bits by key unless it is 0.
+// Returns 0 on success.
+static int serveEncode(const char *cover, const char *secret,
+                       const char *stego, int mode, int density, int flags,
+                       unsigned long long key)
+{
+    struct entry *entPtr = acquireCover(cover);
+    if (entPtr == NULL)
+    {
+        return ERR_OPEN;
+    }
+
+    // Rows are copied on write into this request's own row table, so the
+    // shared pixel array is never modified
+    BMP image = *entPtr->imgPtr;
+    image.rowMod = NULL;
+    image.dirtyRows = 0;
+    image.key = key;
+
+    int status = encodeText(secret, &image, mode, density, flags);
+    if (!status)
+    {
+        status = createStego(stego, image);
+    }
+
+    freeRows(&image);
+    releaseCover(entPtr);
+
+    return status;
+}
+
+// Decodes the secret text hidden in stego image stego into text file decoded,
+// comparing it with cached cover image cover unless cover is "-". Payload
+// bits scattered by key are gathered with it. Returns 0 on success.
+static int serveDecode(const char *cover, const char *stego,
+                       const char *decoded, unsigned long long key)
+{
+    // Reads only the rows it needs, unless payload bits are scattered all
+    // over the image, which is then mapped whole
+    BMP *stegoImagePtr = key ? loadImage(stego) : openImage(stego);
+    if (stegoImagePtr == NULL)
+    {
+        return ERR_OPEN;
+    }
+    stegoImagePtr->key = key;
+
+    int status;
+    if (!strcmp(cover, "-"))
+    {
+        status = decodeBlind(*stegoImagePtr, decoded);
+    }
+    else
+    {
+        struct entry *entPtr = acquireCover(cover);
+        status = entPtr == NULL
+                     ? ERR_OPEN
+                     : decodeText(*entPtr->imgPtr, *stegoImagePtr, decoded);
+        if (entPtr != NULL)
+        {
+            releaseCover(entPtr);
+        }
+    }
+
+    freeImage(stegoImagePtr);
+    return status;
+}
+
+// Runs the request in line, a string of tab-separated fields, and returns
+// the status of its job, or ERR_FORMAT if the request is malformed.
+static int serveRequest(char *line)
+{
+    char *field[REQUEST_FIELDS];
+    size_t fieldCount = 0;
+    char *savePtr;
+    for (char *token = strtok_r(line, "\t", &savePtr);
+         token != NULL && fieldCount < REQUEST_FIELDS;
+         token = strtok_r(NULL, "\t", &savePtr))
+    {
+        field[fieldCount++] = token;
+    }
+    if (fieldCount != REQUEST_FIELDS)
+    {
+        return ERR_FORMAT;
+    }
+
+    char first[PATH_MAX], second[PATH_MAX], third[PATH_MAX];
+    if (resolvePath(first, field[1], field[6]) ||
+        resolvePath(second, field[1], field[7]) ||
+        resolvePath(third, field[1], field[8]))
+    {
+        return ERR_FILENAME;
+    }
+    unsigned long long key = strtoull(field[5], NULL, 16);
+
+    if (!strcmp(field[0], REQUEST_ENCODE))
+    {
+        return serveEncode(first, second, third, atoi(field[2]),
+                           atoi(field[3]), atoi(field[4]), key);
+    }
+    if (!strcmp(field[0], REQUEST_DECODE))
+    {
+        return serveDecode(first, second, third, key);
+    }
+
+    return ERR_FORMAT;
+}
+
+// Reads one request from the client connected to the socket whose descriptor
+// is pointed to by arg, runs it and replies with its status. Returns NULL.
+static void *serveClient(void *arg)
+{
+    int fd = *(int *)arg;
+    free(arg);
+
+    char line[REQUEST_MAX]; // Request, ended by a newline
+    size_t length = 0;
+    int status = ERR_FORMAT;
+
+    while (length < sizeof(line) - 1)
+    {
+        ssize_t got = read(fd, line + length, sizeof(line) - 1 - length);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            break;
+        }
+
+        length += got;
+        char *end = memchr(line, '\n', length);
+        if (end != NULL)
+        {
+            *end = '\0';
+            status = serveRequest(line);
+            break;
+        }
+    }
+
+    char reply[REPLY_MAX];
+    int replyLength = snprintf(reply, sizeof(reply), "%d\n", status);
+    if (write(fd, reply, replyLength) != replyLength)
+    {
+        fprintf(stderr, "%s", "write() failed: reply could not be sent\n");
+    }
+    close(fd);
+
+    return NULL;
+}
+
+// Creates a Unix socket listening at path, replacing a stale socket left by
+// a daemon that was not stopped cleanly. Returns its descriptor, or -1 on
+// failure.
+static int listenAt(const char *path)
+{
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "invalid socket: %s is too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "%s", "socket() failed: socket could not be created\n");
+        return -1;
+    }
+
+    // Refuses to take over a socket that a running daemon still answers
+    if (!connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        fprintf(stderr, "socket error: a daemon already listens at %s\n",
+                path);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(fd, SOMAXCONN))
+    {
+        fprintf(stderr, "bind() failed: could not listen at %s\n", path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *usage = "[-c CACHE_MB] SOCKET";
+    long cacheMb = CACHE_MB;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc)
+        {
+            cacheMb = atol(argv[++i]);
+        }
+        else if (path == NULL && argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || cacheMb < 0)
+    {
+        fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+        return EXIT_FAILURE;
+    }
+    covers.limit = (size_t)cacheMb << 20;
+
+    setHeadless(1); // Reports errors without clearing the terminal
+
+    // Accept loop ends on SIGINT or SIGTERM; clients hanging up are ignored
+    struct sigaction action = {0};
+    action.sa_handler = stopServer;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = listenAt(path);
+    if (listener < 0)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("listening at %s with %ld MB cover cache\n", path, cacheMb);
+    fflush(stdout);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    // Serves each client on its own thread, so requests run concurrently
+    while (!stopping)
+    {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0)
+        {
+            continue; // Interrupted by a signal or a client that hung up
+        }
+
+        pthread_t thread;
+        int *fdPtr = malloc(sizeof(*fdPtr));
+        if (fdPtr == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        *fdPtr = fd;
+        if (pthread_create(&thread, &attr, serveClient, fdPtr))
+        {
+            free(fdPtr);
+            close(fd);
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+    close(listener);
+    unlink(path);
+
+    // Requests still running may update the counters
+    pthread_mutex_lock(&covers.lock);
+    printf("stopped: %zu cache hits, %zu misses\n", covers.hits,
+           covers.misses);
+    pthread_mutex_unlock(&covers.lock);
+    return EXIT_SUCCESS;
+}
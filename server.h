@@ -0,0 +1,34 @@
+/*
+ *  Filename:
+ *      server.h
+ *
+ *  Purpose:
+ *      To declare the request format shared by the stego daemon and its
+ *      client, which send encoding and decoding jobs over a Unix socket.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - added scattering key to requests
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "batch.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// A request is one line of tab-separated fields: operation, working
+// directory of the client, embedding mode, density, payload flags, the
+// scattering key in hexadecimal, or 0 if none, and the three filenames of
+// the job in the same order as JOB. Relative filenames are resolved against
+// the working directory. The reply is one line holding the status returned
+// by the job, 0 on success or an ERR_* code.
+#define REQUEST_ENCODE "encode"   // Operation encoding secret text
+#define REQUEST_DECODE "decode"   // Operation decoding secret text
+#define REQUEST_FIELDS 9          // Number of fields in a request
+#define REQUEST_MAX 8192          // Longest request in bytes, with newline
+#define REPLY_MAX 32              // Longest reply in bytes, with newline
+#define CACHE_MB 512              // Default size of cover image cache in MB
+
+#endif
@@ -0,0 +1,392 @@
+/*
+ *  Filename:
+ *      stages.c
+ *
+ *  Purpose:
+ *      To measure the speed of each stage of encoding and decoding secret
+ *      text on cover images: loading, encoding, creating the stego image and
+ *      decoding, and of the whole round trip. Writes the results as JSON.
+ *
+ *  Modifications:
+ *      17 October 2026 - created
+ *                      - left room for the payload trailer
+ *                      - added keyed runs scattering payload bits
+ */
+
+#include "stegano.h"
+#include "kernels.h"
+#include "scatter.h"
+#include <time.h>
+
+#define STAGES 5              // Number of timed stages, including round trip
+#define SECRET_NAME "stages_secret.txt"  // Secret text encoded in each run
+#define STEGO_NAME "stages_stego.bmp"    // Stego image created in each run
+#define DECODED_NAME "stages_decoded.txt" // Decoded text written in each run
+
+static const char *stageNames[STAGES] = {"load", "encode", "create",
+                                         "decode", "roundtrip"};
+
+struct options        // Structure representing command line options
+{
+    int repetitions;  // Number of timed runs of each image
+    int warmups;      // Number of untimed runs before them
+    int fill;         // Percent of the capacity filled with secret text
+    int blind;        // Nonzero to encode in blind mode
+    unsigned long long key; // Key scattering payload bits, or 0 for none
+    const char *json; // Filename of JSON results
+};
+
+// Returns current time of the monotonic clock in seconds.
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Compares the doubles pointed to by a and b for qsort(). Returns negative,
+// zero or positive as a is below, equal to or above b.
+static int compareTimes(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Returns the nearest-rank percentile p of count sorted times.
+static double percentile(const double *times, int count, double p)
+{
+    int rank = (int)ceil(p / 100 * count);
+    return times[rank > 0 ? rank - 1 : 0];
+}
+
+// Writes charCount pseudorandom lowercase words into the text file
+// indicated by fname. Returns 0 on success.
+static int writeSecret(const char *fname, size_t charCount)
+{
+    FILE *textOut = fopen(fname, "wb");
+    if (textOut == NULL)
+    {
+        fprintf(stderr, "fopen() failed: %s could not be created\n", fname);
+        return ERR_OPEN;
+    }
+
+    uint32_t state = 12345; // State of xorshift generator
+    for (size_t i = 0; i < charCount; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        putc(state % 6 ? 'a' + state / 6 % 26 : ' ', textOut);
+    }
+
+    if (fclose(textOut))
+    {
+        fprintf(stderr, "fwrite() failed: %s could not be written\n", fname);
+        return ERR_WRITE;
+    }
+    return 0;
+}
+
+// Returns 1 if the files indicated by first and second have equal content,
+// 0 otherwise.
+static int sameFile(const char *first, const char *second)
+{
+    FILE *a = fopen(first, "rb");
+    FILE *b = fopen(second, "rb");
+    int same = a != NULL && b != NULL;
+
+    while (same)
+    {
+        int x = getc(a);
+        same = x == getc(b);
+        if (x == EOF)
+        {
+            break;
+        }
+    }
+
+    if (a != NULL)
+    {
+        fclose(a);
+    }
+    if (b != NULL)
+    {
+        fclose(b);
+    }
+    return same;
+}
+
+// Runs every stage once on cover image coverName, storing the seconds taken
+// by each in times. Returns 0 on success.
+static int runStages(const char *coverName, const struct options *optPtr,
+                     double times[STAGES])
+{
+    int mode = optPtr->blind ? MODE_LSB : MODE_DIFF;
+    double start = now();
+
+    BMP *imgPtr = loadImage(coverName);
+    if (imgPtr == NULL)
+    {
+        return ERR_OPEN;
+    }
+    imgPtr->key = optPtr->key;
+    double loaded = now();
+
+    int status = encodeText(SECRET_NAME, imgPtr, mode, 1, 0);
+    double encoded = now();
+
+    if (!status)
+    {
+        status = createStego(STEGO_NAME, *imgPtr);
+    }
+    double created = now();
+    freeImage(imgPtr);
+    if (status)
+    {
+        return status;
+    }
+
+    // Decoding loads the stego image, and the cover image unless blind
+    BMP *covPtr = optPtr->blind ? NULL : loadImage(coverName);
+    BMP *stegPtr = loadImage(STEGO_NAME);
+    double reloaded = now();
+    if ((!optPtr->blind && covPtr == NULL) || stegPtr == NULL)
+    {
+        status = ERR_OPEN;
+    }
+    else
+    {
+        stegPtr->key = optPtr->key;
+        status = optPtr->blind ? decodeBlind(*stegPtr, DECODED_NAME)
+                               : decodeText(*covPtr, *stegPtr, DECODED_NAME);
+    }
+    double decoded = now();
+
+    if (covPtr != NULL)
+    {
+        freeImage(covPtr);
+    }
+    if (stegPtr != NULL)
+    {
+        freeImage(stegPtr);
+    }
+    double end = now();
+
+    times[0] = loaded - start;
+    times[1] = encoded - loaded;
+    times[2] = created - encoded;
+    times[3] = decoded - reloaded;
+    times[4] = end - start; // Whole round trip, including reloading
+    return status;
+}
+
+// Benchmarks every stage on cover image coverName, printing a line per stage
+// and appending its results to jsonOut, separated by a comma unless first is
+// nonzero. Returns 0 on success.
+static int benchImage(const char *coverName, const struct options *optPtr,
+                      FILE *jsonOut, int first)
+{
+    BMP *imgPtr = openImage(coverName); // Reads only the image header
+    if (imgPtr == NULL)
+    {
+        return ERR_OPEN;
+    }
+    BMP img = *imgPtr;
+    freeImage(imgPtr);
+
+    // Fills the requested share of the capacity, besides the payload header
+    // and trailer
+    const size_t frame = PAYLOAD_HEADER_SIZE + PAYLOAD_TRAILER_SIZE;
+    size_t capacity = (size_t)img.rowChannels * img.height / CHAR_BIT;
+    size_t charCount = capacity * optPtr->fill / 100;
+    if (charCount + frame > capacity)
+    {
+        charCount = capacity > frame ? capacity - frame : 0;
+    }
+    int status = writeSecret(SECRET_NAME, charCount);
+    if (status)
+    {
+        return status;
+    }
+
+    int runs = optPtr->warmups + optPtr->repetitions;
+    double *times = malloc(sizeof(double) * STAGES * optPtr->repetitions);
+    if (times == NULL)
+    {
+        fprintf(stderr, "%s", "malloc() failed: no memory for times\n");
+        return ERR_ALLOC;
+    }
+
+    // Stores times stage by stage, so each stage's runs are contiguous
+    for (int run = 0; run < runs && !status; run++)
+    {
+        double runTimes[STAGES];
+        status = runStages(coverName, optPtr, runTimes);
+        if (run >= optPtr->warmups)
+        {
+            for (int stage = 0; stage < STAGES; stage++)
+            {
+                times[stage * optPtr->repetitions + run - optPtr->warmups] =
+                    runTimes[stage];
+            }
+        }
+    }
+    if (!status && !sameFile(SECRET_NAME, DECODED_NAME))
+    {
+        fprintf(stderr, "decoded text of %s differs from secret text\n",
+                coverName);
+        status = ERR_FORMAT;
+    }
+    if (status)
+    {
+        free(times);
+        return status;
+    }
+
+    size_t pixels = (size_t)img.width * img.height;
+    printf("%s: %d x %d, %d-bit, %zu characters\n", coverName, img.width,
+           img.height, img.bitDepth, charCount);
+
+    fprintf(jsonOut,
+            "%s\n    {\"image\": \"%s\", \"width\": %d, \"height\": %d, "
+            "\"depth\": %d, \"pixels\": %zu, \"bytes\": %u, "
+            "\"characters\": %zu, \"mode\": \"%s\", \"keyed\": %s, "
+            "\"stages\": {",
+            first ? "" : ",", coverName, img.width, img.height, img.bitDepth,
+            pixels, img.pxArrSize, charCount, optPtr->blind ? "blind" : "diff",
+            optPtr->key ? "true" : "false");
+
+    for (int stage = 0; stage < STAGES; stage++)
+    {
+        double *stageTimes = times + stage * optPtr->repetitions;
+        int count = optPtr->repetitions;
+        qsort(stageTimes, count, sizeof(*stageTimes), compareTimes);
+
+        double mean = 0;
+        for (int i = 0; i < count; i++)
+        {
+            mean += stageTimes[i] / count;
+        }
+
+        // Throughput is measured over the pixel array at the median time
+        double median = percentile(stageTimes, count, 50);
+        double mbps = img.pxArrSize / median / 1e6;
+        double nsPerPx = median * 1e9 / pixels;
+
+        printf("  %-10s p50 %9.3f ms  p90 %9.3f ms  p99 %9.3f ms  "
+               "%9.1f MB/s %8.3f ns/px\n",
+               stageNames[stage], median * 1e3,
+               percentile(stageTimes, count, 90) * 1e3,
+               percentile(stageTimes, count, 99) * 1e3, mbps, nsPerPx);
+
+        fprintf(jsonOut,
+                "%s\n      \"%s\": {\"min_ms\": %.4f, \"mean_ms\": %.4f, "
+                "\"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, "
+                "\"max_ms\": %.4f, \"mb_per_s\": %.2f, \"ns_per_px\": %.4f}",
+                stage ? "," : "", stageNames[stage], stageTimes[0] * 1e3,
+                mean * 1e3, median * 1e3,
+                percentile(stageTimes, count, 90) * 1e3,
+                percentile(stageTimes, count, 99) * 1e3,
+                stageTimes[count - 1] * 1e3, mbps, nsPerPx);
+    }
+    fprintf(jsonOut, "%s", "\n    }}");
+
+    free(times);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *usage = "[-r REPETITIONS] [-w WARMUPS] [-f PERCENT] [-b] "
+                        "[-k PASSPHRASE] [-o RESULTS.json] COVER.bmp...";
+    struct options opt = {10, 1, 100, 0, 0, "stages.json"};
+    int first = 1; // Index of first cover image in argv
+
+    setHeadless(1); // Reports errors without clearing the terminal
+
+    while (first < argc && argv[first][0] == '-')
+    {
+        const char *option = argv[first++];
+        if (!strcmp(option, "-b"))
+        {
+            opt.blind = 1;
+            continue;
+        }
+        if (first == argc)
+        {
+            first = argc + 1; // Missing value
+            break;
+        }
+
+        const char *value = argv[first++];
+        if (!strcmp(option, "-r"))
+        {
+            opt.repetitions = atoi(value);
+        }
+        else if (!strcmp(option, "-w"))
+        {
+            opt.warmups = atoi(value);
+        }
+        else if (!strcmp(option, "-f"))
+        {
+            opt.fill = atoi(value);
+        }
+        else if (!strcmp(option, "-k"))
+        {
+            opt.key = scatterKey(value);
+        }
+        else if (!strcmp(option, "-o"))
+        {
+            opt.json = value;
+        }
+        else
+        {
+            first = argc + 1;
+            break;
+        }
+    }
+
+    if (first >= argc || opt.repetitions <= 0 || opt.warmups < 0 ||
+        opt.fill <= 0 || opt.fill > 100)
+    {
+        fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+        return EXIT_FAILURE;
+    }
+
+    FILE *jsonOut = fopen(opt.json, "w");
+    if (jsonOut == NULL)
+    {
+        fprintf(stderr, "fopen() failed: %s could not be created\n",
+                opt.json);
+        return EXIT_FAILURE;
+    }
+
+    // Records the settings results depend on, so runs can be compared
+    fprintf(jsonOut,
+            "{\n  \"format\": 1, \"kernel\": \"%s\", \"repetitions\": %d, "
+            "\"warmups\": %d, \"fill_percent\": %d,\n  \"results\": [",
+            kernelName(), opt.repetitions, opt.warmups, opt.fill);
+
+    int failures = 0;
+    for (int i = first; i < argc; i++)
+    {
+        if (benchImage(argv[i], &opt, jsonOut, i == first))
+        {
+            fprintf(stderr, "%s could not be benchmarked\n", argv[i]);
+            failures++;
+        }
+    }
+    fprintf(jsonOut, "%s", "\n  ]\n}\n");
+
+    remove(SECRET_NAME);
+    remove(STEGO_NAME);
+    remove(DECODED_NAME);
+
+    if (fclose(jsonOut) || failures)
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("results written to %s\n", opt.json);
+    return EXIT_SUCCESS;
+}
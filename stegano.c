@@ -12,9 +12,222 @@
  *      10 April 2022 - modified encodeText() to skip padding
  *      11 April 2022 - used memcpy() in obtaining image properties
  *      12 April 2022 - modified decodeText() to write file for secret message
+ *      17 October 2026 - returned error codes instead of terminating program
+ *                      - mapped bitmap files into memory in loadImage()
+ *                      - copied rows of pixel array only on first write
+ *                      - added row streaming for constant-memory encoding
+ *                        and decoding
+ *                      - decoded whole characters with vectorized kernel
+ *                      - encoded whole characters with vectorized kernel
+ *                      - read secret text in one pass with vectorized check
+ *                      - encoded payload header before secret text and
+ *                        decoded only the rows holding it
+ *                      - added blind embedding mode
+ *                      - added pixel formats for 24-bit and 32-bit images
+ *                      - added embedding density of up to 4 bits per byte
+ *                      - added optional compression of secret text
+ *                      - added in-memory parsing, encoding, writing and
+ *                        decoding for library builds
+ *                      - added per-job timings and counters for --stats
+ *                      - added freeRows() for cover images shared by the
+ *                        daemon
+ *                      - added patchStego() writing only modified bytes
+ *                      - encoded and decoded row bands on parallel threads
+ *                      - added shardEncode() and shardDecode() for secret
+ *                        text spread over several images
+ *                      - scattered payload bits over the pixel array by a
+ *                        keyed permutation
+ *                      - added Hamming matrix embedding mode
+ *                      - added CRC32C trailer checked while decoding
  */
 
+#define _GNU_SOURCE // Declares copy_file_range()
 #include "stegano.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <linux/fs.h>
+#include "kernels.h"
+#include "compress.h"
+#include "scatter.h"
+
+static int headless = 0; // Nonzero if terminal must not be cleared on error
+
+// Enables or disables headless mode, in which errors are reported without
+// clearing the terminal. Returns none.
+void setHeadless(int enabled)
+{
+    headless = enabled;
+}
+
+// Prints formatted error message in stderr. Clears the terminal first unless
+// running in headless mode. Library builds only return error codes, so they
+// print nothing. Returns none.
+void reportError(const char *format, ...)
+{
+#ifndef STEGANO_LIBRARY
+    if (!headless)
+    {
+        clearTerminal();
+    }
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+#else
+    (void)format;
+#endif
+}
+
+static int statsEnabled = 0; // Nonzero if timings and counters are kept
+static __thread STATS stats;  // Timings and counters of current thread's job
+
+// Enables or disables timings and counters of jobs. Must be called before
+// jobs start. Returns none.
+void enableStats(int enabled)
+{
+    statsEnabled = enabled;
+}
+
+// Clears timings and counters of the calling thread before a job. Bytes
+// still allocated are kept so later releases are not miscounted.
+// Returns none.
+void resetStats(void)
+{
+    size_t allocBytes = stats.allocBytes;
+    memset(&stats, 0, sizeof(stats));
+    stats.allocBytes = stats.peakBytes = allocBytes;
+}
+
+// Returns timings and counters of the calling thread since resetStats().
+STATS getStats(void)
+{
+    return stats;
+}
+
+// Returns current time of the monotonic clock in seconds, or 0 without
+// reading the clock if stats are disabled.
+static double statClock(void)
+{
+    if (!statsEnabled)
+    {
+        return 0;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Adds the seconds elapsed since start, taken from statClock(), to the
+// timing pointed to by timePtr. Returns none.
+static void addTime(double *timePtr, double start)
+{
+    if (statsEnabled)
+    {
+        *timePtr += statClock() - start;
+    }
+}
+
+// Adds count to the counter pointed to by counterPtr. Returns none.
+static void addCount(unsigned long long *counterPtr, size_t count)
+{
+    if (statsEnabled)
+    {
+        *counterPtr += count;
+    }
+}
+
+// Counts memory pointed to by ptr, which may be NULL, as allocated by the
+// current job, updating its peak. Returns none.
+static void trackAlloc(void *ptr)
+{
+    if (statsEnabled && ptr != NULL)
+    {
+        stats.allocBytes += malloc_usable_size(ptr);
+        if (stats.allocBytes > stats.peakBytes)
+        {
+            stats.peakBytes = stats.allocBytes;
+        }
+    }
+}
+
+// Counts memory pointed to by ptr, which may be NULL, as released by the
+// current job. Returns none.
+static void trackFree(void *ptr)
+{
+    if (statsEnabled && ptr != NULL)
+    {
+        size_t size = malloc_usable_size(ptr);
+        stats.allocBytes -= size < stats.allocBytes ? size : stats.allocBytes;
+    }
+}
+
+// Allocates size bytes with malloc(), counting them for stats.
+// Returns pointer to the memory, or NULL on failure.
+static void *allocMemory(size_t size)
+{
+    void *ptr = malloc(size);
+    trackAlloc(ptr);
+    return ptr;
+}
+
+// Allocates count zeroed elements of size bytes with calloc(), counting them
+// for stats. Returns pointer to the memory, or NULL on failure.
+static void *allocZeroed(size_t count, size_t size)
+{
+    void *ptr = calloc(count, size);
+    trackAlloc(ptr);
+    return ptr;
+}
+
+// Resizes memory pointed to by ptr to size bytes with realloc(), counting the
+// change for stats. Returns pointer to the memory, or NULL on failure, in
+// which case ptr is left allocated.
+static void *resizeMemory(void *ptr, size_t size)
+{
+    size_t old = ptr != NULL && statsEnabled ? malloc_usable_size(ptr) : 0;
+    void *bigger = realloc(ptr, size);
+    if (bigger != NULL)
+    {
+        stats.allocBytes -= old < stats.allocBytes ? old : stats.allocBytes;
+        trackAlloc(bigger);
+    }
+    return bigger;
+}
+
+// Releases memory pointed to by ptr with free(), counting it for stats.
+// Returns none.
+static void freeMemory(void *ptr)
+{
+    trackFree(ptr);
+    free(ptr);
+}
+
+// Adds the counters and allocations of stats part, kept by a thread that
+// helped with the calling thread's job, to the calling thread's stats.
+// Timings are left out since they overlap those of the calling thread.
+// Returns none.
+static void mergeStats(STATS part)
+{
+    if (!statsEnabled)
+    {
+        return;
+    }
+
+    stats.bytesRead += part.bytesRead;
+    stats.bytesWritten += part.bytesWritten;
+    stats.pixelsModified += part.pixelsModified;
+    stats.rowsDirtied += part.rowsDirtied;
+    stats.allocBytes += part.allocBytes;
+    if (stats.allocBytes > stats.peakBytes)
+    {
+        stats.peakBytes = stats.allocBytes;
+    }
+}
 
 // Checks validity of filename according to its file extension.
 // Returns 0 on success.
@@ -22,24 +235,20 @@ int verifyFilename(const char *fname, const char *extension, const char *caller)
 {
     const char *suffix = strrchr(fname, '.'); // Obtains file extension
 
-    // Terminates program if filename has no file extension
+    // Rejects filename if it has no file extension
     if (suffix == NULL)
     {
-        clearTerminal();
-        fprintf(stderr,
-                "invalid filename: %s has no file extension in %s\n",
-                fname, caller);
-        exit(EXIT_FAILURE);
+        reportError("invalid filename: %s has no file extension in %s\n",
+                    fname, caller);
+        return ERR_FILENAME;
     }
 
-    // Terminates program if file format is not bitmap
+    // Rejects filename if file format is not bitmap
     else if (strcmp(suffix, extension))
     {
-        clearTerminal();
-        fprintf(stderr,
-                "invalid file format: %s is not a %s file in %s\n",
-                fname, extension, caller);
-        exit(EXIT_FAILURE);
+        reportError("invalid file format: %s is not a %s file in %s\n",
+                    fname, extension, caller);
+        return ERR_FILENAME;
     }
 
     return 0; // Filename is valid
@@ -56,18 +265,22 @@ void clearTerminal(void)
 // in terminal. Returns 0 on success.
 int showBackground(const char *fname)
 {
-    verifyFilename(fname, ".txt", "showBackground");
+    int status = verifyFilename(fname, ".txt", "showBackground");
+    if (status)
+    {
+        return status;
+    }
 
     clearTerminal();
     FILE *art = fopen(fname, "r"); // Opens text file containing ASCII art
 
-    // Terminates program if opening file failed
+    // Stops if opening file failed
     if (art == NULL)
     {
         fprintf(stderr,
                 "fopen() failed: %s could not be opened in showBackground()\n",
                 fname);
-        exit(EXIT_FAILURE); // Returns control to operating system
+        return ERR_OPEN;
     }
 
     int ch;                         // Next character in ASCII art
@@ -81,384 +294,3462 @@ int showBackground(const char *fname)
     return 0;
 }
 
-// Opens a bitmap image indicated by fname. Returns pointer to
-// BMP structure of the image.
-BMP *loadImage(const char *fname)
+// Allocates a BMP structure and opens the bitmap image indicated by fname in
+// it on behalf of function caller. Returns pointer to the BMP structure, or
+// NULL on failure.
+static BMP *allocImage(const char *fname, const char *caller)
 {
-    int storeProperties(BMP * imgPtr); // Function prototype
+    if (verifyFilename(fname, ".bmp", caller))
+    {
+        return NULL;
+    }
 
-    verifyFilename(fname, ".bmp", "loadImage()");
+    BMP *imgPtr = allocZeroed(1, sizeof(BMP)); // Allocates cover image
+    if (imgPtr == NULL)
+    {
+        reportError("calloc() failed: no memory for %s in %s\n",
+                    fname, caller);
+        return NULL;
+    }
 
-    BMP *imgPtr = malloc(sizeof(BMP));   // Allocates memory for cover image
-    imgPtr->filePtr = fopen(fname, "r"); // Opens image indicated by fname
+    imgPtr->filePtr = fopen(fname, "rb"); // Opens image indicated by fname
 
-    // Terminates program if opening the image failed
+    // Stops if opening the image failed
     if (imgPtr->filePtr == NULL)
     {
-        clearTerminal();
-        fprintf(stderr,
-                "fopen() failed: %s could not be opened in loadImage()\n",
-                fname);
-        free(imgPtr); // Free allocated memory for cover image
-        exit(EXIT_FAILURE);
+        reportError("fopen() failed: %s could not be opened in %s\n",
+                    fname, caller);
+        freeMemory(imgPtr); // Free allocated memory for cover image
+        return NULL;
     }
 
-    storeProperties(imgPtr); // Initialize structure members
     return imgPtr;
 }
 
-// Initializes structure members representing image properties of BMP structure
-// pointed to by imgPtr. Returns 0 on success.
-int storeProperties(BMP *imgPtr)
+// Opens a bitmap image indicated by fname. Returns pointer to
+// BMP structure of the image, or NULL on failure.
+BMP *loadImage(const char *fname)
 {
-    // Obtains DIB header size measured in bytes
-    fseek(imgPtr->filePtr, FILEHEADER_SIZE, SEEK_SET);
-    fread(&imgPtr->headerSize, sizeof(imgPtr->headerSize), 1, imgPtr->filePtr);
+    int storeProperties(BMP * imgPtr); // Function prototype
 
-    // Sets total size of image header measured in bytes
-    imgPtr->headerSize += FILEHEADER_SIZE;
+    BMP *imgPtr = allocImage(fname, "loadImage()");
+    if (imgPtr == NULL)
+    {
+        return NULL;
+    }
 
-    // Allocates memory for image header
-    imgPtr->header = malloc(imgPtr->headerSize);
+    // Initialize structure members
+    double start = statClock();
+    int status = storeProperties(imgPtr);
+    addTime(&stats.loadTime, start);
+    if (status)
+    {
+        reportError("file error: %s is not a valid bitmap in loadImage()\n",
+                    fname);
+        freeImage(imgPtr);
+        return NULL;
+    }
 
-    // Obtains content of image header
-    rewind(imgPtr->filePtr);
-    fread(imgPtr->header, sizeof(*imgPtr->header),
-          imgPtr->headerSize, imgPtr->filePtr);
+    return imgPtr;
+}
 
-    // Obtains color depth measured in bits
-    memcpy(&imgPtr->bitDepth, &imgPtr->header[28], sizeof(imgPtr->bitDepth));
+// Opens a bitmap image indicated by fname for streaming, reading only its
+// image header and color table. Rows of the pixel array are read on demand
+// by readRows(), so pxArr is NULL. Files other than regular files, such as
+// pipes, are loaded whole as by loadImage(). Returns pointer to BMP structure
+// of the image, or NULL on failure.
+BMP *openImage(const char *fname)
+{
+    int readHeader(BMP * imgPtr);      // Function prototype
+    int storeProperties(BMP * imgPtr); // Function prototype
 
-    // Computes total number of entries in color pallete
-    imgPtr->colorCount = pow(2, imgPtr->bitDepth);
+    BMP *imgPtr = allocImage(fname, "openImage()");
+    if (imgPtr == NULL)
+    {
+        return NULL;
+    }
 
-    if (imgPtr->bitDepth >= 8) // Checks if color table exists
+    // Rows are read at their file offset, which pipes do not have
+    struct stat info;
+    int regular = !fstat(fileno(imgPtr->filePtr), &info) &&
+                  S_ISREG(info.st_mode);
+
+    // Initialize structure members, the pixel array only if not streamed
+    double start = statClock();
+    int status = regular ? readHeader(imgPtr) : storeProperties(imgPtr);
+    addTime(&stats.loadTime, start);
+    if (status)
     {
-        // Allocates memory for color table
-        imgPtr->colorTable = malloc(imgPtr->colorCount *
-                                    sizeof(*imgPtr->colorTable));
+        reportError("file error: %s is not a valid bitmap in openImage()\n",
+                    fname);
+        freeImage(imgPtr);
+        return NULL;
+    }
 
-        // Note: sizeof(*imgPtr->colorTable) evaluates to the size (in bytes)
-        // of the data type being pointed to by imgPtr->colorTable.
+    return imgPtr;
+}
 
-        // Obtains color table
-        fread(imgPtr->colorTable, sizeof(*imgPtr->colorTable),
-              imgPtr->colorCount, imgPtr->filePtr);
+// Obtains image properties from the image header of the BMP structure pointed
+// to by imgPtr, which must already hold headerSize bytes. Selects the pixel
+// format: 8-bit paletted pixels store bits in each byte, 24-bit BGR pixels in
+// each channel, and 32-bit BGRA pixels in each channel except alpha.
+// Returns 0 on success.
+static int parseHeader(BMP *imgPtr)
+{
+    // Rejects header too small to hold the image properties read below
+    if (imgPtr->headerSize < FILEHEADER_SIZE + INFOHEADER_SIZE ||
+        memcmp(imgPtr->header, "BM", 2))
+    {
+        return ERR_FORMAT;
     }
 
+    // Obtains color depth measured in bits
+    memcpy(&imgPtr->bitDepth, &imgPtr->header[28], sizeof(imgPtr->bitDepth));
+
     // Obtains image width and height measured in pixels
     memcpy(&imgPtr->width, &imgPtr->header[18], sizeof(imgPtr->width));
     memcpy(&imgPtr->height, &imgPtr->header[22], sizeof(imgPtr->height));
 
-    // Computes size of pixel array measured in bytes
-    DWORD pxRowSize = ceil((float)(imgPtr->bitDepth * imgPtr->width) / 32) * 4;
-    imgPtr->pxArrSize = (pxRowSize * imgPtr->height);
+    // Rejects images without pixels
+    if (imgPtr->width <= 0 || imgPtr->height <= 0)
+    {
+        return ERR_FORMAT;
+    }
 
-    // Allocates memory for pixel array
-    imgPtr->pxArr = malloc(imgPtr->pxArrSize);
+    // Selects pixel format, rejecting compressed pixel arrays and pixels
+    // that do not store each channel in a whole byte
+    DWORD compression;
+    memcpy(&compression, &imgPtr->header[30], sizeof(compression));
+    switch (imgPtr->bitDepth)
+    {
+    case 8:
+    case 24:
+        imgPtr->pxSize = imgPtr->bitDepth / CHAR_BIT;
+        imgPtr->rowChannels = imgPtr->width * imgPtr->pxSize;
+        if (compression != BI_RGB)
+        {
+            return ERR_FORMAT;
+        }
+        break;
+    case 32:
+        imgPtr->pxSize = 4;
+        imgPtr->rowChannels = imgPtr->width * 3; // Alpha stores no bits
+        if (compression != BI_RGB && compression != BI_BITFIELDS)
+        {
+            return ERR_FORMAT;
+        }
+        break;
+    default:
+        return ERR_FORMAT;
+    }
 
-    // Obtains file offset of pixel array
-    fseek(imgPtr->filePtr, 10, SEEK_SET);
-    DWORD pxArrOffset;
-    fread(&pxArrOffset, sizeof(pxArrOffset), 1, imgPtr->filePtr);
+    // Computes size of pixel array measured in bytes. Each row is padded
+    // to a multiple of 4 bytes.
+    size_t rowSize = ((size_t)imgPtr->width * imgPtr->pxSize + 3) / 4 * 4;
+    if (rowSize * imgPtr->height > UINT_MAX)
+    {
+        return ERR_FORMAT;
+    }
+    imgPtr->pxRowSize = rowSize;
+    imgPtr->pxArrSize = rowSize * imgPtr->height;
 
-    // Obtains content of pixel array
-    fseek(imgPtr->filePtr, pxArrOffset, SEEK_SET);
-    fread(imgPtr->pxArr, sizeof(*imgPtr->pxArr),
-          imgPtr->pxArrSize, imgPtr->filePtr);
+    // Computes padding in pixel array
+    imgPtr->padding = imgPtr->pxRowSize - imgPtr->width * imgPtr->pxSize;
 
-    // Creates copy of pixel array to be used for encoding secret text
-    imgPtr->pxArrMod = malloc(imgPtr->pxArrSize);
-    memcpy(imgPtr->pxArrMod, imgPtr->pxArr, imgPtr->pxArrSize);
+    // Obtains file offset of pixel array
+    memcpy(&imgPtr->pxArrOffset, &imgPtr->header[10],
+           sizeof(imgPtr->pxArrOffset));
+    if (imgPtr->pxArrOffset < imgPtr->headerSize)
+    {
+        return ERR_FORMAT;
+    }
 
-    // Computes padding in pixel array
-    imgPtr->padding = pxRowSize - imgPtr->width;
+    // Color table of paletted images, or channel masks, fill the bytes
+    // between header and pixel array. Truecolor images have no palette.
+    imgPtr->tableSize = imgPtr->pxArrOffset - imgPtr->headerSize;
+    imgPtr->colorCount = 0;
+    if (imgPtr->bitDepth <= 8)
+    {
+        imgPtr->colorCount = imgPtr->tableSize / sizeof(DWORD);
+        if (imgPtr->colorCount > 1u << imgPtr->bitDepth)
+        {
+            imgPtr->colorCount = 1u << imgPtr->bitDepth;
+        }
+    }
 
-    return 0; // Structure members for image properties successfully initialized
+    // Obtains embedding mode, scattering and density recorded in reserved
+    // bytes of a stego image. Density 0 was written before densities were
+    // added.
+    imgPtr->mode = MODE_DIFF;
+    imgPtr->density = 1;
+    imgPtr->scattered = 0;
+    if (!memcmp(&imgPtr->header[STEGO_MARK_OFFSET], STEGO_MARK, 2))
+    {
+        imgPtr->mode = imgPtr->header[STEGO_MARK_OFFSET + 2] & ~MODE_SCATTERED;
+        imgPtr->scattered = (imgPtr->header[STEGO_MARK_OFFSET + 2] &
+                             MODE_SCATTERED) != 0;
+        imgPtr->density = imgPtr->header[STEGO_MARK_OFFSET + 3];
+        if (imgPtr->density == 0)
+        {
+            imgPtr->density = 1;
+        }
+        if (imgPtr->density > (imgPtr->mode == MODE_HAMMING ? HAMMING_MAX
+                                                            : DENSITY_MAX))
+        {
+            return ERR_FORMAT;
+        }
+    }
+
+    return 0;
 }
 
-// Prints image properties of img in stdin. Returns 0 on success.
-int printProperties(BMP img)
+// Points the image header, color table and pixel array of the BMP structure
+// pointed to by imgPtr into the size bytes of a whole bitmap file at data,
+// which are only read. Returns 0 on success or ERR_FORMAT for a malformed
+// image.
+static int pointProperties(BMP *imgPtr, const BYTE *data, size_t size)
 {
-    clearTerminal();
-    puts("IMAGE PROPERTIES");
-    printf("%-14s: %d bytes\n", "Header size", img.headerSize);
-    printf("%-14s: %d pixels\n", "Image width", img.width);
-    printf("%-14s: %d pixels\n", "Image height", img.height);
-    printf("%-14s: %d bits\n", "Bit depth", img.bitDepth);
-    printf("%-14s: %d colors\n", "Color count", img.colorCount);
-    printf("%-14s: %d bytes\n", "Pixel array", img.pxArrSize);
-    printf("%-14s: %d byte\n", "Padding", img.padding);
+    // Obtains total size of image header measured in bytes
+    if (size < FILEHEADER_SIZE + sizeof(imgPtr->headerSize))
+    {
+        return ERR_FORMAT;
+    }
+    memcpy(&imgPtr->headerSize, &data[FILEHEADER_SIZE],
+           sizeof(imgPtr->headerSize));
+    imgPtr->headerSize += FILEHEADER_SIZE;
+    if (imgPtr->headerSize > size)
+    {
+        return ERR_FORMAT;
+    }
+
+    imgPtr->header = (BYTE *)data; // Image header starts the file
+    int status = parseHeader(imgPtr);
+    if (status)
+    {
+        return status;
+    }
+
+    // Obtains pixel array at its file offset. Color table fills the bytes
+    // between header and pixel array.
+    if (imgPtr->pxArrOffset > size ||
+        imgPtr->pxArrSize > size - imgPtr->pxArrOffset)
+    {
+        return ERR_FORMAT;
+    }
+    imgPtr->pxArr = (BYTE *)data + imgPtr->pxArrOffset;
+    if (imgPtr->tableSize > 0)
+    {
+        imgPtr->colorTable = (BYTE *)data + imgPtr->headerSize;
+    }
 
     return 0;
 }
 
-// Creates stego image indicated by fname from the modified bitmap file
-// structure of cover image indicated by img. Returns 0 on success.
-int createStego(const char *fname, BMP img)
+// Maps the regular file opened in the BMP structure pointed to by imgPtr
+// read-only into memory, then points the image header, color table and pixel
+// array into the mapping. Returns 0 on success, ERR_FORMAT for a malformed
+// image, or ERR_OPEN if the file cannot be mapped.
+static int mapProperties(BMP *imgPtr)
 {
-    verifyFilename(fname, ".bmp", "createStego()");
+    struct stat info;
+    int fd = fileno(imgPtr->filePtr);
 
-    FILE *imgOut = fopen(fname, "wb"); // Opens stego image
+    // Leaves pipes, devices and empty files to the fread() path
+    if (fstat(fd, &info) || !S_ISREG(info.st_mode) || info.st_size == 0)
+    {
+        return ERR_OPEN;
+    }
 
-    // Uses the modified file structure of cover image to create stego image
-    fwrite(img.header, sizeof(*img.header), img.headerSize, imgOut);
-    fwrite(img.colorTable, sizeof(*img.colorTable), img.colorCount, imgOut);
-    fwrite(img.pxArrMod, sizeof(*img.pxArrMod), img.pxArrSize, imgOut);
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE; // Reads whole file in one go instead of on faults
+#endif
+
+    void *map = mmap(NULL, info.st_size, PROT_READ, flags, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        return ERR_OPEN;
+    }
 
-    fclose(imgOut);
+    imgPtr->map = map;
+    imgPtr->mapSize = info.st_size;
+    addCount(&stats.bytesRead, info.st_size);
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
 
-    return 0; // Stego image is successfully created
+    return pointProperties(imgPtr, map, info.st_size);
 }
 
-// Releases memory allocated for BMP structure pointed to by imgPtr. 
+// Reads image header and color table of the file opened in the BMP structure
+// pointed to by imgPtr into allocated memory, leaving the file positioned at
+// the pixel array. The file is read front to back without seeking.
 // Returns 0 on success.
-int freeImage(BMP *imgPtr)
+int readHeader(BMP *imgPtr)
 {
-    // Deallocates the memory previously allocated by malloc()
-    free(imgPtr->header);
-    free(imgPtr->pxArr);
-    free(imgPtr->pxArrMod);
+    BYTE start[FILEHEADER_SIZE + sizeof(imgPtr->headerSize)];
 
-    // Deallocates memory used by color table if it exists
-    if (imgPtr->colorTable != NULL)
+    // Obtains file header and DIB header size measured in bytes
+    if (fread(start, sizeof(*start), sizeof(start), imgPtr->filePtr) !=
+        sizeof(start))
     {
-        free(imgPtr->colorTable);
+        return ERR_FORMAT;
     }
+    memcpy(&imgPtr->headerSize, &start[FILEHEADER_SIZE],
+           sizeof(imgPtr->headerSize));
 
-    fclose(imgPtr->filePtr); // Closes the file pointer for cover image
-    free(imgPtr);            // Deallocates memory for BMP structure
-
-    return 0;
-}
-
-// Encodes secret text in the file indicated by fname into the
-// BMP structure pointed to by imgPtr. Returns none.
-int encodeText(const char *fname, BMP *imgPtr)
-{
-    FILE *openText(const char *fname, BMP img); // Function prototype
+    // Sets total size of image header measured in bytes
+    imgPtr->headerSize += FILEHEADER_SIZE;
+    if (imgPtr->headerSize < FILEHEADER_SIZE + INFOHEADER_SIZE)
+    {
+        return ERR_FORMAT;
+    }
 
-    FILE *textPtr = openText(fname, *imgPtr); // Opens secret text
+    // Allocates memory for image header
+    imgPtr->header = allocMemory(imgPtr->headerSize);
+    if (imgPtr->header == NULL)
+    {
+        return ERR_ALLOC;
+    }
 
-    // Index of last pixel in first row of pixel array
-    size_t lastPx = imgPtr->width - 1;
+    // Obtains rest of image header
+    memcpy(imgPtr->header, start, sizeof(start));
+    size_t rest = imgPtr->headerSize - sizeof(start);
+    if (fread(imgPtr->header + sizeof(start), sizeof(*imgPtr->header), rest,
+              imgPtr->filePtr) != rest)
+    {
+        return ERR_FORMAT;
+    }
 
-    size_t px = 0;  // Index of modified pixel
-    char character; // Next character in secret text
+    int status = parseHeader(imgPtr);
+    if (status)
+    {
+        return status;
+    }
 
-    // Loops through each character in secret text until eof
-    while ((character = getc(textPtr)) != EOF)
+    // Obtains color table and masks, which fill the bytes between header
+    // and pixel array
+    if (imgPtr->tableSize > 0)
     {
-        // Skips encoding non-ASCII character
-        if (character < ASCII_MIN || character > ASCII_MAX)
+        imgPtr->colorTable = allocMemory(imgPtr->tableSize);
+        if (imgPtr->colorTable == NULL)
         {
-            clearTerminal();
-            fprintf(stderr,
-                    "warning: skipped encoding character '%c' in encodeText()\n",
-                    character);
-            exit(EXIT_FAILURE);
+            return ERR_ALLOC;
         }
-
-        char mask = 1 << (CHAR_BIT - 1); // Bit mask for 8-bit character
-
-        // Loop through each bit of the 8-bit character
-        for (unsigned int i = 0; i < CHAR_BIT; i++)
+        if (fread(imgPtr->colorTable, sizeof(*imgPtr->colorTable),
+                  imgPtr->tableSize, imgPtr->filePtr) != imgPtr->tableSize)
         {
-            if (character & mask) // Current bit is 1
-            {
-                // Increases pixel value by 1
-                imgPtr->pxArrMod[px] += 1;
-
-                // Sets higher limit for pixel value according to color depth
-                int maxPxValue = imgPtr->colorCount - 1;
-                if (imgPtr->pxArrMod[px] > maxPxValue)
-                {
-                    imgPtr->pxArrMod[px] = maxPxValue;
-                }
-            }
-            else // Current bit is 0
-            {
-                // Avoids negative pixel value
-                if (imgPtr->pxArrMod[px] < 1)
-                {
-                    // Sets lower limit for pixel value to 0
-                    imgPtr->pxArrMod[px] = 0;
-                }
-                else
-                {
-                    // Decreases pixel value by 1
-                    imgPtr->pxArrMod[px] -= 1;
-                }
-            }
-
-            // Skip padding in pixel array
-            if (px == lastPx)
-            {
-                // Index of first pixel in next row
-                px += imgPtr->padding + 1;
-
-                // Index of last pixel in next row
-                lastPx += imgPtr->width + imgPtr->padding;
-            }
-            else
-            {
-                px++; // Set index of next pixel in current row
-            }
-
-            character <<= 1; // Shift bits of character by 1 bit to the right
+            return ERR_FORMAT;
         }
     }
 
-    fclose(textPtr); // Closes secret text
-
-    return 0; // Secret text succesfully encoded
+    addCount(&stats.bytesRead, imgPtr->headerSize + imgPtr->tableSize);
+    return 0;
 }
 
-// Opens secret text indicated by fname. Returns file pointer for secret text.
-FILE *openText(const char *fname, BMP img)
+// Reads image header, color table and pixel array of the file opened in the
+// BMP structure pointed to by imgPtr into allocated memory. Used for files
+// that cannot be mapped. Returns 0 on success.
+static int readProperties(BMP *imgPtr)
 {
-    verifyFilename(fname, ".txt", "openText()");
-
-    FILE *filePtr = fopen(fname, "r"); // Open input file
-
-    // Terminates program if opening file failed
-    if (filePtr == NULL)
+    int status = readHeader(imgPtr);
+    if (status)
     {
-        clearTerminal();
-        fprintf(stderr,
-                "error opening secret text %s in openText()\n",
-                fname);
-        exit(EXIT_FAILURE);
+        return status;
     }
 
-    unsigned int charCount = 0; // Character counter
-    int character;              // Character in secret text
-
-    // Loop through each character in secret text
-    while ((character = getc(filePtr)) != EOF)
+    // Allocates memory for pixel array
+    imgPtr->pxArr = allocMemory(imgPtr->pxArrSize);
+    if (imgPtr->pxArr == NULL)
     {
-        // Terminates program if text contains non-ASCII character
-        if (character < ASCII_MIN || character > ASCII_MAX)
-        {
-            clearTerminal();
-            fprintf(stderr,
-                    "file error: %s contains non-ASCII character\n",
-                    fname);
-            exit(EXIT_FAILURE);
-        }
+        return ERR_ALLOC;
+    }
 
-        charCount++; // Increment character counter
+    // Obtains content of pixel array
+    if (fread(imgPtr->pxArr, sizeof(*imgPtr->pxArr),
+              imgPtr->pxArrSize, imgPtr->filePtr) != imgPtr->pxArrSize)
+    {
+        return ERR_FORMAT;
     }
-    rewind(filePtr); // Sets file pointer at the beginning of file stream
 
-    // Computes number of pixels needed to represent a binary digit
-    // of each 8-bit (1 byte) character in secret text
-    unsigned int pxNeed = charCount * CHAR_BIT;
+    addCount(&stats.bytesRead, imgPtr->pxArrSize);
+    return 0;
+}
 
-    // Computes total number of pixels used by the image
-    DWORD pxTotal = img.width * img.height;
+// Initializes structure members representing image properties of BMP structure
+// pointed to by imgPtr. Regular files are mapped into memory without copying;
+// other files are read with fread(). Returns 0 on success.
+int storeProperties(BMP *imgPtr)
+{
+    int status = mapProperties(imgPtr);
 
-    // Terminates program if secret text cannot fit in cover image
-    if (pxNeed > pxTotal)
+    // Falls back to reading the file if it could not be mapped
+    if (status == ERR_OPEN)
     {
-        clearTerminal();
-        fprintf(stderr,
-                "secret text %s has too many characters\n"
-                "%u pixels is needed but cover image only has %u pixels.\n",
-                fname, pxNeed, pxTotal);
-        exit(EXIT_FAILURE);
+        status = readProperties(imgPtr);
+    }
+    if (status)
+    {
+        return status;
     }
 
-    return filePtr;
+    // Rows to be modified are copied on first write by writeRow()
+    imgPtr->rowMod = NULL;
+    imgPtr->dirtyRows = 0;
+
+    return 0; // Structure members for image properties successfully initialized
 }
 
-// Writes the secret text intothe  text file indicated by fname. Secret text is
-// decoded from stego image stegImg and cover image covImg. Returns none.
-int decodeText(BMP covImg, BMP stegImg, const char *fname)
+// Parses a whole bitmap file held in the size bytes at data without copying
+// it. The memory is only read and must outlive the BMP structure. Stores 0
+// or an error code in the integer pointed to by statusPtr. Returns pointer to
+// BMP structure of the image, or NULL on failure.
+BMP *parseImage(const BYTE *data, size_t size, int *statusPtr)
 {
-    // Terminates program if pixel array size of cover and stego image
-    // are not equal. Suggests that the images are not related to each other.
-    if (covImg.pxArrSize != stegImg.pxArrSize)
+    BMP *imgPtr = allocZeroed(1, sizeof(BMP));
+    if (imgPtr == NULL)
     {
-        clearTerminal();
-        fprintf(stderr,
-                "%s",
-                "incompatible files: different cover image and stego "
-                "image in decodeText()\n");
-        exit(EXIT_FAILURE);
+        *statusPtr = ERR_ALLOC;
+        return NULL;
     }
 
-    verifyFilename(fname, ".txt", "decodeText()");
-
-    FILE *decodedTxt = fopen(fname, "w"); // Opens file for decoded text
-
-    // Terminates program if file could not be created
-    if (decodedTxt == NULL)
+    imgPtr->buffer = data;
+    *statusPtr = pointProperties(imgPtr, data, size);
+    if (*statusPtr)
     {
-        clearTerminal();
-        fprintf(stderr,
-                "fopen error: decoded text %s could not be created in "
-                "decodeText()\n",
-                fname);
-        exit(EXIT_FAILURE);
+        freeImage(imgPtr);
+        return NULL;
+    }
+
+    return imgPtr;
+}
+
+// Allocates the table of modified rows of the BMP structure pointed to by
+// imgPtr unless it already has one. Returns 0 on success.
+static int allocRowTable(BMP *imgPtr)
+{
+    if (imgPtr->rowMod == NULL)
+    {
+        imgPtr->rowMod =
+            allocZeroed(imgPtr->height, sizeof(*imgPtr->rowMod));
+    }
+
+    return imgPtr->rowMod == NULL ? ERR_ALLOC : 0;
+}
+
+// Copies row indicated by row of the original pixel array of the BMP
+// structure pointed to by imgPtr into newly allocated memory, without
+// touching the table of modified rows. Returns pointer to the copy, or NULL
+// if memory could not be allocated.
+static BYTE *copyRow(const BMP *imgPtr, LONG row)
+{
+    BYTE *rowPtr = allocMemory(imgPtr->pxRowSize);
+    if (rowPtr != NULL)
+    {
+        memcpy(rowPtr, imgPtr->pxArr + (size_t)row * imgPtr->pxRowSize,
+               imgPtr->pxRowSize);
+        addCount(&stats.rowsDirtied, 1);
+    }
+
+    return rowPtr;
+}
+
+// Obtains row indicated by row of the pixel array of the BMP structure pointed
+// to by imgPtr for modification. Copies the row from the original pixel array
+// on first write and marks it dirty. Returns pointer to the modified row, or
+// NULL if memory could not be allocated.
+BYTE *writeRow(BMP *imgPtr, LONG row)
+{
+    // Allocates table of modified rows on first write to the image
+    if (allocRowTable(imgPtr))
+    {
+        return NULL;
+    }
+
+    // Creates copy of row to be used for encoding secret text
+    if (imgPtr->rowMod[row] == NULL)
+    {
+        imgPtr->rowMod[row] = copyRow(imgPtr, row);
+        if (imgPtr->rowMod[row] == NULL)
+        {
+            return NULL;
+        }
+        imgPtr->dirtyRows++;
+    }
+
+    return imgPtr->rowMod[row];
+}
+
+// Obtains row indicated by row of the pixel array of the BMP structure pointed
+// to by imgPtr. Returns pointer to the modified row if it is dirty, or to the
+// original row otherwise.
+const BYTE *readRow(const BMP *imgPtr, LONG row)
+{
+    if (imgPtr->rowMod != NULL && imgPtr->rowMod[row] != NULL)
+    {
+        return imgPtr->rowMod[row];
+    }
+
+    return imgPtr->pxArr + (size_t)row * imgPtr->pxRowSize;
+}
+
+// Copies count original rows starting at row first of the pixel array of the
+// BMP structure pointed to by imgPtr into buf. Rows are read from the file at
+// their offset if the image was opened for streaming. Returns 0 on success.
+int readRows(const BMP *imgPtr, LONG first, LONG count, BYTE *buf)
+{
+    size_t size = (size_t)count * imgPtr->pxRowSize;
+    off_t offset = imgPtr->pxArrOffset + (off_t)first * imgPtr->pxRowSize;
+
+    if (imgPtr->pxArr != NULL) // Copies rows of a loaded image
+    {
+        memcpy(buf, imgPtr->pxArr + (size_t)first * imgPtr->pxRowSize, size);
+        return 0;
+    }
+
+    // Reads rows without moving the file position, so images may be shared
+    for (size_t done = 0; done < size;)
+    {
+        ssize_t got = pread(fileno(imgPtr->filePtr), buf + done, size - done,
+                            offset + done);
+        if (got <= 0)
+        {
+            return ERR_FORMAT; // File is shorter than its header claims
+        }
+        done += got;
+        addCount(&stats.bytesRead, got);
+    }
+
+    return 0;
+}
+
+// Obtains count original rows starting at row first of the pixel array of the
+// BMP structure pointed to by imgPtr, reading them into buf only if the image
+// was opened for streaming. Returns pointer to the rows, or NULL on failure.
+static const BYTE *fetchRows(const BMP *imgPtr, LONG first, LONG count,
+                             BYTE *buf)
+{
+    if (imgPtr->pxArr != NULL)
+    {
+        return imgPtr->pxArr + (size_t)first * imgPtr->pxRowSize;
+    }
+
+    return readRows(imgPtr, first, count, buf) ? NULL : buf;
+}
+
+// Returns number of rows of img processed at a time when streaming.
+static LONG chunkRows(BMP img)
+{
+    LONG rows = STREAM_CHUNK / img.pxRowSize;
+    return rows > 0 ? rows : 1; // Rows wider than a chunk are read one by one
+}
+
+// Prints image properties of img in stdin. Returns 0 on success.
+int printProperties(BMP img)
+{
+    clearTerminal();
+    puts("IMAGE PROPERTIES");
+    printf("%-14s: %d bytes\n", "Header size", img.headerSize);
+    printf("%-14s: %d pixels\n", "Image width", img.width);
+    printf("%-14s: %d pixels\n", "Image height", img.height);
+    printf("%-14s: %d bits\n", "Bit depth", img.bitDepth);
+    printf("%-14s: %d colors\n", "Color count", img.colorCount);
+    printf("%-14s: %d bytes\n", "Pixel array", img.pxArrSize);
+    printf("%-14s: %d byte\n", "Padding", img.padding);
+
+    return 0;
+}
+
+// Stores in reserved the 4 reserved bytes of the bitmap file header of img,
+// recording its embedding mode, scattering and density. Every mode is
+// marked, so that decoders know the stego image holds a payload header.
+// Returns none.
+static void markHeader(BYTE reserved[4], BMP img)
+{
+    memcpy(reserved, STEGO_MARK, 2);
+    reserved[2] = img.mode | (img.scattered ? MODE_SCATTERED : 0);
+    reserved[3] = img.density;
+}
+
+// Writes image header and color table of img into imgOut, recording its
+// embedding mode in the reserved bytes. Returns 0 on success.
+static int writeHeader(FILE *imgOut, BMP img)
+{
+    size_t rest = img.headerSize - STEGO_MARK_OFFSET - 4;
+    BYTE reserved[4];
+    markHeader(reserved, img);
+
+    if (fwrite(img.header, sizeof(*img.header), STEGO_MARK_OFFSET,
+               imgOut) != STEGO_MARK_OFFSET ||
+        fwrite(reserved, sizeof(*reserved), sizeof(reserved), imgOut) !=
+            sizeof(reserved) ||
+        fwrite(img.header + STEGO_MARK_OFFSET + 4, sizeof(*img.header), rest,
+               imgOut) != rest)
+    {
+        return ERR_WRITE;
+    }
+
+    // Images without a color table have colorTable NULL
+    if (img.tableSize > 0 &&
+        fwrite(img.colorTable, sizeof(*img.colorTable), img.tableSize,
+               imgOut) != img.tableSize)
+    {
+        return ERR_WRITE;
+    }
+
+    addCount(&stats.bytesWritten, img.headerSize + img.tableSize);
+    return 0;
+}
+
+// Creates stego image indicated by fname from the modified bitmap file
+// structure of cover image indicated by img. Returns 0 on success.
+int createStego(const char *fname, BMP img)
+{
+    int status = verifyFilename(fname, ".bmp", "createStego()");
+    if (status)
+    {
+        return status;
+    }
+
+    double start = statClock();
+    FILE *imgOut = fopen(fname, "wb"); // Opens stego image
+
+    // Stops if stego image could not be created
+    if (imgOut == NULL)
+    {
+        reportError("fopen() failed: %s could not be created in "
+                    "createStego()\n",
+                    fname);
+        return ERR_OPEN;
+    }
+
+    // Uses the modified file structure of cover image to create stego image
+    int failed = writeHeader(imgOut, img);
+
+    // Writes dirty rows from their copies and each run of unmodified rows
+    // straight from the original pixel array
+    for (LONG row = 0; row < img.height && !failed;)
+    {
+        LONG end = row + 1; // Row after the current run
+        if (img.rowMod == NULL || img.rowMod[row] == NULL)
+        {
+            while (end < img.height &&
+                   (img.rowMod == NULL || img.rowMod[end] == NULL))
+            {
+                end++;
+            }
+        }
+
+        size_t runSize = (size_t)(end - row) * img.pxRowSize;
+        failed = fwrite(readRow(&img, row), sizeof(BYTE), runSize,
+                        imgOut) != runSize;
+        addCount(&stats.bytesWritten, runSize);
+        row = end;
+    }
+
+    // Reports failure of any write, including buffered data flushed on close
+    failed |= fclose(imgOut) != 0;
+    addTime(&stats.writeTime, start);
+    if (failed)
+    {
+        reportError("fwrite() failed: %s could not be written in "
+                    "createStego()\n",
+                    fname);
+        return ERR_WRITE;
+    }
+
+    return 0; // Stego image is successfully created
+}
+
+// Returns size in bytes of the stego image written from img by writeStego().
+size_t stegoSize(BMP img)
+{
+    return (size_t)img.headerSize + img.tableSize + img.pxArrSize;
+}
+
+// Writes stego image from the modified bitmap file structure of cover image
+// img into the size bytes of buf, as createStego() writes it into a file.
+// Returns 0 on success or ERR_BUFFER if buf is smaller than stegoSize().
+int writeStego(BMP img, BYTE *buf, size_t size)
+{
+    if (size < stegoSize(img))
+    {
+        return ERR_BUFFER;
+    }
+    double start = statClock();
+
+    // Copies image header with its reserved bytes marked, then color table
+    memcpy(buf, img.header, img.headerSize);
+    markHeader(buf + STEGO_MARK_OFFSET, img);
+    buf += img.headerSize;
+    if (img.tableSize > 0)
+    {
+        memcpy(buf, img.colorTable, img.tableSize);
+        buf += img.tableSize;
+    }
+
+    // Copies each row from its modified copy or the original pixel array
+    for (LONG row = 0; row < img.height; row++)
+    {
+        memcpy(buf, readRow(&img, row), img.pxRowSize);
+        buf += img.pxRowSize;
+    }
+
+    addTime(&stats.writeTime, start);
+    addCount(&stats.bytesWritten, stegoSize(img));
+    return 0;
+}
+
+// Copies the first size bytes of the file opened as in into the empty file
+// opened as out, sharing its blocks with a reflink where the filesystem
+// supports it and copying them in the kernel otherwise. Returns 0 on success.
+static int cloneFile(int in, int out, size_t size)
+{
+#ifdef FICLONE
+    // Clones whole file, which may hold bytes after the pixel array
+    if (!ioctl(out, FICLONE, in))
+    {
+        return ftruncate(out, size) ? ERR_WRITE : 0;
+    }
+#endif
+
+    off_t inOffset = 0, outOffset = 0;
+    while ((size_t)outOffset < size)
+    {
+        ssize_t copied = copy_file_range(in, &inOffset, out, &outOffset,
+                                         size - outOffset, 0);
+        if (copied < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (copied <= 0)
+        {
+            return ERR_WRITE; // Unsupported, or file shorter than expected
+        }
+    }
+
+    return 0;
+}
+
+// Writes the count dirty rows of img starting at row first into the file
+// opened as fd at their offset, a batch of rows per call. Returns 0 on
+// success.
+static int patchRows(int fd, BMP img, LONG first, LONG count)
+{
+    struct iovec iov[64]; // Rows written by each call
+
+    while (count > 0)
+    {
+        int rows = count < 64 ? count : 64;
+        size_t size = (size_t)rows * img.pxRowSize;
+        for (int i = 0; i < rows; i++)
+        {
+            iov[i].iov_base = img.rowMod[first + i];
+            iov[i].iov_len = img.pxRowSize;
+        }
+
+        off_t offset = img.pxArrOffset + (off_t)first * img.pxRowSize;
+        if (pwritev(fd, iov, rows, offset) != (ssize_t)size)
+        {
+            return ERR_WRITE;
+        }
+        addCount(&stats.bytesWritten, size);
+
+        first += rows;
+        count -= rows;
+    }
+
+    return 0;
+}
+
+// Creates stego image indicated by fname as createStego() does, but clones
+// the cover image file and then writes only the dirty rows and the reserved
+// bytes of the header that changed. If fname is the cover image itself, it is
+// patched in place without cloning. Writes the whole image with createStego()
+// instead if img was not loaded from a regular file or the file cannot be
+// cloned. Returns 0 on success.
+int patchStego(const char *fname, BMP img)
+{
+    int status = verifyFilename(fname, ".bmp", "patchStego()");
+    if (status)
+    {
+        return status;
+    }
+
+    struct stat coverInfo, stegoInfo;
+    if (img.filePtr == NULL || img.pxArr == NULL ||
+        fstat(fileno(img.filePtr), &coverInfo) || !S_ISREG(coverInfo.st_mode))
+    {
+        return createStego(fname, img);
+    }
+
+    // Truncating the cover image would destroy the pixels being copied
+    int inPlace = !stat(fname, &stegoInfo) &&
+                  stegoInfo.st_dev == coverInfo.st_dev &&
+                  stegoInfo.st_ino == coverInfo.st_ino;
+
+    double start = statClock();
+    int fd = open(fname, inPlace ? O_WRONLY : O_WRONLY | O_CREAT | O_TRUNC,
+                  0666);
+    if (fd < 0)
+    {
+        reportError("open() failed: %s could not be created in "
+                    "patchStego()\n",
+                    fname);
+        return ERR_OPEN;
+    }
+
+    if (!inPlace && cloneFile(fileno(img.filePtr), fd, stegoSize(img)))
+    {
+        close(fd);
+        return createStego(fname, img); // Truncates the partial copy
+    }
+
+    // Records embedding mode in the reserved bytes if they changed
+    BYTE reserved[4];
+    markHeader(reserved, img);
+    int failed = 0;
+    if (memcmp(reserved, &img.header[STEGO_MARK_OFFSET], sizeof(reserved)))
+    {
+        failed = pwrite(fd, reserved, sizeof(reserved), STEGO_MARK_OFFSET) !=
+                 sizeof(reserved);
+        addCount(&stats.bytesWritten, sizeof(reserved));
+    }
+
+    // Writes each run of dirty rows over the cloned pixel array
+    for (LONG row = 0; img.rowMod != NULL && row < img.height && !failed;)
+    {
+        if (img.rowMod[row] == NULL)
+        {
+            row++;
+            continue;
+        }
+
+        LONG end = row + 1; // Row after the current run
+        while (end < img.height && img.rowMod[end] != NULL)
+        {
+            end++;
+        }
+        failed = patchRows(fd, img, row, end - row);
+        row = end;
+    }
+
+    failed |= close(fd) != 0;
+    addTime(&stats.writeTime, start);
+    if (failed)
+    {
+        reportError("pwrite() failed: %s could not be written in "
+                    "patchStego()\n",
+                    fname);
+        return ERR_WRITE;
+    }
+
+    return 0; // Stego image is successfully created
+}
+
+// Releases the rows copied by writeRow() into the BMP structure pointed to
+// by imgPtr, leaving its original pixel array unmodified. Lets copies of one
+// loaded BMP structure be encoded separately. Returns none.
+void freeRows(BMP *imgPtr)
+{
+    if (imgPtr->rowMod != NULL)
+    {
+        for (LONG row = 0; row < imgPtr->height; row++)
+        {
+            freeMemory(imgPtr->rowMod[row]);
+        }
+        freeMemory(imgPtr->rowMod);
+    }
+
+    imgPtr->rowMod = NULL;
+    imgPtr->dirtyRows = 0;
+}
+
+// Releases memory allocated for BMP structure pointed to by imgPtr.
+// Returns 0 on success.
+int freeImage(BMP *imgPtr)
+{
+    freeRows(imgPtr); // Deallocates the rows copied by writeRow()
+
+    if (imgPtr->map != NULL)
+    {
+        // Header, color table and pixel array all point into the mapping
+        munmap(imgPtr->map, imgPtr->mapSize);
+    }
+    else if (imgPtr->buffer == NULL) // Caller's memory is left to the caller
+    {
+        freeMemory(imgPtr->header);
+        freeMemory(imgPtr->pxArr);
+
+        // Deallocates memory used by color table if it exists
+        if (imgPtr->colorTable != NULL)
+        {
+            freeMemory(imgPtr->colorTable);
+        }
+    }
+
+    // Closes the file pointer for cover image, unless parsed from memory
+    if (imgPtr->filePtr != NULL)
+    {
+        fclose(imgPtr->filePtr);
+    }
+    freeMemory(imgPtr); // Deallocates memory for BMP structure
+
+    return 0;
+}
+
+static int bandThreads = 0; // Threads per image, or 0 for every online core
+
+// Sets number of threads encoding or decoding the row bands of one image,
+// where 0 uses every online core. Must be called before jobs start.
+// Returns none.
+void setBandThreads(int count)
+{
+    bandThreads = count > 0 ? count : 0;
+}
+
+struct band            // Structure representing rows handled by one thread
+{
+    LONG first;        // First row of band
+    LONG last;         // Row after the last row of band
+    size_t pxLeft;     // Channel bytes of payload within band
+    int status;        // Status of band, 0 on success
+    int threaded;      // Nonzero if band ran on a thread of its own
+    STATS stats;       // Counters of band if it ran on its own thread
+};
+
+// Splits the first rowCount rows of an image with width channel bytes per
+// row, pxTotal of which hold payload bits at density bits per byte, into
+// bands stored in the array of count structures of size bytes at items,
+// each starting with a band structure. Bands hold a multiple of 8 rows, so
+// each starts on a character boundary whatever the width and density.
+// Returns number of bands, at most count, with at least BAND_MIN_BYTES
+// channel bytes each but the last.
+static int splitBands(void *items, size_t size, int count, LONG rowCount,
+                      LONG width, size_t pxTotal)
+{
+    int bands = bandThreads > 0 ? bandThreads
+                                : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t)bands > pxTotal / BAND_MIN_BYTES)
+    {
+        bands = pxTotal / BAND_MIN_BYTES;
+    }
+    if (bands > count)
+    {
+        bands = count;
+    }
+    if (bands < 1)
+    {
+        bands = 1;
+    }
+
+    for (int i = 0; i < bands; i++)
+    {
+        struct band *bandPtr = (struct band *)((BYTE *)items + i * size);
+        bandPtr->first = i == 0 ? 0
+                                : (LONG)((long long)rowCount * i / bands) /
+                                      CHAR_BIT * CHAR_BIT;
+        bandPtr->last = i == bands - 1
+                            ? rowCount
+                            : (LONG)((long long)rowCount * (i + 1) / bands) /
+                                  CHAR_BIT * CHAR_BIT;
+
+        // Payload bytes before and within the band, clamped to the payload
+        size_t before = (size_t)bandPtr->first * width;
+        size_t end = (size_t)bandPtr->last * width;
+        before = before < pxTotal ? before : pxTotal;
+        end = end < pxTotal ? end : pxTotal;
+        bandPtr->pxLeft = end - before;
+        bandPtr->status = 0;
+        bandPtr->threaded = 0;
+        memset(&bandPtr->stats, 0, sizeof(bandPtr->stats));
+    }
+
+    return bands;
+}
+
+// Runs worker on each of count structures of size bytes at items, each
+// starting with a band structure: the first on the calling thread and the
+// rest on threads of their own, or on the calling thread if none could be
+// started. Adds the counters of threaded bands to the caller's stats.
+// Returns status of the first band that failed, or 0 on success.
+static int runBands(void *(*worker)(void *), void *items, size_t size,
+                    int count)
+{
+    pthread_t threads[BAND_THREADS_MAX];
+
+    for (int i = 1; i < count; i++)
+    {
+        struct band *bandPtr = (struct band *)((BYTE *)items + i * size);
+        bandPtr->threaded =
+            !pthread_create(&threads[i], NULL, worker, bandPtr);
+    }
+    worker(items);
+
+    int status = ((struct band *)items)->status;
+    for (int i = 1; i < count; i++)
+    {
+        struct band *bandPtr = (struct band *)((BYTE *)items + i * size);
+        if (bandPtr->threaded)
+        {
+            pthread_join(threads[i], NULL);
+            mergeStats(bandPtr->stats);
+        }
+        else
+        {
+            worker(bandPtr);
+        }
+        status = status ? status : bandPtr->status;
+    }
+
+    return status;
+}
+
+struct embedder             // Structure representing progress of encoding text
+{
+    const BYTE *chars;      // Characters of secret text
+    size_t length;          // Number of characters of secret text
+    size_t next;            // Index of next character to be encoded
+    BYTE character;         // Bits of current character not yet encoded
+    unsigned int bitsLeft;  // Number of bits of character not yet encoded
+    int maxPxValue;         // Highest pixel value allowed by color depth
+    int mode;               // Embedding mode
+    int density;            // Bits encoded into each channel byte
+    BYTE *channels;         // Color channels of a 32-bit row, or NULL
+};
+
+// Encodes the next density * count bits of secret text of the embedder
+// pointed to by embPtr into the first count pixels of the row pointed to by
+// rowPtr. Whole characters are encoded by a vectorized kernel, except for
+// +1/-1 deltas in images below 8 bits; bits split across rows are encoded
+// one pixel at a time. Returns none.
+static void embedRow(struct embedder *embPtr, BYTE *rowPtr, LONG count)
+{
+    LONG px = 0; // Index of current pixel in row
+    int density = embPtr->density;
+
+    while (px < count)
+    {
+        // Encodes groups of density characters, which fill 8 pixels, once a
+        // character boundary is reached
+        size_t groups = (count - px) / CHAR_BIT;
+        if (embPtr->next < embPtr->length &&
+            (embPtr->length - embPtr->next) / density < groups)
+        {
+            groups = (embPtr->length - embPtr->next) / density;
+        }
+        if (embPtr->bitsLeft == 0 && groups > 0 &&
+            embPtr->next < embPtr->length &&
+            (embPtr->maxPxValue >= UCHAR_MAX || embPtr->mode == MODE_LSB))
+        {
+            if (embPtr->mode == MODE_LSB)
+            {
+                embedLsbGroups(rowPtr + px, embPtr->chars + embPtr->next,
+                               groups, density);
+            }
+            else
+            {
+                embedDiffBits(rowPtr + px, embPtr->chars + embPtr->next,
+                              groups);
+            }
+            embPtr->next += groups * density;
+            px += groups * CHAR_BIT;
+            continue;
+        }
+
+        // Takes the next density bits, obtaining the next character once
+        // each bit of current one is encoded
+        int bits = 0;
+        for (int i = 0; i < density; i++)
+        {
+            if (embPtr->bitsLeft == 0)
+            {
+                embPtr->character = embPtr->next < embPtr->length
+                                        ? embPtr->chars[embPtr->next++]
+                                        : 0;
+                embPtr->bitsLeft = CHAR_BIT;
+            }
+
+            // Takes most significant bit not yet encoded
+            bits = (bits << 1) | (embPtr->character >> (CHAR_BIT - 1));
+            embPtr->character <<= 1; // Shift bits of character to the left
+            embPtr->bitsLeft--;
+        }
+
+        if (embPtr->mode == MODE_LSB)
+        {
+            BYTE mask = (1u << density) - 1;
+            rowPtr[px] = (rowPtr[px] & ~mask) | bits;
+        }
+        else
+        {
+            embedDiffBit(&rowPtr[px], bits, embPtr->maxPxValue);
+        }
+        px++;
+    }
+}
+
+// Encodes the next count bits of secret text of the embedder pointed to by
+// embPtr into the first count channel bytes of row rowPtr of the image pointed
+// to by imgPtr. Rows of 8-bit and 24-bit images are encoded in place; color
+// channels of 32-bit rows are gathered without alpha, encoded and scattered
+// back. Returns none.
+static void embedChannels(struct embedder *embPtr, const BMP *imgPtr,
+                          BYTE *rowPtr, LONG count)
+{
+    if (imgPtr->pxSize != 4)
+    {
+        embedRow(embPtr, rowPtr, count);
+        return;
+    }
+
+    gatherChannels(rowPtr, imgPtr->width, embPtr->channels);
+    embedRow(embPtr, embPtr->channels, count);
+    scatterChannels(rowPtr, imgPtr->width, embPtr->channels);
+}
+
+// Allocates memory for the color channels of a row of the image pointed to by
+// imgPtr if it has 32-bit pixels, storing its address in the pointer pointed
+// to by bufPtr. Returns 0 on success.
+static int allocChannels(const BMP *imgPtr, BYTE **bufPtr, const char *caller)
+{
+    *bufPtr = NULL;
+    if (imgPtr->pxSize == 4 &&
+        (*bufPtr = allocMemory(imgPtr->rowChannels)) == NULL)
+    {
+        reportError("malloc() failed: no memory for channels in %s\n",
+                    caller);
+        return ERR_ALLOC;
+    }
+
+    return 0;
+}
+
+// Returns number of the width pixels of pxSize bytes that differ between
+// rows before and after.
+static size_t changedPixels(const BYTE *before, const BYTE *after, LONG width,
+                            int pxSize)
+{
+    size_t changed = 0;
+    for (size_t i = 0; i < (size_t)width * pxSize; i += pxSize)
+    {
+        changed += memcmp(before + i, after + i, pxSize) != 0;
+    }
+    return changed;
+}
+
+// Returns number of channel bytes holding length bytes of payload encoded
+// with embedding mode mode at density density. Hamming blocks are encoded in
+// groups of 8, which hold density bytes.
+size_t payloadChannels(int mode, int density, size_t length)
+{
+    if (mode == MODE_HAMMING)
+    {
+        return (length + density - 1) / density * CHAR_BIT *
+               HAMMING_PIXELS(density);
+    }
+
+    return (length * CHAR_BIT + density - 1) / density;
+}
+
+// Returns most bytes of payload that channels channel bytes hold when
+// encoded with embedding mode mode at density density.
+size_t payloadCapacity(int mode, int density, size_t channels)
+{
+    if (mode == MODE_HAMMING)
+    {
+        return channels / (CHAR_BIT * HAMMING_PIXELS(density)) * density;
+    }
+
+    return channels * density / CHAR_BIT;
+}
+
+// Checks that embedding mode mode and density, the number of bits encoded
+// into each channel byte, can be used together. Only MODE_LSB encodes more
+// than 1 bit per byte; MODE_HAMMING encodes density bits into each block of
+// HAMMING_PIXELS(density) bytes. Returns 0 on success.
+static int checkDensity(int mode, int density, const char *caller)
+{
+    if (mode == MODE_HAMMING)
+    {
+        if (density < 2 || density > HAMMING_MAX)
+        {
+            reportError("invalid Hamming block: %d bits in %s must be 2 to "
+                        "%d\n",
+                        density, caller, HAMMING_MAX);
+            return ERR_FORMAT;
+        }
+        return 0;
+    }
+    if (density < 1 || density > DENSITY_MAX ||
+        (mode != MODE_LSB && density != 1))
+    {
+        reportError("invalid density: %d bits per byte in %s needs blind "
+                    "mode and at most %d bits\n",
+                    density, caller, DENSITY_MAX);
+        return ERR_FORMAT;
+    }
+
+    return 0;
+}
+
+struct embedBand         // Structure representing rows encoded by a thread
+{
+    struct band band;    // Rows of band, first for runBands()
+    BMP *imgPtr;         // Image being encoded
+    struct embedder emb; // Progress of encoding within band
+    LONG dirtied;        // Number of rows copied by band
+};
+
+// Encodes the secret text bits of the embed band pointed to by arg into its
+// rows, copying each row not yet modified. Rows of separate bands are
+// disjoint, so the table of modified rows is shared without locking.
+// Returns NULL.
+static void *embedBand(void *arg)
+{
+    struct embedBand *bandPtr = arg;
+    BMP *imgPtr = bandPtr->imgPtr;
+    size_t pxLeft = bandPtr->band.pxLeft;
+
+    bandPtr->band.status = allocChannels(imgPtr, &bandPtr->emb.channels,
+                                         "embedBand()");
+
+    // Encodes bits into the channel bytes of each row, skipping padding
+    for (LONG row = bandPtr->band.first;
+         !bandPtr->band.status && pxLeft > 0; row++)
+    {
+        LONG count = pxLeft < (size_t)imgPtr->rowChannels
+                         ? (LONG)pxLeft
+                         : imgPtr->rowChannels;
+
+        // Copies current row on its first modification
+        BYTE *rowPtr = imgPtr->rowMod[row];
+        if (rowPtr == NULL)
+        {
+            rowPtr = imgPtr->rowMod[row] = copyRow(imgPtr, row);
+            if (rowPtr == NULL)
+            {
+                bandPtr->band.status = ERR_ALLOC;
+                break;
+            }
+            bandPtr->dirtied++;
+        }
+
+        embedChannels(&bandPtr->emb, imgPtr, rowPtr, count);
+        pxLeft -= count;
+    }
+
+    freeMemory(bandPtr->emb.channels);
+    bandPtr->band.stats = getStats();
+
+    return NULL;
+}
+
+// Returns offset in its row of the channel byte col of a row of the image
+// pointed to by imgPtr. Channel bytes of 32-bit rows skip alpha.
+static size_t channelOffset(const BMP *imgPtr, size_t col)
+{
+    return imgPtr->pxSize == 4 ? col / 3 * 4 + col % 3 : col;
+}
+
+// Returns number of channel bytes of the image pointed to by imgPtr that are
+// gathered at a time in payload order: SCATTER_BLOCK, rounded down to whole
+// groups of Hamming blocks in MODE_HAMMING.
+static size_t gatherSize(const BMP *imgPtr)
+{
+    if (imgPtr->mode != MODE_HAMMING)
+    {
+        return SCATTER_BLOCK;
+    }
+
+    size_t group = CHAR_BIT * HAMMING_PIXELS(imgPtr->density);
+    return SCATTER_BLOCK / group * group;
+}
+
+// Copies into values the count channel bytes, at most SCATTER_BLOCK, of the
+// image pointed to by imgPtr that hold payload from channel byte first:
+// consecutive bytes of the pixel array if scatPtr is NULL, or else the
+// destinations of the entries of the permutation pointed to by scatPtr,
+// which are sorted into pairs so that rows are read in ascending order.
+// Pairs must then hold 2 * count elements. Returns none.
+static void loadChannels(const BMP *imgPtr, const SCATTER *scatPtr,
+                         size_t first, size_t count, unsigned long long *pairs,
+                         BYTE *values)
+{
+    LONG width = imgPtr->rowChannels;
+
+    if (scatPtr != NULL)
+    {
+        scatterBlock(scatPtr, first, count, pairs);
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t dest = pairs[i] >> SCATTER_SLOT_BITS;
+            values[pairs[i] & (SCATTER_BLOCK - 1)] =
+                readRow(imgPtr, dest / width)[channelOffset(imgPtr,
+                                                            dest % width)];
+        }
+        return;
+    }
+
+    // Copies the channel bytes of each row in turn
+    for (size_t done = 0; done < count;)
+    {
+        size_t col = (first + done) % width;
+        size_t n = width - col < count - done ? width - col : count - done;
+        const BYTE *rowPtr = readRow(imgPtr, (first + done) / width);
+        for (size_t i = 0; i < n; i++)
+        {
+            values[done + i] = rowPtr[channelOffset(imgPtr, col + i)];
+        }
+        done += n;
+    }
+}
+
+// Stores the count channel bytes values back where loadChannels() copied
+// them from with the same arguments, writing only those that changed, so
+// that rows holding no changed byte are not copied. Returns 0 on success.
+static int storeChannels(BMP *imgPtr, const SCATTER *scatPtr, size_t first,
+                         size_t count, const unsigned long long *pairs,
+                         const BYTE *values)
+{
+    LONG width = imgPtr->rowChannels;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t dest = first + i;
+        BYTE value = values[i];
+        if (scatPtr != NULL)
+        {
+            dest = pairs[i] >> SCATTER_SLOT_BITS;
+            value = values[pairs[i] & (SCATTER_BLOCK - 1)];
+        }
+
+        LONG row = dest / width;
+        size_t offset = channelOffset(imgPtr, dest % width);
+        if (readRow(imgPtr, row)[offset] != value)
+        {
+            BYTE *rowPtr = writeRow(imgPtr, row);
+            if (rowPtr == NULL)
+            {
+                return ERR_ALLOC;
+            }
+            rowPtr[offset] = value;
+        }
+    }
+
+    return 0;
+}
+
+// Encodes the next bytes of secret text of the embedder pointed to by embPtr
+// into the count channel bytes px, whole groups of 8 Hamming blocks of
+// embPtr->density bits. The last group is padded with null bytes past the
+// end of the text. Returns none.
+static void embedBlocks(struct embedder *embPtr, BYTE *px, size_t count)
+{
+    int k = embPtr->density;
+    size_t groupPx = CHAR_BIT * HAMMING_PIXELS(k); // Channel bytes of a group
+    size_t groups = count / groupPx;
+    size_t whole = (embPtr->length - embPtr->next) / k; // Groups of text left
+
+    whole = whole < groups ? whole : groups;
+    embedHammingGroups(px, embPtr->chars + embPtr->next, whole, k);
+    embPtr->next += whole * k;
+
+    if (whole < groups)
+    {
+        BYTE last[HAMMING_MAX] = {0};
+        memcpy(last, embPtr->chars + embPtr->next,
+               embPtr->length - embPtr->next);
+        embedHammingGroups(px + whole * groupPx, last, 1, k);
+        embPtr->next = embPtr->length;
+    }
+}
+
+// Encodes the payload bits of the embedder pointed to by embPtr into the
+// first pxTotal channel bytes in payload order of the image pointed to by
+// imgPtr, which follow the keyed permutation of imgPtr->key if its payload
+// is scattered. Channel bytes are gathered a block at a time, encoded as one
+// row, or as Hamming blocks in MODE_HAMMING, and the changed ones written
+// back. Returns 0 on success.
+static int embedGathered(struct embedder *embPtr, BMP *imgPtr,
+                         size_t pxTotal)
+{
+    SCATTER scat; // Permutation of every channel byte of the image
+    const SCATTER *scatPtr = NULL;
+    if (imgPtr->scattered)
+    {
+        openScatter(&scat, imgPtr->key,
+                    (size_t)imgPtr->rowChannels * imgPtr->height);
+        scatPtr = &scat;
+    }
+
+    unsigned long long *pairs =
+        scatPtr != NULL ? allocMemory(2 * SCATTER_BLOCK * sizeof(*pairs))
+                        : NULL;
+    BYTE *values = allocMemory(SCATTER_BLOCK); // Gathered channel bytes
+    int status = (scatPtr != NULL && pairs == NULL) || values == NULL
+                     ? ERR_ALLOC
+                     : 0;
+
+    size_t size = gatherSize(imgPtr);
+    for (size_t first = 0; !status && first < pxTotal; first += size)
+    {
+        size_t count = pxTotal - first < size ? pxTotal - first : size;
+        loadChannels(imgPtr, scatPtr, first, count, pairs, values);
+        if (imgPtr->mode == MODE_HAMMING)
+        {
+            embedBlocks(embPtr, values, count);
+        }
+        else
+        {
+            embedRow(embPtr, values, count);
+        }
+        status = storeChannels(imgPtr, scatPtr, first, count, pairs, values);
+    }
+
+    freeMemory(pairs);
+    freeMemory(values);
+
+    return status;
+}
+
+// Checks on behalf of function caller that the payload header header can be
+// encoded into the original pixels of the image pointed to by imgPtr. In
+// MODE_DIFF, each 1 bit adds 1 to its channel byte, so a byte of 255 keeps
+// its value and decodes as 0, leaving the header unreadable. Bits of secret
+// text are clamped the same way, which the checksum of the payload trailer
+// detects when decoding. Returns 0 on success.
+static int checkHeaderBits(const BMP *imgPtr, const BYTE *header,
+                           const char *caller)
+{
+    const size_t count = PAYLOAD_HEADER_SIZE * CHAR_BIT; // Header bits
+    unsigned long long pairs[2 * PAYLOAD_HEADER_SIZE * CHAR_BIT]; // Scratch
+
+    if (imgPtr->mode != MODE_DIFF)
+    {
+        return 0;
+    }
+
+    // Header bits go through the same permutation as the rest of payload
+    SCATTER scat;
+    if (imgPtr->key != 0)
+    {
+        openScatter(&scat, imgPtr->key,
+                    (size_t)imgPtr->rowChannels * imgPtr->height);
+        scatterBlock(&scat, 0, count, pairs);
+    }
+
+    // Reads rows of images opened for streaming one at a time
+    BYTE *buf = NULL;
+    if (imgPtr->pxArr == NULL &&
+        (buf = allocMemory(imgPtr->pxRowSize)) == NULL)
+    {
+        reportError("malloc() failed: no memory for rows in %s\n", caller);
+        return ERR_ALLOC;
+    }
+
+    int status = 0;
+    const BYTE *rowPtr = NULL;
+    LONG lastRow = -1; // Row read last
+    for (size_t i = 0; i < count && !status; i++)
+    {
+        size_t dest = i;
+        size_t bit = i;
+        if (imgPtr->key != 0)
+        {
+            dest = pairs[i] >> SCATTER_SLOT_BITS;
+            bit = pairs[i] & (SCATTER_BLOCK - 1);
+        }
+        if (!((header[bit / CHAR_BIT] >> (CHAR_BIT - 1 - bit % CHAR_BIT)) & 1))
+        {
+            continue; // Bits of 0 subtract 1, which decodes even at 0
+        }
+
+        LONG row = dest / imgPtr->rowChannels;
+        if (row != lastRow &&
+            (rowPtr = fetchRows(imgPtr, row, 1, buf)) == NULL)
+        {
+            status = ERR_FORMAT;
+            break;
+        }
+        lastRow = row;
+
+        if (rowPtr[channelOffset(imgPtr, dest % imgPtr->rowChannels)] ==
+            UCHAR_MAX)
+        {
+            reportError("cover image has saturated pixels where the payload "
+                        "header goes: encode it blind or use another cover "
+                        "image in %s\n",
+                        caller);
+            status = ERR_FORMAT;
+        }
+    }
+
+    freeMemory(buf);
+    return status;
+}
+
+// Encodes the length bytes of payload header and secret text at text into
+// the BMP structure pointed to by imgPtr, using its embedding mode and
+// density, on behalf of function caller. Large payloads are split into row
+// bands encoded on parallel threads, each starting at the character that
+// its first row holds. Payloads scattered by the key of the image, and
+// Hamming blocks, which straddle rows, are encoded in one pass instead.
+// Releases text. Returns 0 on success.
+static int embedPayload(BMP *imgPtr, BYTE *text, size_t charCount,
+                        const char *caller)
+{
+    int mode = imgPtr->mode;
+    int density = imgPtr->density;
+
+    int status = checkHeaderBits(imgPtr, text, caller);
+    if (status)
+    {
+        freeMemory(text);
+        return status;
+    }
+
+    if (allocRowTable(imgPtr))
+    {
+        reportError("malloc() failed: no memory for modified rows in %s\n",
+                    caller);
+        freeMemory(text);
+        return ERR_ALLOC;
+    }
+
+    // Channel bytes to be modified, and rows holding them
+    size_t pxTotal = payloadChannels(mode, density, charCount);
+    LONG rowCount = (pxTotal + imgPtr->rowChannels - 1) / imgPtr->rowChannels;
+
+    // Records scattering for the header of the stego image
+    imgPtr->scattered = imgPtr->key != 0;
+
+    double start = statClock();
+    if (imgPtr->scattered || mode == MODE_HAMMING)
+    {
+        struct embedder emb = {text,      charCount, 0,       0, 0,
+                               UCHAR_MAX, mode,      density, NULL};
+        status = embedGathered(&emb, imgPtr, pxTotal);
+    }
+    else
+    {
+        struct embedBand bands[BAND_THREADS_MAX];
+        int bandCount = splitBands(bands, sizeof(*bands), BAND_THREADS_MAX,
+                                   rowCount, imgPtr->rowChannels, pxTotal);
+        for (int i = 0; i < bandCount; i++)
+        {
+            // Each supported format stores bits in whole bytes
+            size_t next = (size_t)bands[i].band.first * imgPtr->rowChannels *
+                          density / CHAR_BIT;
+            struct embedder emb = {text,      charCount, next,    0, 0,
+                                   UCHAR_MAX, mode,      density, NULL};
+            bands[i].imgPtr = imgPtr;
+            bands[i].emb = emb;
+            bands[i].dirtied = 0;
+        }
+
+        status = runBands(embedBand, bands, sizeof(*bands), bandCount);
+        for (int i = 0; i < bandCount; i++)
+        {
+            imgPtr->dirtyRows += bands[i].dirtied;
+        }
+    }
+    addTime(&stats.encodeTime, start);
+
+    if (status)
+    {
+        reportError("malloc() failed: no memory for encoded rows in %s\n",
+                    caller);
+        freeMemory(text);
+        return status;
+    }
+
+    // Compares modified rows with the original pixel array only for stats
+    for (LONG row = 0; statsEnabled && imgPtr->rowMod != NULL &&
+                       row < imgPtr->height;
+         row++)
+    {
+        if (imgPtr->rowMod[row] != NULL)
+        {
+            addCount(&stats.pixelsModified,
+                     changedPixels(imgPtr->pxArr +
+                                       (size_t)row * imgPtr->pxRowSize,
+                                   imgPtr->rowMod[row], imgPtr->width,
+                                   imgPtr->pxSize));
+        }
+    }
+
+    freeMemory(text); // Releases secret text
+
+    return 0; // Secret text succesfully encoded
+}
+
+// Encodes secret text in the file indicated by fname into the BMP structure
+// pointed to by imgPtr using embedding mode mode. MODE_LSB lets the secret
+// text be decoded without the cover image and encodes density bits into each
+// channel byte. MODE_HAMMING is decoded the same way and encodes density bits
+// into each block of HAMMING_PIXELS(density) bytes, changing at most one of
+// them. Flag PAYLOAD_COMPRESSED of flags compresses the secret text
+// first. MODE_DIFF rejects cover images whose pixels of 255 would clamp bits
+// of the payload header; clamped bits of secret text fail its checksum when
+// decoding. Returns 0 on success.
+int encodeText(const char *fname, BMP *imgPtr, int mode, int density,
+               int flags)
+{
+    BYTE *openText(const char *fname, BMP img, int flags, size_t *lengthPtr,
+                   int *statusPtr); // Function prototype
+
+    int status = checkDensity(mode, density, "encodeText()");
+    if (status)
+    {
+        return status;
+    }
+
+    // Records mode for the header of the stego image and for openText()
+    imgPtr->mode = mode;
+    imgPtr->density = density;
+
+    size_t charCount; // Number of characters in secret text
+    double start = statClock();
+    BYTE *text = openText(fname, *imgPtr, flags, &charCount, &status);
+    addTime(&stats.textTime, start);
+    if (text == NULL)
+    {
+        return status;
+    }
+
+    return embedPayload(imgPtr, text, charCount, "encodeText()");
+}
+
+// Encodes the length bytes of secret data at data into the BMP structure
+// pointed to by imgPtr, with mode, density and flags as in encodeText(). Data
+// need not be ASCII since its payload header records its length.
+// Returns 0 on success.
+int encodeBytes(BMP *imgPtr, const BYTE *data, size_t length, int mode,
+                int density, int flags)
+{
+    BYTE *packText(BYTE *payload, size_t charCount, BMP img, int flags,
+                   const char *fname, size_t *lengthPtr,
+                   int *statusPtr); // Function prototype
+
+    int status = checkDensity(mode, density, "encodeBytes()");
+    if (status)
+    {
+        return status;
+    }
+
+    imgPtr->mode = mode;
+    imgPtr->density = density;
+
+    // Copies data after room for its payload header
+    BYTE *payload = allocMemory(PAYLOAD_HEADER_SIZE + length);
+    if (payload == NULL)
+    {
+        return ERR_ALLOC;
+    }
+    memcpy(payload + PAYLOAD_HEADER_SIZE, data, length);
+
+    size_t charCount; // Number of bytes to be encoded
+    double start = statClock();
+    payload = packText(payload, length, *imgPtr, flags, "in memory",
+                       &charCount, &status);
+    addTime(&stats.textTime, start);
+    if (payload == NULL)
+    {
+        return status;
+    }
+
+    return embedPayload(imgPtr, payload, charCount, "encodeBytes()");
+}
+
+// Creates stego image indicated by stegoName by encoding secret text in the
+// file indicated by textName into cover image img, which may be opened for
+// streaming. Rows are read, encoded and written a chunk at a time, so memory
+// use does not depend on image size. Embedding mode, density and payload
+// flags are given by mode, density and flags as in encodeText(). Returns 0
+// on success.
+int streamEncode(const char *textName, BMP img, const char *stegoName,
+                 int mode, int density, int flags)
+{
+    BYTE *openText(const char *fname, BMP img, int flags, size_t *lengthPtr,
+                   int *statusPtr); // Function prototype
+
+    int status = verifyFilename(stegoName, ".bmp", "streamEncode()");
+    if (!status)
+    {
+        status = checkDensity(mode, density, "streamEncode()");
+    }
+    if (!status && (img.key != 0 || mode == MODE_HAMMING))
+    {
+        reportError("%s", "scattered payloads and Hamming blocks need the "
+                          "whole cover image: it cannot be streamed in "
+                          "streamEncode()\n");
+        status = ERR_FORMAT;
+    }
+    if (status)
+    {
+        return status;
+    }
+
+    // Records mode for the header of the stego image and for openText()
+    img.mode = mode;
+    img.density = density;
+    img.scattered = 0;
+
+    size_t charCount; // Number of characters in secret text
+    double start = statClock();
+    BYTE *text = openText(textName, img, flags, &charCount, &status);
+    addTime(&stats.textTime, start);
+    if (text == NULL)
+    {
+        return status;
+    }
+    status = checkHeaderBits(&img, text, "streamEncode()");
+    if (status)
+    {
+        freeMemory(text);
+        return status;
+    }
+    start = statClock(); // Encoding and writing are timed together
+
+    struct embedder emb = {text,      charCount, 0,      0, 0,
+                           UCHAR_MAX, mode,      density, NULL};
+    status = allocChannels(&img, &emb.channels, "streamEncode()");
+    if (status)
+    {
+        freeMemory(text);
+        return status;
+    }
+
+    LONG rows = chunkRows(img);              // Rows in each chunk
+    BYTE *buf = allocMemory((size_t)rows * img.pxRowSize); // Current chunk
+    if (buf == NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for rows in "
+                          "streamEncode()\n");
+        freeMemory(emb.channels);
+        freeMemory(text);
+        return ERR_ALLOC;
+    }
+
+    FILE *imgOut = fopen(stegoName, "wb"); // Opens stego image
+    if (imgOut == NULL)
+    {
+        reportError("fopen() failed: %s could not be created in "
+                    "streamEncode()\n",
+                    stegoName);
+        freeMemory(buf);
+        freeMemory(emb.channels);
+        freeMemory(text);
+        return ERR_OPEN;
+    }
+
+    // Channel bytes still to be modified
+    size_t pxLeft = (charCount * CHAR_BIT + density - 1) / density;
+    int failed = writeHeader(imgOut, img);
+
+    // Keeps each original row only for stats, which count changed pixels
+    BYTE *before = statsEnabled ? allocMemory(img.pxRowSize) : NULL;
+
+    for (LONG first = 0; first < img.height && !failed; first += rows)
+    {
+        LONG count = img.height - first < rows ? img.height - first : rows;
+
+        if (readRows(&img, first, count, buf))
+        {
+            status = ERR_FORMAT;
+            break;
+        }
+
+        // Encodes bits into the channel bytes of each row in chunk
+        for (LONG row = 0; row < count && pxLeft > 0; row++)
+        {
+            LONG pxCount = pxLeft < (size_t)img.rowChannels
+                               ? (LONG)pxLeft
+                               : img.rowChannels;
+            BYTE *rowPtr = buf + (size_t)row * img.pxRowSize;
+            if (before != NULL)
+            {
+                memcpy(before, rowPtr, img.pxRowSize);
+            }
+
+            embedChannels(&emb, &img, rowPtr, pxCount);
+            pxLeft -= pxCount;
+
+            addCount(&stats.rowsDirtied, 1);
+            if (before != NULL)
+            {
+                addCount(&stats.pixelsModified,
+                         changedPixels(before, rowPtr, img.width,
+                                       img.pxSize));
+            }
+        }
+
+        size_t size = (size_t)count * img.pxRowSize;
+        failed = fwrite(buf, sizeof(*buf), size, imgOut) != size;
+        addCount(&stats.bytesWritten, size);
+    }
+
+    freeMemory(before);
+    freeMemory(buf);
+    freeMemory(emb.channels);
+    freeMemory(text);
+
+    // Reports failure of any read or write
+    failed |= fclose(imgOut) != 0;
+    addTime(&stats.encodeTime, start);
+    if (failed || status)
+    {
+        reportError("%s could not be created from cover image in "
+                    "streamEncode()\n",
+                    stegoName);
+        return status ? status : ERR_WRITE;
+    }
+
+    return 0; // Stego image is successfully created
+}
+
+// Stores the payload header pay into the PAYLOAD_HEADER_SIZE bytes of out:
+// magic, version, flags, shard sequence and total, both 0 if the payload is
+// not sharded, and the little-endian length of the secret text. If flags has
+// PAYLOAD_CHECKSUM, also stores the little-endian checksum into the
+// PAYLOAD_TRAILER_SIZE bytes after the length bytes of text that follow the
+// header. Returns none.
+static void packPayload(BYTE *out, PAYLOAD pay)
+{
+    memset(out, 0, PAYLOAD_HEADER_SIZE);
+    memcpy(out, PAYLOAD_MAGIC, 4);
+    out[4] = pay.version;
+    out[5] = pay.flags;
+    out[6] = pay.sequence;
+    out[7] = pay.total;
+
+    for (int i = 0; i < 8; i++)
+    {
+        out[8 + i] = (BYTE)(pay.length >> (i * CHAR_BIT));
+    }
+
+    if (pay.flags & PAYLOAD_CHECKSUM)
+    {
+        BYTE *trailer = out + PAYLOAD_HEADER_SIZE + pay.length;
+        for (int i = 0; i < PAYLOAD_TRAILER_SIZE; i++)
+        {
+            trailer[i] = (BYTE)(pay.checksum >> (i * CHAR_BIT));
+        }
+    }
+}
+
+// Reads whole content of the file opened as fd into allocated memory after
+// reserve bytes left for the caller, using its size from fstat() to read
+// regular files in one call. Stores number of bytes read in the integer
+// pointed to by lengthPtr. Returns pointer to the memory, or NULL on failure.
+static BYTE *readFile(int fd, size_t reserve, size_t *lengthPtr)
+{
+    struct stat info;
+    size_t capacity = BUFSIZ; // Size of buffer; grows for pipes
+
+    if (!fstat(fd, &info) && S_ISREG(info.st_mode))
+    {
+        capacity = info.st_size + 1; // Extra byte detects a growing file
+    }
+    capacity += reserve;
+
+    BYTE *content = allocMemory(capacity);
+    size_t length = reserve;
+
+    while (content != NULL)
+    {
+        ssize_t got = read(fd, content + length, capacity - length);
+        if (got < 0)
+        {
+            break;
+        }
+        if (got == 0) // End of file
+        {
+            *lengthPtr = length - reserve;
+            return content;
+        }
+
+        length += got;
+        addCount(&stats.bytesRead, got);
+        if (length == capacity) // Doubles buffer of a pipe or growing file
+        {
+            BYTE *bigger = resizeMemory(content, capacity * 2);
+            if (bigger == NULL)
+            {
+                break;
+            }
+            content = bigger;
+            capacity *= 2;
+        }
+    }
+
+    freeMemory(content);
+    return NULL;
+}
+
+// Reads secret text indicated by fname into memory in a single pass after
+// PAYLOAD_HEADER_SIZE bytes of room, then checks that it is ASCII, on behalf
+// of function caller. Stores number of characters in the integer pointed to
+// by countPtr. Returns pointer to the memory, which the caller must free, or
+// NULL after storing the error code in the integer pointed to by statusPtr.
+static BYTE *readText(const char *fname, size_t *countPtr, int *statusPtr,
+                      const char *caller)
+{
+    *statusPtr = verifyFilename(fname, ".txt", caller);
+    if (*statusPtr)
+    {
+        return NULL;
+    }
+
+    FILE *filePtr = fopen(fname, "rb"); // Open input file
+
+    // Stops if opening file failed
+    if (filePtr == NULL)
+    {
+        reportError("error opening secret text %s in %s\n", fname, caller);
+        *statusPtr = ERR_OPEN;
+        return NULL;
+    }
+
+    size_t charCount; // Character counter
+    BYTE *payload = readFile(fileno(filePtr), PAYLOAD_HEADER_SIZE, &charCount);
+    fclose(filePtr);
+
+    if (payload == NULL)
+    {
+        reportError("error reading secret text %s in %s\n", fname, caller);
+        *statusPtr = ERR_ALLOC;
+        return NULL;
+    }
+
+    // Rejects text containing non-ASCII character
+    if (!isAscii(payload + PAYLOAD_HEADER_SIZE, charCount))
+    {
+        reportError("file error: %s contains non-ASCII character\n", fname);
+        freeMemory(payload);
+        *statusPtr = ERR_FORMAT;
+        return NULL;
+    }
+
+    *countPtr = charCount;
+    return payload;
+}
+
+// Reads secret text indicated by fname into memory in a single pass, then
+// checks that it is ASCII and prepares it with packText() before any pixel
+// is modified. Stores number of bytes to be encoded in the integer pointed
+// to by lengthPtr. Returns pointer to the payload header followed by the
+// encoded text, which the caller must free, or NULL after storing the error
+// code in the integer pointed to by statusPtr.
+BYTE *openText(const char *fname, BMP img, int flags, size_t *lengthPtr,
+               int *statusPtr)
+{
+    BYTE *packText(BYTE *payload, size_t charCount, BMP img, int flags,
+                   const char *fname, size_t *lengthPtr,
+                   int *statusPtr); // Function prototype
+
+    size_t charCount; // Character counter
+    BYTE *payload = readText(fname, &charCount, statusPtr, "openText()");
+    if (payload == NULL)
+    {
+        return NULL;
+    }
+
+    return packText(payload, charCount, img, flags, fname, lengthPtr,
+                    statusPtr);
+}
+
+// Compresses the charCount characters of secret text fname held after
+// PAYLOAD_HEADER_SIZE bytes of room in payload if flags has
+// PAYLOAD_COMPRESSED, keeping the raw text if compression does not make it
+// smaller. Stores the payload header of the result in the structure pointed
+// to by payPtr. Returns pointer to the payload, which may have moved, or NULL
+// after releasing payload and storing the error code in the integer pointed
+// to by statusPtr.
+static BYTE *compressText(BYTE *payload, size_t charCount, int flags,
+                          const char *fname, PAYLOAD *payPtr, int *statusPtr)
+{
+    PAYLOAD pay = {PAYLOAD_VERSION, 0, charCount, 0, 0, 0};
+    *payPtr = pay;
+    *statusPtr = 0;
+    if (!(flags & PAYLOAD_COMPRESSED))
+    {
+        return payload;
+    }
+
+    BYTE *packed;       // Payload header followed by compressed text
+    size_t packedCount; // Number of bytes of compressed text
+    if (compressBytes(payload + PAYLOAD_HEADER_SIZE, charCount,
+                      PAYLOAD_HEADER_SIZE, &packed, &packedCount))
+    {
+        reportError("malloc() failed: no memory for compressing %s in "
+                    "compressText()\n",
+                    fname);
+        freeMemory(payload);
+        *statusPtr = ERR_ALLOC;
+        return NULL;
+    }
+
+    trackAlloc(packed); // Allocated by compressBytes()
+    if (packedCount >= charCount)
+    {
+        freeMemory(packed);
+        return payload;
+    }
+
+    freeMemory(payload);
+    payPtr->flags = PAYLOAD_COMPRESSED;
+    payPtr->length = packedCount;
+    return packed;
+}
+
+// Prepares the charCount characters of secret text fname held after
+// PAYLOAD_HEADER_SIZE bytes of room in payload, checking that they fit in
+// cover image img together with their payload header and trailer. If flags
+// has PAYLOAD_COMPRESSED, the text is compressed unless that would not
+// shrink it. The CRC32C of the encoded text is stored in the trailer while
+// the text is still in cache. Stores number of bytes to be encoded in the
+// integer pointed to by lengthPtr. Returns pointer to the payload header
+// followed by the encoded text and its trailer, which the caller must free,
+// or NULL after releasing payload and storing the error code in the integer
+// pointed to by statusPtr.
+BYTE *packText(BYTE *payload, size_t charCount, BMP img, int flags,
+               const char *fname, size_t *lengthPtr, int *statusPtr)
+{
+    // Compresses secret text after its header, keeping the raw text if
+    // compression does not make it smaller
+    PAYLOAD pay;
+    payload = compressText(payload, charCount, flags, fname, &pay, statusPtr);
+    if (payload == NULL)
+    {
+        return NULL;
+    }
+    charCount = pay.length;
+
+    // Computes number of channel bytes needed to represent a binary digit
+    // of each 8-bit (1 byte) character in payload header, secret text and
+    // trailer, storing density bits in each byte or in each Hamming block
+    size_t pxNeed = payloadChannels(img.mode, img.density,
+                                    PAYLOAD_HEADER_SIZE + charCount +
+                                        PAYLOAD_TRAILER_SIZE);
+
+    // Computes total number of channel bytes that store bits
+    size_t pxTotal = (size_t)img.rowChannels * img.height;
+
+    // Rejects secret text that cannot fit in cover image
+    if (pxNeed > pxTotal)
+    {
+        reportError("secret text %s has too many characters\n"
+                    "%zu color channels are needed but cover image only has "
+                    "%zu.\n",
+                    fname, pxNeed, pxTotal);
+        freeMemory(payload);
+        *statusPtr = ERR_CAPACITY;
+        return NULL;
+    }
+
+    // Makes room for the trailer after the text
+    BYTE *bigger = resizeMemory(payload, PAYLOAD_HEADER_SIZE + charCount +
+                                             PAYLOAD_TRAILER_SIZE);
+    if (bigger == NULL)
+    {
+        reportError("realloc() failed: no memory for checksum of %s in "
+                    "packText()\n",
+                    fname);
+        freeMemory(payload);
+        *statusPtr = ERR_ALLOC;
+        return NULL;
+    }
+    payload = bigger;
+
+    pay.flags |= PAYLOAD_CHECKSUM;
+    pay.checksum = crc32c(0, payload + PAYLOAD_HEADER_SIZE, charCount);
+    packPayload(payload, pay);
+
+    *statusPtr = 0;
+    *lengthPtr = PAYLOAD_HEADER_SIZE + charCount + PAYLOAD_TRAILER_SIZE;
+    return payload;
+}
+
+struct sink            // Structure representing destination of decoded text
+{
+    FILE *filePtr;     // File for decoded text, or NULL to store it in data
+    BYTE *data;        // Memory for decoded text
+    size_t capacity;   // Number of bytes data can hold
+    size_t length;     // Number of bytes of decoded text, stored or not
+    int growable;      // Nonzero if data is reallocated when full
+    int failed;        // Nonzero if text could not be written or stored
+    unsigned int crc;  // CRC32C of the decoded payload bytes put so far
+};
+
+// Writes count decoded characters chars into the sink pointed to by sinkPtr.
+// Characters that do not fit in fixed memory are counted but not stored.
+// Returns none.
+static void putText(struct sink *sinkPtr, const BYTE *chars, size_t count)
+{
+    if (sinkPtr->filePtr != NULL)
+    {
+        if (fwrite(chars, sizeof(*chars), count, sinkPtr->filePtr) != count)
+        {
+            sinkPtr->failed = 1;
+        }
+        addCount(&stats.bytesWritten, count);
+        sinkPtr->length += count;
+        return;
+    }
+
+    // Doubles growable memory until the characters fit
+    size_t need = sinkPtr->length + count;
+    if (need > sinkPtr->capacity && sinkPtr->growable && !sinkPtr->failed)
+    {
+        size_t capacity = sinkPtr->capacity ? sinkPtr->capacity : BUFSIZ;
+        while (capacity < need)
+        {
+            capacity *= 2;
+        }
+
+        BYTE *bigger = resizeMemory(sinkPtr->data, capacity);
+        if (bigger == NULL)
+        {
+            sinkPtr->failed = 1;
+        }
+        else
+        {
+            sinkPtr->data = bigger;
+            sinkPtr->capacity = capacity;
+        }
+    }
+
+    if (need <= sinkPtr->capacity)
+    {
+        memcpy(sinkPtr->data + sinkPtr->length, chars, count);
+    }
+    sinkPtr->length = need;
+}
+
+// Writes count decoded bytes of payload chars into the sink pointed to by
+// sinkPtr as putText() does, adding them to its checksum while they are in
+// cache. Returns none.
+static void putPayload(struct sink *sinkPtr, const BYTE *chars, size_t count)
+{
+    sinkPtr->crc = crc32c(sinkPtr->crc, chars, count);
+    putText(sinkPtr, chars, count);
+}
+
+struct extractor            // Structure representing progress of decoding text
+{
+    struct sink *sinkPtr;   // Destination of decoded text
+    int untilEnd;           // Nonzero if text ends at a null or non-ASCII byte
+    int density;            // Bits decoded from each channel byte
+    size_t skip;            // Decoded characters of payload header to drop
+    size_t decodedBit;      // Counter for decoded bits held in character
+    unsigned int character; // Decoded bits not yet stored as a character
+    size_t length;          // Number of decoded characters in buf
+    BYTE buf[BUFSIZ];       // Decoded characters not yet written
+};
+
+// Writes the decoded characters buffered in the extractor pointed to by extPtr
+// into its sink, dropping those of the payload header. Returns none.
+static void flushText(struct extractor *extPtr)
+{
+    size_t drop = extPtr->skip < extPtr->length ? extPtr->skip
+                                                : extPtr->length;
+    putPayload(extPtr->sinkPtr, extPtr->buf + drop, extPtr->length - drop);
+    extPtr->skip -= drop;
+    extPtr->length = 0;
+}
+
+// Decodes the bits stored in the first count pixels of cover row covRow and
+// stego row stegRow into the decoded text of the extractor pointed to by
+// extPtr. If covRow is NULL, density bits are read from the least significant
+// bits of each stego pixel instead. Whole characters are packed by a
+// vectorized kernel; bits split across rows are decoded one pixel at a time.
+// Returns 1 once a null or non-ASCII character is decoded by an extractor
+// looking for the end of text, 0 otherwise.
+static int extractRow(struct extractor *extPtr, const BYTE *covRow,
+                      const BYTE *stegRow, LONG count)
+{
+    LONG px = 0; // Index of current pixel in row
+    int density = extPtr->density;
+
+    // Loop through each pixel of the row
+    while (px < count)
+    {
+        // Packs groups of density characters, which fill 8 pixels, once a
+        // character boundary is reached
+        size_t space = (sizeof(extPtr->buf) - extPtr->length) / density;
+        size_t groups = (count - px) / CHAR_BIT;
+        if (groups > space)
+        {
+            groups = space;
+        }
+        if (extPtr->decodedBit == 0 && groups > 0)
+        {
+            size_t chars = groups * density;
+            size_t packed = chars;
+            if (covRow == NULL)
+            {
+                packLsbGroups(stegRow + px, groups,
+                              extPtr->buf + extPtr->length, density);
+            }
+            else if (extPtr->untilEnd)
+            {
+                packed = packDiffBits(covRow + px, stegRow + px, chars,
+                                      extPtr->buf + extPtr->length);
+            }
+            else
+            {
+                packDiffBytes(covRow + px, stegRow + px, chars,
+                              extPtr->buf + extPtr->length);
+            }
+            extPtr->length += packed;
+            if (extPtr->length + density > sizeof(extPtr->buf))
+            {
+                flushText(extPtr);
+            }
+            if (packed < chars) // Kernel stopped at end of secret text
+            {
+                return 1;
+            }
+
+            px += groups * CHAR_BIT;
+            continue;
+        }
+
+        // Positive difference of corresponding pixels stores a bit value of
+        // 1; blind pixels store density bits in their least significant bits
+        int bits = covRow == NULL ? stegRow[px] & ((1u << density) - 1)
+                                  : stegRow[px] > covRow[px];
+        extPtr->character = (extPtr->character << density) | bits;
+        extPtr->decodedBit += density; // Increments number of decoded bits
+        px++;
+
+        // Checks if current character is fully decoded
+        if (extPtr->decodedBit >= CHAR_BIT)
+        {
+            extPtr->decodedBit -= CHAR_BIT;
+            BYTE character = extPtr->character >> extPtr->decodedBit;
+            extPtr->character &= (1u << extPtr->decodedBit) - 1;
+
+            // Skips decoding null or non-ASCII character
+            if (extPtr->untilEnd &&
+                (character <= ASCII_MIN || character > ASCII_MAX))
+            {
+                return 1;
+            }
+
+            // Stores character for the decoded text file
+            extPtr->buf[extPtr->length++] = character;
+            if (extPtr->length + density > sizeof(extPtr->buf))
+            {
+                flushText(extPtr);
+            }
+        }
+    }
+
+    return 0;
+}
+
+struct reader               // Structure representing rows read from an image
+{
+    const BMP *imgPtr;      // Image read, or NULL if it is not read
+    BYTE *rows;             // Chunk of rows of a streamed image, or NULL
+    BYTE *channels;         // Color channels of a 32-bit row, or NULL
+};
+
+// Prepares the reader pointed to by readPtr for the image pointed to by
+// imgPtr, which may be NULL, allocating a buffer of count rows if the image is
+// streamed and a buffer of channels if it has 32-bit pixels. Returns 0 on
+// success.
+static int openReader(struct reader *readPtr, const BMP *imgPtr, LONG count)
+{
+    readPtr->imgPtr = imgPtr;
+    readPtr->rows = NULL;
+    readPtr->channels = NULL;
+    if (imgPtr == NULL)
+    {
+        return 0;
+    }
+
+    if (imgPtr->pxArr == NULL &&
+        (readPtr->rows = allocMemory((size_t)count * imgPtr->pxRowSize)) ==
+            NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for rows in "
+                          "decodeText()\n");
+        return ERR_ALLOC;
+    }
+
+    return allocChannels(imgPtr, &readPtr->channels, "decodeText()");
+}
+
+// Releases the buffers of the reader pointed to by readPtr. Returns none.
+static void closeReader(struct reader *readPtr)
+{
+    freeMemory(readPtr->rows);
+    freeMemory(readPtr->channels);
+}
+
+// Returns pointer to count rows of the image of the reader pointed to by
+// readPtr starting at row first, or NULL if they could not be read or the
+// reader has no image.
+static const BYTE *readerRows(struct reader *readPtr, LONG first, LONG count)
+{
+    if (readPtr->imgPtr == NULL)
+    {
+        return NULL;
+    }
+
+    return fetchRows(readPtr->imgPtr, first, count, readPtr->rows);
+}
+
+// Returns pointer to the channel bytes of row rowPtr of the image of the
+// reader pointed to by readPtr. Rows of 8-bit and 24-bit images are used in
+// place; color channels of 32-bit rows are gathered without alpha. Returns
+// NULL if rowPtr is NULL.
+static const BYTE *readerChannels(struct reader *readPtr, const BYTE *rowPtr)
+{
+    if (rowPtr == NULL || readPtr->imgPtr->pxSize != 4)
+    {
+        return rowPtr;
+    }
+
+    gatherChannels(rowPtr, readPtr->imgPtr->width, readPtr->channels);
+    return readPtr->channels;
+}
+
+// Gathers into covPx and stegPx the count channel bytes, at most
+// SCATTER_BLOCK, of the images of readers cov and steg that hold payload
+// from channel byte first: consecutive bytes of the pixel array if scatPtr
+// is NULL, or else the destinations of the entries of the permutation
+// pointed to by scatPtr. Destinations are sorted into pairs, which must then
+// hold 2 * count elements, so each row is read once. covPx is not used if
+// the cover reader has no image. Returns 0 on success.
+static int gatherReaders(struct reader *covPtr, struct reader *stegPtr,
+                         const SCATTER *scatPtr, size_t first, size_t count,
+                         unsigned long long *pairs, BYTE *covPx, BYTE *stegPx)
+{
+    const BMP *imgPtr = stegPtr->imgPtr;
+    LONG width = imgPtr->rowChannels;
+    int blind = covPtr->imgPtr == NULL;
+    const BYTE *covRow = NULL;
+    const BYTE *stegRow = NULL;
+    LONG lastRow = -1; // Row read last
+
+    if (scatPtr != NULL)
+    {
+        scatterBlock(scatPtr, first, count, pairs);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t dest = first + i;
+        size_t slot = i;
+        if (scatPtr != NULL)
+        {
+            dest = pairs[i] >> SCATTER_SLOT_BITS;
+            slot = pairs[i] & (SCATTER_BLOCK - 1);
+        }
+
+        LONG row = dest / width;
+        if (row != lastRow)
+        {
+            covRow = readerRows(covPtr, row, 1);
+            stegRow = readerRows(stegPtr, row, 1);
+            if ((!blind && covRow == NULL) || stegRow == NULL)
+            {
+                return ERR_FORMAT;
+            }
+            lastRow = row;
+        }
+
+        size_t offset = channelOffset(imgPtr, dest % width);
+        if (!blind)
+        {
+            covPx[slot] = covRow[offset];
+        }
+        stegPx[slot] = stegRow[offset];
+    }
+
+    return 0;
+}
+
+// Reads count bytes of payload, at most PAYLOAD_HEADER_SIZE, from payload
+// byte offset into out, decoding them from the channel bytes of the images of
+// readers cov and steg as readPayload() does. Only the whole groups of
+// channel bytes holding them are gathered, through the permutation pointed to
+// by scatPtr if the payload is scattered; channel bytes past the end of the
+// pixel array are read as 0. Returns 0 on success.
+static int readBytes(struct reader *covPtr, struct reader *stegPtr,
+                     const SCATTER *scatPtr, size_t offset, size_t count,
+                     BYTE *out)
+{
+    const BMP *imgPtr = stegPtr->imgPtr;
+    BYTE covPx[SCATTER_BLOCK];  // Cover bytes of the groups read
+    BYTE stegPx[SCATTER_BLOCK]; // Stego bytes of the groups read
+    BYTE bytes[PAYLOAD_HEADER_SIZE + 2 * HAMMING_MAX]; // Bytes of the groups
+    int blind = covPtr->imgPtr == NULL;
+    int hamming = blind && imgPtr->mode == MODE_HAMMING;
+    int density = blind ? imgPtr->density : 1;
+
+    // Finds the groups of density bytes holding the requested bytes, which
+    // fill 8 channel bytes each, or 8 Hamming blocks
+    size_t groupPx = CHAR_BIT * (hamming ? HAMMING_PIXELS(density) : 1);
+    size_t firstGroup = offset / density;
+    size_t groups = (offset + count + density - 1) / density - firstGroup;
+    size_t first = firstGroup * groupPx;
+    size_t pxNeed = groups * groupPx;
+    size_t pxTotal = (size_t)imgPtr->rowChannels * imgPtr->height;
+    size_t pxRead = first >= pxTotal        ? 0
+                    : pxTotal - first < pxNeed ? pxTotal - first
+                                               : pxNeed;
+
+    memset(covPx, 0, pxNeed);
+    memset(stegPx, 0, pxNeed);
+    unsigned long long *pairs =
+        imgPtr->scattered ? allocMemory(2 * pxRead * sizeof(*pairs)) : NULL;
+    if (imgPtr->scattered && pairs == NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for payload header "
+                          "in decodeText()\n");
+        return ERR_ALLOC;
+    }
+    int status = gatherReaders(covPtr, stegPtr,
+                               imgPtr->scattered ? scatPtr : NULL, first,
+                               pxRead, pairs, covPx, stegPx);
+    freeMemory(pairs);
+    if (status)
+    {
+        return status;
+    }
+
+    if (hamming)
+    {
+        packHammingGroups(stegPx, groups, bytes, density);
+    }
+    else if (blind)
+    {
+        packLsbGroups(stegPx, groups, bytes, density);
+    }
+    else
+    {
+        packDiffBytes(covPx, stegPx, groups, bytes);
+    }
+    memcpy(out, bytes + offset - firstGroup * density, count);
+
+    return 0;
+}
+
+// Reads the payload header encoded in the first channel bytes of the images
+// of readers cov and steg into the structure pointed to by payPtr, reading
+// only the rows that hold it, then its checksum from the trailer after the
+// secret text. If the cover reader has no image, the header is read from the
+// least significant bits of the stego image at its density. Headers of
+// scattered payloads are gathered through the permutation pointed to by
+// scatPtr. Sets its version to 0 if the stego image has no payload header,
+// as with stego images created before headers were added. Returns 0 on
+// success.
+static int readPayload(struct reader *covPtr, struct reader *stegPtr,
+                       const SCATTER *scatPtr, PAYLOAD *payPtr)
+{
+    const BMP *imgPtr = stegPtr->imgPtr;
+    BYTE header[PAYLOAD_HEADER_SIZE];
+    int blind = covPtr->imgPtr == NULL;
+    int hamming = blind && imgPtr->mode == MODE_HAMMING;
+    int density = blind ? imgPtr->density : 1;
+
+    // Reads whole groups of density characters, which fill 8 bytes each, or
+    // 8 Hamming blocks
+    size_t groups = (PAYLOAD_HEADER_SIZE + density - 1) / density;
+    const size_t pxNeed = groups * CHAR_BIT *
+                          (hamming ? HAMMING_PIXELS(density) : 1);
+
+    memset(payPtr, 0, sizeof(*payPtr));
+    size_t pxTotal = (size_t)imgPtr->rowChannels * imgPtr->height;
+    if (pxTotal < pxNeed)
+    {
+        return 0; // Image is too small to hold a header
+    }
+
+    int status = readBytes(covPtr, stegPtr, scatPtr, 0, PAYLOAD_HEADER_SIZE,
+                           header);
+    if (status)
+    {
+        return status;
+    }
+    if (memcmp(header, PAYLOAD_MAGIC, 4))
+    {
+        return 0; // Secret text was encoded without a header
+    }
+
+    payPtr->version = header[4];
+    payPtr->flags = header[5];
+    if (payPtr->flags & PAYLOAD_SHARDED)
+    {
+        payPtr->sequence = header[6];
+        payPtr->total = header[7];
+    }
+    for (int i = 7; i >= 0; i--)
+    {
+        payPtr->length = (payPtr->length << CHAR_BIT) | header[8 + i];
+    }
+
+    // Rejects headers of a newer format, with unknown flags, with a shard
+    // outside its total or claiming more bytes than exist
+    size_t room = payloadCapacity(blind ? imgPtr->mode : MODE_DIFF, density,
+                                  pxTotal) -
+                  PAYLOAD_HEADER_SIZE; // Bytes after the header
+    size_t trailer = payPtr->flags & PAYLOAD_CHECKSUM ? PAYLOAD_TRAILER_SIZE
+                                                      : 0;
+    if (payPtr->version > PAYLOAD_VERSION ||
+        (payPtr->flags & ~PAYLOAD_FLAGS) ||
+        ((payPtr->flags & PAYLOAD_SHARDED) &&
+         payPtr->sequence >= payPtr->total) ||
+        payPtr->length > room || room - payPtr->length < trailer)
+    {
+        reportError("%s", "unsupported or damaged payload header in "
+                          "decodeText()\n");
+        return ERR_FORMAT;
+    }
+
+    // Reads the checksum stored after the secret text
+    if (trailer)
+    {
+        BYTE bytes[PAYLOAD_TRAILER_SIZE];
+        status = readBytes(covPtr, stegPtr, scatPtr,
+                           PAYLOAD_HEADER_SIZE + payPtr->length,
+                           PAYLOAD_TRAILER_SIZE, bytes);
+        for (int i = PAYLOAD_TRAILER_SIZE - 1; i >= 0 && !status; i--)
+        {
+            payPtr->checksum = (payPtr->checksum << CHAR_BIT) | bytes[i];
+        }
+    }
+
+    return status;
+}
+
+struct extractBand        // Structure representing rows decoded by a thread
+{
+    struct band band;     // Rows of band, first for runBands()
+    const BMP *covPtr;    // Cover image, or NULL to decode blind
+    const BMP *stegPtr;   // Stego image
+    int density;          // Bits decoded from each channel byte
+    int untilEnd;         // Nonzero if text ends at a null or non-ASCII byte
+    size_t skip;          // Characters of payload header to drop
+    struct sink *sinkPtr; // Destination of the band's decoded text
+    struct sink sink;     // Band's slice of shared memory for decoded text
+};
+
+// Decodes the rows of the extract band pointed to by arg into its sink,
+// reading them a chunk at a time if its images are opened for streaming.
+// Returns NULL.
+static void *extractBand(void *arg)
+{
+    struct extractBand *bandPtr = arg;
+    const BMP *covPtr = bandPtr->covPtr;
+    const BMP *stegPtr = bandPtr->stegPtr;
+
+    // Allocates chunk buffers only for images opened for streaming
+    LONG rows = chunkRows(*stegPtr);
+    struct reader cov, steg;
+    int status = openReader(&cov, covPtr, rows);
+    if (!status)
+    {
+        status = openReader(&steg, stegPtr, rows);
+        if (status)
+        {
+            closeReader(&steg);
+        }
+    }
+    if (status)
+    {
+        closeReader(&cov);
+        bandPtr->band.status = status;
+        bandPtr->band.stats = getStats();
+        return NULL;
+    }
+
+    struct extractor ext = {bandPtr->sinkPtr, bandPtr->untilEnd,
+                            bandPtr->density, bandPtr->skip,
+                            0, 0, 0, {0}};
+    LONG width = stegPtr->rowChannels;
+    LONG lastRow = bandPtr->band.last;
+    size_t pxLeft = bandPtr->band.pxLeft; // Channel bytes not yet decoded
+    int done = 0; // Nonzero once the end of secret text is decoded
+
+    // Loop through each chunk of rows holding secret text
+    for (LONG first = bandPtr->band.first; first < lastRow && !done;
+         first += rows)
+    {
+        LONG count = lastRow - first < rows ? lastRow - first : rows;
+        const BYTE *covRows = readerRows(&cov, first, count);
+        const BYTE *stegRows = readerRows(&steg, first, count);
+        if ((covPtr != NULL && covRows == NULL) || stegRows == NULL)
+        {
+            status = ERR_FORMAT;
+            break;
+        }
+
+        // Decodes the channel bytes of each row, skipping padding
+        for (LONG row = 0; row < count && !done && pxLeft > 0; row++)
+        {
+            size_t offset = (size_t)row * stegPtr->pxRowSize;
+            const BYTE *covRow =
+                readerChannels(&cov, covRows ? covRows + offset : NULL);
+            const BYTE *stegRow = readerChannels(&steg, stegRows + offset);
+            size_t pxCount = (size_t)width < pxLeft ? (size_t)width : pxLeft;
+
+            done = extractRow(&ext, covRow, stegRow, pxCount);
+            pxLeft -= pxCount;
+        }
     }
 
-    // Initializes the index of last pixel in first row of pixel array
-    size_t lastPx = stegImg.width - 1;
+    closeReader(&cov);
+    closeReader(&steg);
+    flushText(&ext);
 
-    size_t decodedBit = 0; // Counter for decoded bit of 8-bit character
-    char character = 0;    // ASCII decimal value of decoded character
+    bandPtr->band.status = status;
+    bandPtr->band.stats = getStats();
 
-    int diff; // Difference of corresponding pixels in cover and stego image
-    int bit;  // Bit secretly stored in a pixel
+    return NULL;
+}
 
-    // Loop through each pixel of cover and stego image
-    for (size_t px = 0; px < stegImg.pxArrSize; px++)
+// Decodes the first pxTotal channel bytes in payload order of the images of
+// readers cov and steg, which follow the permutation pointed to by scatPtr
+// unless it is NULL, into the sink pointed to by sinkPtr, density bits from
+// each byte or Hamming block, dropping the payload header and any padding
+// after its length bytes of secret text. Each block of channel bytes is
+// gathered and decoded as one row on the calling thread. Returns 0 on
+// success.
+static int extractGathered(struct reader *covPtr, struct reader *stegPtr,
+                           const SCATTER *scatPtr, size_t pxTotal,
+                           int density, size_t length, struct sink *sinkPtr)
+{
+    struct extractor ext = {sinkPtr, 0, density, PAYLOAD_HEADER_SIZE,
+                            0,       0, 0,       {0}};
+    int hamming = covPtr->imgPtr == NULL &&
+                  stegPtr->imgPtr->mode == MODE_HAMMING;
+    size_t charsLeft = PAYLOAD_HEADER_SIZE + length; // Payload not yet put
+    unsigned long long *pairs =
+        scatPtr != NULL ? allocMemory(2 * SCATTER_BLOCK * sizeof(*pairs))
+                        : NULL;
+    BYTE *covPx = allocMemory(SCATTER_BLOCK);  // Gathered cover bytes
+    BYTE *stegPx = allocMemory(SCATTER_BLOCK); // Gathered stego bytes
+    int status = 0;
+    if ((scatPtr != NULL && pairs == NULL) || covPx == NULL || stegPx == NULL)
     {
-        // Computes difference of corresponding pixels
-        diff = stegImg.pxArr[px] - covImg.pxArr[px];
+        reportError("%s", "malloc() failed: no memory for gathered bytes "
+                          "in decodeText()\n");
+        status = ERR_ALLOC;
+    }
 
-        // Determines the bit represented by the difference
-        if (diff >= 1) // Positive difference
+    size_t size = gatherSize(stegPtr->imgPtr);
+    for (size_t first = 0; !status && first < pxTotal; first += size)
+    {
+        size_t count = pxTotal - first < size ? pxTotal - first : size;
+        status = gatherReaders(covPtr, stegPtr, scatPtr, first, count, pairs,
+                               covPx, stegPx);
+        if (status)
         {
-            bit = 1; // Current pixel stores a bit value of 1
+            break;
         }
-        else if (diff <= 0) // Positive or zero difference
+        if (!hamming)
         {
-            bit = 0; // Current pixel stores a bit value of 0
+            extractRow(&ext, covPtr->imgPtr != NULL ? covPx : NULL, stegPx,
+                       count);
+            continue;
         }
 
-        // Computes the ASCII value of the current character
-        character += (char)pow(2, 8 - (decodedBit + 1)) * bit;
+        // Packs Hamming blocks into the cover buffer, which is unused blind
+        size_t groups = count / (CHAR_BIT * HAMMING_PIXELS(density));
+        size_t chars = groups * density;
+        packHammingGroups(stegPx, groups, covPx, density);
+        chars = chars < charsLeft ? chars : charsLeft;
+        charsLeft -= chars;
 
-        decodedBit++; // Increments number of decoded bit for current character
+        size_t drop = ext.skip < chars ? ext.skip : chars;
+        putPayload(sinkPtr, covPx + drop, chars - drop);
+        ext.skip -= drop;
+    }
+    flushText(&ext);
 
-        // Checks if current character is fully decoded
-        if ((decodedBit != 0) && (decodedBit % CHAR_BIT == 0))
+    freeMemory(pairs);
+    freeMemory(covPx);
+    freeMemory(stegPx);
+
+    return status;
+}
+
+// Writes the secret text into the sink pointed to by sinkPtr. Secret text
+// is decoded from stego image *stegPtr and cover image *covPtr, or from the
+// least significant bits of the stego image alone if covPtr is NULL. Either
+// image may be opened for streaming, in which case only the rows holding the
+// payload header and secret text are read. Payloads of known length are
+// split into row bands decoded on parallel threads into shared memory at
+// the offset of the first character of each band; payloads scattered by the
+// key of the stego image are decoded on the calling thread. The checksum of
+// the decoded bytes is summed as they are put, then compared with the trailer
+// before compressed text, which is decoded into memory, is decompressed into
+// the sink, which must be empty. A shard of sharded text is only decoded if
+// shardPtr is not NULL, in which case its bytes are put into the sink as they
+// are and its payload header is stored in the structure pointed to by
+// shardPtr. Returns 0 on success.
+static int extractPayload(const BMP *covPtr, const BMP *stegPtr,
+                          struct sink *sinkPtr, PAYLOAD *shardPtr)
+{
+    // Scattered payloads can only be found with the key that scattered them
+    SCATTER scat;
+    if (stegPtr->scattered)
+    {
+        if (stegPtr->key == 0)
         {
-            // Skips decoding null or non-ASCII character
-            if (character <= ASCII_MIN || character > ASCII_MAX)
+            reportError("%s", "stego image is scattered: its key is needed "
+                              "in decodeText()\n");
+            return ERR_FORMAT;
+        }
+        openScatter(&scat, stegPtr->key,
+                    (size_t)stegPtr->rowChannels * stegPtr->height);
+    }
+
+    // Allocates chunk buffers only for images opened for streaming
+    LONG rows = chunkRows(*stegPtr);
+    struct reader cov, steg;
+    int status = openReader(&cov, covPtr, rows);
+    if (!status)
+    {
+        status = openReader(&steg, stegPtr, rows);
+        if (status)
+        {
+            closeReader(&steg);
+        }
+    }
+    if (status)
+    {
+        closeReader(&cov);
+        return status;
+    }
+
+    PAYLOAD pay; // Payload header, or version 0 if there is none
+    int marked = !memcmp(&stegPtr->header[STEGO_MARK_OFFSET], STEGO_MARK, 2);
+    status = readPayload(&cov, &steg, &scat, &pay);
+    if (status || ((covPtr == NULL || marked) && pay.version == 0))
+    {
+        // Blind mode and marked stego images always encode a payload header,
+        // which a wrong key or cover image garbles
+        if (!status && stegPtr->scattered)
+        {
+            reportError("%s", "no payload header found in scattered stego "
+                              "image: wrong key in decodeText()\n");
+        }
+        else if (!status)
+        {
+            reportError("%s", "no payload header found in stego image in "
+                              "decodeText()\n");
+        }
+        closeReader(&cov);
+        closeReader(&steg);
+        return status ? status : ERR_FORMAT;
+    }
+
+    // Shards are only meaningful when reassembled with the other shards
+    if ((pay.flags & PAYLOAD_SHARDED) && shardPtr == NULL)
+    {
+        reportError("stego image holds shard %d of %d of its secret text: "
+                    "decode it together with the others in decodeText()\n",
+                    pay.sequence + 1, pay.total);
+        closeReader(&cov);
+        closeReader(&steg);
+        return ERR_FORMAT;
+    }
+    if (shardPtr != NULL)
+    {
+        *shardPtr = pay;
+    }
+
+    // Finds the channel bytes holding payload header and secret text, which
+    // are decoded as one stream. Without a header, text ends at the first
+    // null or non-ASCII character, so it is decoded by a single band.
+    // Scattered payloads are gathered through their permutation instead.
+    LONG width = stegPtr->rowChannels;
+    int density = covPtr == NULL ? stegPtr->density : 1;
+    size_t pxTotal = (size_t)width * stegPtr->height; // Channel bytes of payload
+    LONG lastRow = stegPtr->height;
+    if (pay.version)
+    {
+        pxTotal = payloadChannels(covPtr == NULL ? stegPtr->mode : MODE_DIFF,
+                                  density, PAYLOAD_HEADER_SIZE + pay.length);
+        lastRow = (pxTotal + width - 1) / width;
+    }
+
+    // Collects compressed text in memory until it is whole
+    struct sink packed = {NULL, NULL, 0, 0, 1, 0, 0};
+    int compressed = (pay.flags & PAYLOAD_COMPRESSED) &&
+                     !(pay.flags & PAYLOAD_SHARDED);
+    struct sink *textPtr = compressed ? &packed : sinkPtr;
+
+    int gathered = stegPtr->scattered ||
+                   (covPtr == NULL && stegPtr->mode == MODE_HAMMING);
+    if (gathered)
+    {
+        status = extractGathered(&cov, &steg,
+                                 stegPtr->scattered ? &scat : NULL, pxTotal,
+                                 density, pay.length, textPtr);
+    }
+    closeReader(&cov);
+    closeReader(&steg);
+
+    if (!gathered)
+    {
+        struct extractBand bands[BAND_THREADS_MAX];
+        int bandCount = splitBands(bands, sizeof(*bands),
+                                   pay.version ? BAND_THREADS_MAX : 1, lastRow,
+                                   width, pxTotal);
+        for (int i = 0; i < bandCount; i++)
+        {
+            bands[i].covPtr = covPtr;
+            bands[i].stegPtr = stegPtr;
+            bands[i].density = density;
+            bands[i].untilEnd = pay.version == 0;
+            bands[i].skip = pay.version ? PAYLOAD_HEADER_SIZE : 0;
+            bands[i].sinkPtr = textPtr;
+        }
+
+        // Gives each band the slice of memory for the characters its rows
+        // hold, using the caller's memory when it can hold the whole text
+        BYTE *text = NULL;
+        if (bandCount > 1)
+        {
+            int direct = textPtr->filePtr == NULL &&
+                         textPtr->capacity >= pay.length;
+            text = direct ? textPtr->data : allocMemory(pay.length);
+            if (text == NULL)
             {
-                break;
+                reportError("%s", "malloc() failed: no memory for decoded "
+                                  "text in decodeText()\n");
+                return ERR_ALLOC;
             }
 
-            fputc(character, decodedTxt); // Display character into the decoded text file
-            decodedBit = 0;               // Reset counter for decoded bit
-            character = 0;                // Reset ASCII decimal value
+            for (int i = 0; i < bandCount; i++)
+            {
+                size_t first = (size_t)bands[i].band.first * width * density /
+                               CHAR_BIT;
+                size_t skip = first < PAYLOAD_HEADER_SIZE
+                                  ? PAYLOAD_HEADER_SIZE - first
+                                  : 0;
+                size_t start = first + skip - PAYLOAD_HEADER_SIZE;
+                size_t end = (size_t)bands[i].band.last * width * density /
+                             CHAR_BIT;
+                end = end < PAYLOAD_HEADER_SIZE + pay.length
+                          ? end - PAYLOAD_HEADER_SIZE
+                          : pay.length;
+                struct sink slice = {NULL, text + start,
+                                     end > start ? end - start : 0, 0, 0, 0,
+                                     0};
+                bands[i].skip = skip;
+                bands[i].sink = slice;
+                bands[i].sinkPtr = &bands[i].sink;
+            }
         }
 
-        // Checks if the current pixel is the last pixel of current row
-        if (px == lastPx)
+        status = runBands(extractBand, bands, sizeof(*bands), bandCount);
+
+        // Hands text decoded by bands to the sink, unless it is already there,
+        // joining the checksums of their slices
+        if (text != NULL)
         {
-            // Skip padding to proceed to the first pixel of next row
-            px += stegImg.padding;
+            unsigned int crc = 0;
+            for (int i = 0; i < bandCount; i++)
+            {
+                crc = crc32cCombine(crc, bands[i].sink.crc,
+                                    bands[i].sink.length);
+            }
+
+            if (text == textPtr->data)
+            {
+                textPtr->length = pay.length;
+            }
+            else if (compressed)
+            {
+                packed.data = text;
+                packed.capacity = packed.length = pay.length;
+            }
+            else
+            {
+                if (!status)
+                {
+                    putText(textPtr, text, pay.length);
+                }
+                freeMemory(text);
+            }
+            textPtr->crc = crc;
+        }
+    }
+
+    // Rejects text that differs from the encoded text, as decoded against
+    // the wrong cover image or from a damaged stego image
+    if (!status && (pay.flags & PAYLOAD_CHECKSUM) &&
+        textPtr->crc != pay.checksum)
+    {
+        reportError("%s", "checksum mismatch: decoded secret text differs "
+                          "from the encoded text, so the cover image is wrong "
+                          "or the stego image is damaged in decodeText()\n");
+        status = ERR_CHECKSUM;
+    }
+
+    // Writes decompressed text once all compressed bytes are decoded
+    if (compressed)
+    {
+        BYTE *text;       // Decompressed secret text
+        size_t charCount; // Number of characters of secret text
 
-            // Update index of last pixel of next row
-            lastPx += stegImg.width + stegImg.padding;
+        if (!status && packed.failed)
+        {
+            reportError("%s", "realloc() failed: no memory for compressed "
+                              "text in decodeText()\n");
+            status = ERR_ALLOC;
         }
+        if (!status)
+        {
+            status = decompressBytes(packed.data, packed.length, &text,
+                                     &charCount);
+            if (status == ERR_FORMAT)
+            {
+                reportError("%s", "compressed secret text is damaged in "
+                                  "decodeText()\n");
+            }
+        }
+        if (!status)
+        {
+            trackAlloc(text); // Allocated by decompressBytes()
+            putText(sinkPtr, text, charCount);
+            freeMemory(text);
+        }
+        freeMemory(packed.data);
+    }
+
+    return status;
+}
+
+// Writes the secret text into the text file indicated by fname, decoding it
+// as extractPayload() does. Text that fails its checksum, or is decoded
+// against the wrong cover image, is not left behind. Returns 0 on success.
+static int extractText(const BMP *covPtr, const BMP *stegPtr,
+                       const char *fname)
+{
+    int status = verifyFilename(fname, ".txt", "decodeText()");
+    if (status)
+    {
+        return status;
+    }
+
+    FILE *decodedTxt = fopen(fname, "wb"); // Opens file for decoded text
+
+    // Stops if file could not be created
+    if (decodedTxt == NULL)
+    {
+        reportError("fopen error: decoded text %s could not be created in "
+                    "decodeText()\n",
+                    fname);
+        return ERR_OPEN;
     }
 
-    fclose(decodedTxt);
+    struct sink sink = {decodedTxt, NULL, 0, 0, 0, 0, 0};
+    double start = statClock();
+    status = extractPayload(covPtr, stegPtr, &sink, NULL);
+    addTime(&stats.decodeTime, start);
+
+    if (fclose(decodedTxt) || sink.failed || status)
+    {
+        // Other failures are reported where they happen
+        if (!status || status == ERR_WRITE)
+        {
+            reportError("decoded text %s could not be written in "
+                        "decodeText()\n",
+                        fname);
+        }
+        remove(fname); // Leaves no partial text behind
+        return status ? status : ERR_WRITE;
+    }
 
     return 0; // Secret text successfully decoded
-}
\ No newline at end of file
+}
+
+// Checks that cover image covImg and stego image stegImg have the same pixel
+// array on behalf of function caller. Returns 0 on success.
+static int checkPair(BMP covImg, BMP stegImg, const char *caller)
+{
+    // Rejects pixel array size of cover and stego image that are not equal.
+    // Suggests that the images are not related to each other.
+    if (covImg.pxArrSize != stegImg.pxArrSize ||
+        covImg.pxRowSize != stegImg.pxRowSize ||
+        covImg.width != stegImg.width ||
+        covImg.bitDepth != stegImg.bitDepth)
+    {
+        reportError("incompatible files: different cover image and stego "
+                    "image in %s\n",
+                    caller);
+        return ERR_MISMATCH;
+    }
+
+    return 0;
+}
+
+// Writes the secret text into the text file indicated by fname. Secret text is
+// decoded from stego image stegImg and cover image covImg. The cover image is
+// not read if the stego image was encoded in blind mode. Returns 0 on success.
+int decodeText(BMP covImg, BMP stegImg, const char *fname)
+{
+    if (stegImg.mode != MODE_DIFF)
+    {
+        return extractText(NULL, &stegImg, fname);
+    }
+
+    int status = checkPair(covImg, stegImg, "decodeText()");
+    if (status)
+    {
+        return status;
+    }
+
+    return extractText(&covImg, &stegImg, fname);
+}
+
+// Writes the secret text into the text file indicated by fname. Secret text is
+// decoded from stego image stegImg alone, which must have been encoded in
+// blind mode. Returns 0 on success.
+int decodeBlind(BMP stegImg, const char *fname)
+{
+    if (stegImg.mode == MODE_DIFF)
+    {
+        reportError("%s", "stego image was not encoded in blind mode: its "
+                          "cover image is needed in decodeBlind()\n");
+        return ERR_MISMATCH;
+    }
+
+    return extractText(NULL, &stegImg, fname);
+}
+
+// Writes the secret text into the size bytes of buf and stores its length in
+// the integer pointed to by lengthPtr. Secret text is decoded from stego
+// image *stegPtr and cover image *covPtr; the cover image is not read, and
+// may be NULL, if the stego image was encoded in blind mode. Returns 0 on
+// success or ERR_BUFFER if the text is longer than size, in which case its
+// whole length is still stored.
+int decodeBytes(const BMP *covPtr, const BMP *stegPtr, BYTE *buf, size_t size,
+                size_t *lengthPtr)
+{
+    int blind = stegPtr->mode != MODE_DIFF;
+    if (!blind)
+    {
+        int status = covPtr == NULL
+                         ? ERR_MISMATCH
+                         : checkPair(*covPtr, *stegPtr, "decodeBytes()");
+        if (status)
+        {
+            return status;
+        }
+    }
+
+    struct sink sink = {NULL, buf, size, 0, 0, 0, 0};
+    double start = statClock();
+    int status = extractPayload(blind ? NULL : covPtr, stegPtr, &sink, NULL);
+    addTime(&stats.decodeTime, start);
+    *lengthPtr = sink.length;
+
+    if (!status && sink.length > size)
+    {
+        status = ERR_BUFFER;
+    }
+    return status;
+}
+
+struct shard              // Structure representing one image of sharded text
+{
+    struct band band;     // Status and stats of shard, first for runBands()
+    BMP *covPtr;          // Cover image, or NULL to decode blind
+    BMP *stegPtr;         // Stego image being decoded
+    const char *fname;    // Stego image created when encoding
+    BYTE *payload;        // Payload header and bytes of shard to encode
+    size_t length;        // Number of bytes of payload
+    struct sink sink;     // Decoded bytes of shard
+    PAYLOAD pay;          // Payload header of decoded shard
+};
+
+// Runs worker on each of the count shards at shards on parallel threads, at
+// most BAND_THREADS_MAX at a time. Returns status of the first shard that
+// failed, or 0 on success.
+static int runShards(void *(*worker)(void *), struct shard *shards, int count)
+{
+    int status = 0;
+    for (int i = 0; i < count; i += BAND_THREADS_MAX)
+    {
+        int group = count - i < BAND_THREADS_MAX ? count - i
+                                                 : BAND_THREADS_MAX;
+        int result = runBands(worker, shards + i, sizeof(*shards), group);
+        status = status ? status : result;
+    }
+
+    return status;
+}
+
+// Encodes the payload of the shard pointed to by arg into its cover image,
+// then creates its stego image. Returns NULL.
+static void *encodeShard(void *arg)
+{
+    struct shard *shardPtr = arg;
+
+    shardPtr->band.status = embedPayload(shardPtr->covPtr, shardPtr->payload,
+                                         shardPtr->length, "shardEncode()");
+    if (!shardPtr->band.status)
+    {
+        shardPtr->band.status = createStego(shardPtr->fname,
+                                            *shardPtr->covPtr);
+    }
+    shardPtr->band.stats = getStats();
+
+    return NULL;
+}
+
+// Creates the count stego images indicated by stegoNames by sharding secret
+// text in the file indicated by textName across the cover images pointed to
+// by imgPtrs, in proportion to their capacity so that all of them finish
+// together. The payload header of each shard records its sequence and the
+// total, and its trailer the checksum of the shard. Text is compressed whole,
+// before it is split, if flags has PAYLOAD_COMPRESSED. Images are encoded on
+// parallel threads with mode and density as in encodeText(). Stego images
+// must have distinct names, and those already created are removed if any
+// shard fails. Returns 0 on success.
+int shardEncode(const char *textName, BMP *imgPtrs[],
+                const char *const stegoNames[], int count, int mode,
+                int density, int flags)
+{
+    int status = checkDensity(mode, density, "shardEncode()");
+    if (status)
+    {
+        return status;
+    }
+    if (count < 1 || count > SHARD_MAX)
+    {
+        reportError("invalid shards: %d images given but 1 to %d are allowed "
+                    "in shardEncode()\n",
+                    count, SHARD_MAX);
+        return ERR_FORMAT;
+    }
+
+    // Shards written over each other would lose all but the last
+    for (int i = 1; i < count; i++)
+    {
+        for (int j = 0; j < i; j++)
+        {
+            if (!strcmp(stegoNames[i], stegoNames[j]))
+            {
+                reportError("invalid shards: stego image %s is given more "
+                            "than once in shardEncode()\n",
+                            stegoNames[i]);
+                return ERR_FILENAME;
+            }
+        }
+    }
+
+    size_t charCount; // Number of characters in secret text
+    PAYLOAD pay;      // Payload header of the whole secret text
+    double start = statClock();
+    BYTE *text = readText(textName, &charCount, &status, "shardEncode()");
+    if (text != NULL)
+    {
+        text = compressText(text, charCount, flags, textName, &pay, &status);
+    }
+    addTime(&stats.textTime, start);
+    if (text == NULL)
+    {
+        return status;
+    }
+
+    // Computes bytes each image holds besides its own payload header and
+    // trailer
+    const size_t frame = PAYLOAD_HEADER_SIZE + PAYLOAD_TRAILER_SIZE;
+    size_t room[SHARD_MAX];  // Bytes of secret text each image can hold
+    size_t share[SHARD_MAX]; // Bytes of secret text given to each image
+    size_t capacity = 0;     // Bytes of secret text all images can hold
+    int headerless = 0;      // Nonzero if an image cannot hold its header
+    for (int i = 0; i < count; i++)
+    {
+        size_t bytes = payloadCapacity(mode, density,
+                                       (size_t)imgPtrs[i]->rowChannels *
+                                           imgPtrs[i]->height);
+        room[i] = bytes > frame ? bytes - frame : 0;
+        capacity += room[i];
+        headerless |= bytes < frame;
+    }
+    if (capacity < pay.length || headerless)
+    {
+        reportError("secret text %s has too many characters\n"
+                    "%llu bytes are needed but the %d cover images only "
+                    "hold %zu.\n",
+                    textName, pay.length, count, capacity);
+        freeMemory(text);
+        return ERR_CAPACITY;
+    }
+
+    // Splits text in proportion to room, then hands bytes lost to rounding
+    // to the first images with room left
+    size_t given = 0;
+    for (int i = 0; i < count; i++)
+    {
+        share[i] = (size_t)((long double)pay.length * room[i] / capacity);
+        share[i] = share[i] < room[i] ? share[i] : room[i];
+        given += share[i];
+    }
+    for (int i = 0; i < count && given < pay.length; i++)
+    {
+        size_t extra = room[i] - share[i] < pay.length - given
+                           ? room[i] - share[i]
+                           : pay.length - given;
+        share[i] += extra;
+        given += extra;
+    }
+
+    struct shard *shards = allocZeroed(count, sizeof(*shards));
+    if (shards == NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for shards in "
+                          "shardEncode()\n");
+        freeMemory(text);
+        return ERR_ALLOC;
+    }
+
+    // Copies each shard between a payload header and trailer of its own
+    size_t offset = PAYLOAD_HEADER_SIZE; // Offset of next shard in text
+    for (int i = 0; i < count; i++)
+    {
+        PAYLOAD part = {PAYLOAD_VERSION,
+                        pay.flags | PAYLOAD_SHARDED | PAYLOAD_CHECKSUM,
+                        share[i], i, count,
+                        crc32c(0, text + offset, share[i])};
+        shards[i].covPtr = imgPtrs[i];
+        shards[i].fname = stegoNames[i];
+        shards[i].length = frame + share[i];
+        shards[i].payload = allocMemory(shards[i].length);
+        if (shards[i].payload == NULL)
+        {
+            reportError("%s", "malloc() failed: no memory for shards in "
+                              "shardEncode()\n");
+            for (int j = 0; j < i; j++)
+            {
+                freeMemory(shards[j].payload);
+            }
+            freeMemory(shards);
+            freeMemory(text);
+            return ERR_ALLOC;
+        }
+
+        packPayload(shards[i].payload, part);
+        memcpy(shards[i].payload + PAYLOAD_HEADER_SIZE, text + offset,
+               share[i]);
+        offset += share[i];
+        imgPtrs[i]->mode = mode;
+        imgPtrs[i]->density = density;
+    }
+    freeMemory(text);
+
+    // Encodes and writes every image at once; each shard releases its payload
+    start = statClock();
+    status = runShards(encodeShard, shards, count);
+    addTime(&stats.encodeTime, start);
+
+    // Shards cannot be decoded without the others, so none is left behind.
+    // Stego images are only created by shards that succeeded or failed to
+    // write them
+    for (int i = 0; i < count && status; i++)
+    {
+        if (!shards[i].band.status || shards[i].band.status == ERR_WRITE)
+        {
+            remove(stegoNames[i]);
+        }
+    }
+    freeMemory(shards);
+
+    return status;
+}
+
+// Decodes the bytes of the shard held by the stego image of the shard
+// pointed to by arg, reading its cover image unless the stego image was
+// encoded in blind mode. Returns NULL.
+static void *decodeShard(void *arg)
+{
+    struct shard *shardPtr = arg;
+    BMP *covPtr = shardPtr->covPtr;
+    BMP *stegPtr = shardPtr->stegPtr;
+    int status = 0;
+
+    if (stegPtr->mode != MODE_DIFF)
+    {
+        covPtr = NULL;
+    }
+    else if (covPtr == NULL)
+    {
+        reportError("%s", "stego image was not encoded in blind mode: its "
+                          "cover image is needed in shardDecode()\n");
+        status = ERR_MISMATCH;
+    }
+    else
+    {
+        status = checkPair(*covPtr, *stegPtr, "shardDecode()");
+    }
+
+    if (!status)
+    {
+        struct sink sink = {NULL, NULL, 0, 0, 1, 0, 0};
+        status = extractPayload(covPtr, stegPtr, &sink, &shardPtr->pay);
+        if (!status && !(shardPtr->pay.flags & PAYLOAD_SHARDED))
+        {
+            reportError("%s", "stego image holds no shard of sharded secret "
+                              "text in shardDecode()\n");
+            status = ERR_MISMATCH;
+        }
+        if (!status && sink.failed)
+        {
+            reportError("%s", "realloc() failed: no memory for shard in "
+                              "shardDecode()\n");
+            status = ERR_ALLOC;
+        }
+        shardPtr->sink = sink;
+    }
+
+    shardPtr->band.status = status;
+    shardPtr->band.stats = getStats();
+
+    return NULL;
+}
+
+// Writes the secret text sharded across count stego images pointed to by
+// stegPtrs into the text file indicated by fname. Each shard is decoded on
+// its own thread, with the cover image of the same index in covPtrs, which
+// may be NULL for stego images encoded in blind mode, then shards are
+// joined in the order of their sequence. Returns 0 on success.
+int shardDecode(BMP *covPtrs[], BMP *stegPtrs[], int count,
+                const char *fname)
+{
+    int status = verifyFilename(fname, ".txt", "shardDecode()");
+    if (status)
+    {
+        return status;
+    }
+    if (count < 1 || count > SHARD_MAX)
+    {
+        reportError("invalid shards: %d images given but 1 to %d are allowed "
+                    "in shardDecode()\n",
+                    count, SHARD_MAX);
+        return ERR_FORMAT;
+    }
+
+    struct shard *shards = allocZeroed(count, sizeof(*shards));
+    if (shards == NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for shards in "
+                          "shardDecode()\n");
+        return ERR_ALLOC;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        shards[i].covPtr = covPtrs[i];
+        shards[i].stegPtr = stegPtrs[i];
+    }
+
+    double start = statClock();
+    status = runShards(decodeShard, shards, count);
+    addTime(&stats.decodeTime, start);
+
+    // Orders shards by sequence, rejecting sets that miss a shard or mix
+    // shards of different secret texts
+    struct shard *order[SHARD_MAX] = {NULL};
+    size_t length = 0; // Number of bytes of joined shards
+    for (int i = 0; i < count && !status; i++)
+    {
+        PAYLOAD pay = shards[i].pay;
+        if (pay.total != count || order[pay.sequence] != NULL ||
+            pay.flags != shards[0].pay.flags)
+        {
+            reportError("%s", "incompatible files: stego images do not hold "
+                              "every shard of one secret text in "
+                              "shardDecode()\n");
+            status = ERR_MISMATCH;
+            break;
+        }
+        order[pay.sequence] = &shards[i];
+        length += shards[i].sink.length;
+    }
+
+    BYTE *text = NULL; // Joined shards, then secret text
+    if (!status && (text = allocMemory(length ? length : 1)) == NULL)
+    {
+        reportError("%s", "malloc() failed: no memory for secret text in "
+                          "shardDecode()\n");
+        status = ERR_ALLOC;
+    }
+    if (!status)
+    {
+        size_t offset = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (order[i]->sink.length > 0)
+            {
+                memcpy(text + offset, order[i]->sink.data,
+                       order[i]->sink.length);
+                offset += order[i]->sink.length;
+            }
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        freeMemory(shards[i].sink.data);
+    }
+
+    // Decompresses text that was compressed whole before it was split
+    if (!status && (shards[0].pay.flags & PAYLOAD_COMPRESSED))
+    {
+        BYTE *plain;      // Decompressed secret text
+        size_t charCount; // Number of characters of secret text
+        status = decompressBytes(text, length, &plain, &charCount);
+        if (status == ERR_FORMAT)
+        {
+            reportError("%s", "compressed secret text is damaged in "
+                              "shardDecode()\n");
+        }
+        if (!status)
+        {
+            trackAlloc(plain); // Allocated by decompressBytes()
+            freeMemory(text);
+            text = plain;
+            length = charCount;
+        }
+    }
+    freeMemory(shards);
+
+    if (!status)
+    {
+        FILE *decodedTxt = fopen(fname, "wb"); // Opens file for decoded text
+        if (decodedTxt == NULL)
+        {
+            reportError("fopen error: decoded text %s could not be created "
+                        "in shardDecode()\n",
+                        fname);
+            status = ERR_OPEN;
+        }
+        else
+        {
+            start = statClock();
+            size_t written = fwrite(text, sizeof(*text), length, decodedTxt);
+            if (fclose(decodedTxt) || written != length)
+            {
+                reportError("decoded text %s could not be written in "
+                            "shardDecode()\n",
+                            fname);
+                status = ERR_WRITE;
+                remove(fname);
+            }
+            addCount(&stats.bytesWritten, written);
+            addTime(&stats.writeTime, start);
+        }
+    }
+    freeMemory(text);
+
+    return status;
+}
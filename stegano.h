@@ -10,21 +10,92 @@
  *      08 April 2022 - created
  *      09 April 2022 - modified function prototypes
  *                    - added new data type name
+ *      17 October 2026 - added error codes and include guard for batch mode
+ *                      - added memory mapping of bitmap files
+ *                      - replaced modified pixel array with copied rows
+ *                      - added row streaming functions
+ *                      - added payload header
+ *                      - added blind embedding mode
+ *                      - added pixel formats for 24-bit and 32-bit images
+ *                      - added embedding density
+ *                      - added payload compression flag
+ *                      - added in-memory functions for library builds
+ *                      - added per-job timings and counters
+ *                      - added freeRows() for shared cover images
+ *                      - added patchStego()
+ *                      - added row bands encoded and decoded in parallel
+ *                      - added payloads sharded across several images
+ *                      - added payload bits scattered by a key
+ *                      - added Hamming matrix embedding mode
+ *                      - added CRC32C payload trailer
  */
 
+#ifndef STEGANO_H
+#define STEGANO_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
 #include <unistd.h>
 #include <wchar.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <malloc.h>
 
 #define FNAME_MAX 100       // Maximum character for filenames
 #define FILEHEADER_SIZE 14  // Size of bitmap file header (14 bytes)
+#define INFOHEADER_SIZE 40  // Minimum size of DIB header (40 bytes)
+#define BI_RGB 0            // Uncompressed pixel array
+#define BI_BITFIELDS 3      // Uncompressed pixel array with channel masks
 #define ASCII_MIN 0         // Minimum value for ASCII character
 #define ASCII_MAX 127       // Maximum value for ASCII character
+#define STREAM_CHUNK 65536  // Bytes of pixel array read at a time when streaming
+#define BAND_MIN_BYTES (1 << 20) // Fewest payload channel bytes per thread
+#define BAND_THREADS_MAX 64 // Most threads encoding or decoding one image
+
+// Payload header encoded before secret text. The magic starts with a
+// non-ASCII byte, so text encoded without a header never matches it.
+#define PAYLOAD_MAGIC "\x89RVL" // First 4 bytes of payload header
+#define PAYLOAD_VERSION 1       // Version of payload header format
+#define PAYLOAD_HEADER_SIZE 16  // Size of payload header in bytes
+#define PAYLOAD_COMPRESSED 0x01 // Flag: secret text is compressed
+#define PAYLOAD_SHARDED 0x02    // Flag: payload is one shard of secret text
+#define PAYLOAD_CHECKSUM 0x04   // Flag: CRC32C trailer follows secret text
+#define PAYLOAD_FLAGS (PAYLOAD_COMPRESSED | PAYLOAD_SHARDED | PAYLOAD_CHECKSUM) // Flags this version can decode
+#define PAYLOAD_TRAILER_SIZE 4  // Size of CRC32C trailer in bytes
+#define SHARD_MAX 255           // Most images one secret text is sharded into
+
+// Embedding modes. Modes are recorded in the reserved bytes of the bitmap
+// file header as STEGO_MARK followed by the mode and the density, the number
+// of bits stored in each channel byte, or in each Hamming block for
+// MODE_HAMMING. Modes other than MODE_DIFF are read blind. Stego images
+// created before payload headers have no mark.
+#define MODE_DIFF 0         // +1/-1 deltas read against the cover image
+#define MODE_LSB 1          // Least significant bit replacement, read blind
+#define MODE_HAMMING 2      // Hamming matrix embedding into low bits, read blind
+#define MODE_SCATTERED 0x80 // Flag on recorded mode: payload bits are scattered
+#define STEGO_MARK "RV"     // Marks the reserved bytes of a stego image
+#define STEGO_MARK_OFFSET 6 // Offset of reserved bytes in bitmap file header
+#define DENSITY_MAX 4       // Most bits stored in each channel byte
+#define HAMMING_MAX 6       // Most bits of a Hamming block, which fits 64 bits
+#define HAMMING_PIXELS(k) ((1u << (k)) - 1) // Channel bytes of a k-bit block
+
+// Error codes returned by functions in place of terminating the program
+#define ERR_FILENAME 1      // Filename has invalid file extension
+#define ERR_OPEN 2          // File could not be opened or created
+#define ERR_FORMAT 3        // File content is malformed or unsupported
+#define ERR_ALLOC 4         // Memory allocation failed
+#define ERR_CAPACITY 5      // Secret text does not fit in cover image
+#define ERR_MISMATCH 6      // Cover and stego image are unrelated
+#define ERR_WRITE 7         // Writing output file failed
+#define ERR_BUFFER 8        // Caller's buffer is too small
+#define ERR_CHECKSUM 9      // Decoded text differs from the encoded text
 
 // Moves cursor to (x, y) position in terminal
 #define setCursorPos(x, y) printf("\033[%d;%dH", (y), (x))
@@ -42,25 +113,103 @@ struct bitmap         // Structure representing bitmap images
     LONG width;       // Width of image in pixels
     LONG height;      // Height of image in pixels
     WORD bitDepth;    // Number of bits per pixel
-    DWORD colorCount; // Number of colors in color pallete
+    WORD pxSize;      // Number of bytes per pixel
+    DWORD colorCount; // Number of colors in color pallete, or 0 if none
+    DWORD tableSize;  // Size of color table and masks before pixel array
     DWORD pxArrSize;  // Size of pixel array in bytes
     DWORD padding;    // Padding for pixel array in bytes
+    DWORD pxRowSize;  // Size of each row of pixel array in bytes
+    DWORD pxArrOffset; // File offset of pixel array in bytes
+    LONG rowChannels; // Number of bytes of each row that store bits
 
     BYTE *header;      // Content of image header
-    DWORD *colorTable; // Content of color table
+    BYTE *colorTable;  // Content of color table and masks, or NULL if none
     BYTE *pxArr;       // Original pixel array
-    BYTE *pxArrMod;    // Modified pixel array
+    BYTE **rowMod;     // Modified copy of each row, or NULL if row is unmodified
+    LONG dirtyRows;    // Number of rows copied into rowMod
+
+    BYTE *map;         // Read-only mapping of the file, or NULL if it was read
+    size_t mapSize;    // Size of the mapping in bytes
+    const BYTE *buffer; // Caller's memory holding the image, or NULL
+
+    BYTE mode;         // Embedding mode recorded in the image header
+    BYTE density;      // Bits stored in each channel byte, from 1 to 4, or
+                       // in each Hamming block, from 2 to HAMMING_MAX
+    BYTE scattered;    // 1 if payload bits are scattered by key, 0 otherwise
+    unsigned long long key; // Key scattering payload bits, or 0 if none
 };
 
 typedef struct bitmap BMP; // Defines new data type name for struct bitmap
 
+struct payload        // Structure representing the payload header
+{
+    BYTE version;     // Version of header format, or 0 if there is no header
+    BYTE flags;       // Options used to encode secret text
+    unsigned long long length; // Number of bytes of encoded secret text
+    BYTE sequence;    // Index of shard held by the image, from 0
+    BYTE total;       // Number of shards, or 0 if the payload is not sharded
+    unsigned int checksum; // CRC32C of encoded secret text, if flags has
+                           // PAYLOAD_CHECKSUM
+};
+
+typedef struct payload PAYLOAD; // Defines new data type name for struct payload
+
+struct stats             // Structure representing timings and counters of a job
+{
+    double loadTime;     // Seconds spent loading images
+    double textTime;     // Seconds spent reading and preparing secret text
+    double encodeTime;   // Seconds spent encoding into pixels
+    double decodeTime;   // Seconds spent decoding secret text
+    double writeTime;    // Seconds spent writing stego images
+    unsigned long long bytesRead;      // Bytes read from files
+    unsigned long long bytesWritten;   // Bytes written to files or buffers
+    unsigned long long pixelsModified; // Pixels changed by encoding
+    unsigned long long rowsDirtied;    // Rows copied or rewritten by encoding
+    size_t allocBytes;   // Bytes currently allocated
+    size_t peakBytes;    // Most bytes allocated at once
+};
+
+typedef struct stats STATS; // Defines new data type name for struct stats
+
 // Function prototypes
 int showBackground(const char *fname);
 void clearTerminal(void);
+void setHeadless(int enabled);
+void reportError(const char *format, ...);
+void enableStats(int enabled);
+void setBandThreads(int count);
+void resetStats(void);
+STATS getStats(void);
 int verifyFilename(const char *fname, const char *extension, const char *caller);
+size_t payloadChannels(int mode, int density, size_t length);
+size_t payloadCapacity(int mode, int density, size_t channels);
 BMP *loadImage(const char *fname);
+BMP *openImage(const char *fname);
+int readRows(const BMP *imgPtr, LONG first, LONG count, BYTE *buf);
 int printProperties(BMP img);
-int encodeText(const char *fname, BMP *imgPtr);
+int encodeText(const char *fname, BMP *imgPtr, int mode, int density,
+               int flags);
+BYTE *writeRow(BMP *imgPtr, LONG row);
+const BYTE *readRow(const BMP *imgPtr, LONG row);
 int createStego(const char *fname, BMP img);
+int patchStego(const char *fname, BMP img);
 int freeImage(BMP *imgPtr);
-int decodeText(BMP covImg, BMP stegImg, const char *fname);
\ No newline at end of file
+void freeRows(BMP *imgPtr);
+int decodeText(BMP covImg, BMP stegImg, const char *fname);
+int decodeBlind(BMP stegImg, const char *fname);
+int streamEncode(const char *textName, BMP img, const char *stegoName,
+                 int mode, int density, int flags);
+BMP *parseImage(const BYTE *data, size_t size, int *statusPtr);
+int encodeBytes(BMP *imgPtr, const BYTE *data, size_t length, int mode,
+                int density, int flags);
+size_t stegoSize(BMP img);
+int writeStego(BMP img, BYTE *buf, size_t size);
+int decodeBytes(const BMP *covPtr, const BMP *stegPtr, BYTE *buf, size_t size,
+                size_t *lengthPtr);
+int shardEncode(const char *textName, BMP *imgPtrs[],
+                const char *const stegoNames[], int count, int mode,
+                int density, int flags);
+int shardDecode(BMP *covPtrs[], BMP *stegPtrs[], int count,
+                const char *fname);
+
+#endif